@@ -0,0 +1,9 @@
+# Benchmarks, built by the top-level loopy.pro after the core library:
+#   qmake loopy.pro && make
+#   ./benchmarks/loopybench/loopybench                  run all benchmarks
+#   ./benchmarks/corpusgen/corpusgen -n 10000 <dir>     generate a test corpus
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    corpusgen \
+    loopybench
@@ -0,0 +1,10 @@
+# Synthetic test corpus generator (corpusgenerator.h)
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/corpusgenerator.cpp
+
+HEADERS += \
+    $$PWD/corpusgenerator.h
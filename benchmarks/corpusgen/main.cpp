@@ -0,0 +1,61 @@
+#include "corpusgenerator.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <cstdio>
+
+/*
+ * 语料生成工具
+ *  corpusgen [-n 歌曲数] [-l 歌词行数] [-f 音频帧数] [-r 歌词比例] [-g GBK歌词比例] [-s 种子] <输出目录>
+ *  同样的参数总是生成相同的文件
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generate a reproducible synthetic mp3/lrc corpus.");
+    parser.addHelpOption();
+    QCommandLineOption songs(QStringList() << "n" << "songs", "Number of songs.", "count", "1000");
+    QCommandLineOption lines(QStringList() << "l" << "lines", "Average lyric lines per song.", "count", "60");
+    QCommandLineOption frames(QStringList() << "f" << "frames", "Audio frames per mp3 file.", "count", "64");
+    QCommandLineOption ratio(QStringList() << "r" << "lyric-ratio", "Fraction of songs with a lyric file.", "ratio", "0.8");
+    QCommandLineOption gbk(QStringList() << "g" << "gbk-ratio", "Fraction of lyric files saved as GBK.", "ratio", "0");
+    QCommandLineOption seed(QStringList() << "s" << "seed", "Random seed.", "seed", "1");
+    parser.addOptions(QList<QCommandLineOption>() << songs << lines << frames << ratio << gbk << seed);
+    parser.addPositionalArgument("dir", "Output directory.");
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+    {
+        parser.showHelp(1);
+    }
+
+    CorpusGenerator::Options options;
+    options.songs = qMax(0, parser.value(songs).toInt());
+    options.lyricLines = qMax(1, parser.value(lines).toInt());
+    options.audioFrames = qMax(0, parser.value(frames).toInt());
+    options.lyricRatio = qBound(0.0, parser.value(ratio).toDouble(), 1.0);
+    options.gbkRatio = qBound(0.0, parser.value(gbk).toDouble(), 1.0);
+    options.seed = parser.value(seed).toUInt();
+
+    QString dir = parser.positionalArguments().first();
+    if (!QDir().mkpath(dir))
+    {
+        fprintf(stderr, "cannot create %s\n", qPrintable(dir));
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QStringList files = CorpusGenerator::generate(dir, options);
+    if (files.size() != options.songs)
+    {
+        fprintf(stderr, "failed to write corpus to %s\n", qPrintable(dir));
+        return 1;
+    }
+
+    printf("%d songs written to %s in %lld ms\n", files.size(), qPrintable(dir), timer.elapsed());
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "corpusgenerator.h"
+#include <QDir>
+#include <QFile>
+#include <QTextCodec>
+
+//每个子目录存放的歌曲数
+static const int kSongsPerDir = 100;
+//MPEG-1 Layer III，128kbps，44.1kHz，无填充，联合立体声；帧长 144 * 128000 / 44100 = 417字节
+static const uchar kFrameHeader[4] = { 0xFF, 0xFB, 0x90, 0x64 };
+static const int kFrameSize = 417;
+
+static const char * const kWords[] = {
+    "love", "night", "rain", "river", "light", "heart", "dream", "road", "summer", "winter",
+    "fire", "ocean", "star", "city", "home", "wind", "shadow", "morning", "silver", "golden",
+};
+static const char * const kChineseWords[] = {
+    "一生", "要走", "多远", "的路程", "月亮", "代表", "我的心", "夜空", "晴天", "稻香",
+};
+
+/*xorshift32伪随机数，输出只由种子决定*/
+class Random
+{
+public:
+    explicit Random(quint32 seed) : m_state(seed ? seed : 0x9E3779B9u) {}
+
+    quint32 next()
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return m_state;
+    }
+
+    int bounded(int n) { return (int)(next() % (quint32)n); }
+
+private:
+    quint32 m_state;
+};
+
+//count个随机单词，chinese为true时混入中文
+static QByteArray words(Random & random, int count, bool chinese)
+{
+    QByteArray text;
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0 && !chinese) { text += ' '; }
+        if (chinese && random.bounded(2) == 0)
+        {
+            text += kChineseWords[random.bounded(sizeof(kChineseWords) / sizeof(kChineseWords[0]))];
+        }
+        else
+        {
+            text += kWords[random.bounded(sizeof(kWords) / sizeof(kWords[0]))];
+        }
+    }
+    return text;
+}
+
+static void appendSyncSafe(QByteArray & out, quint32 value)
+{
+    out += (char)((value >> 21) & 0x7F);
+    out += (char)((value >> 14) & 0x7F);
+    out += (char)((value >> 7) & 0x7F);
+    out += (char)(value & 0x7F);
+}
+
+//v2.4文本帧，UTF-8编码
+static void appendTextFrame(QByteArray & out, const char * id, const QByteArray & text)
+{
+    out += QByteArray(id, 4);
+    appendSyncSafe(out, (quint32)text.size() + 1);
+    out += QByteArray(2, '\0');
+    out += (char)3;
+    out += text;
+}
+
+static QByteArray mp3Data(Random & random, const QByteArray & title, const QByteArray & artist,
+                          const QByteArray & album, int frames)
+{
+    QByteArray frameData;
+    appendTextFrame(frameData, "TIT2", title);
+    appendTextFrame(frameData, "TPE1", artist);
+    appendTextFrame(frameData, "TALB", album);
+
+    QByteArray data("ID3\x04\x00\x00", 6);
+    appendSyncSafe(data, (quint32)frameData.size());
+    data += frameData;
+
+    int offset = data.size();
+    data.resize(offset + frames * kFrameSize);
+    char * p = data.data() + offset;
+    for (int i = 0; i < frames; i++, p += kFrameSize)
+    {
+        memcpy(p, kFrameHeader, sizeof(kFrameHeader));
+        for (int j = sizeof(kFrameHeader); j < kFrameSize; j++)
+        {
+            p[j] = (char)random.next();
+        }
+    }
+    return data;
+}
+
+static QByteArray lrcData(Random & random, const QByteArray & title, const QByteArray & artist,
+                          const QByteArray & album, int lines)
+{
+    QByteArray text;
+    text.reserve(lines * 40 + 128);
+    text += "[ti:" + title + "]\n[ar:" + artist + "]\n[al:" + album + "]\n[by:corpusgen]\n";
+
+    qint64 time = 0;
+    char stamp[16];
+    for (int i = 0; i < lines; i++)
+    {
+        time += 1500 + random.bounded(4000);
+        int count = random.bounded(10) == 0 ? 2 : 1;   //偶尔一句歌词重复出现，一行两个时间戳
+        for (int j = 0; j < count; j++)
+        {
+            qint64 t = time + j * 60000;
+            qsnprintf(stamp, sizeof(stamp), "[%02d:%02d.%02d]", (int)(t / 60000), (int)(t / 1000 % 60), (int)(t / 10 % 100));
+            text += stamp;
+        }
+        text += words(random, 3 + random.bounded(6), random.bounded(3) == 0);
+        text += '\n';
+    }
+    return text;
+}
+
+static bool writeFile(const QString & path, const QByteArray & data)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) { return false; }
+    return file.write(data) == data.size();
+}
+
+QStringList CorpusGenerator::generate(const QString & dir, const Options & options)
+{
+    Random random(options.seed);
+
+    //歌手和专辑的集合，大约每20首歌一个歌手、每8首歌一张专辑
+    QVector<QByteArray> artists(qMax(1, options.songs / 20));
+    for (QByteArray & artist : artists) { artist = words(random, 2, random.bounded(4) == 0); }
+    QVector<QByteArray> albums(qMax(1, options.songs / 8));
+    for (QByteArray & album : albums) { album = words(random, 3, random.bounded(4) == 0); }
+
+    QStringList files;
+    files.reserve(options.songs);
+    QDir root(dir);
+    for (int i = 0; i < options.songs; i++)
+    {
+        QString subdir = QString("d%1").arg(i / kSongsPerDir, 4, 10, QChar('0'));
+        if (i % kSongsPerDir == 0 && !root.mkpath(subdir)) { return QStringList(); }
+
+        QByteArray title = words(random, 1 + random.bounded(4), random.bounded(3) == 0);
+        const QByteArray & artist = artists[random.bounded(artists.size())];
+        const QByteArray & album = albums[random.bounded(albums.size())];
+
+        QString base = root.filePath(subdir + QString("/%1").arg(i, 6, 10, QChar('0')));
+        if (!writeFile(base + ".mp3", mp3Data(random, title, artist, album, options.audioFrames)))
+        {
+            return QStringList();
+        }
+
+        //每首歌都消耗同样多的随机数，改变歌词比例不影响其他歌曲的内容
+        bool hasLyrics = random.bounded(1000) < options.lyricRatio * 1000;
+        int lines = qMax(1, options.lyricLines / 2 + random.bounded(options.lyricLines + 1));
+        quint32 lyricSeed = random.next();
+        if (hasLyrics)
+        {
+            Random lyricRandom(lyricSeed);
+            QByteArray lrc = lrcData(lyricRandom, title, artist, album, lines);
+            //用歌词的种子决定编码，不额外消耗随机数，改变GBK比例不影响其他文件的内容
+            if (lyricSeed % 1000 < options.gbkRatio * 1000) { lrc = toGb18030(lrc); }
+            if (!writeFile(base + ".lrc", lrc))
+            {
+                return QStringList();
+            }
+        }
+
+        files.append(base + ".mp3");
+    }
+    return files;
+}
+
+QByteArray CorpusGenerator::lyricText(int lines, quint32 seed)
+{
+    Random random(seed);
+    return lrcData(random, words(random, 2, false), words(random, 2, false), words(random, 3, false), lines);
+}
+
+QByteArray CorpusGenerator::toGb18030(const QByteArray & utf8)
+{
+    QTextCodec * codec = QTextCodec::codecForName("GB18030");
+    return codec ? codec->fromUnicode(QString::fromUtf8(utf8)) : utf8;
+}
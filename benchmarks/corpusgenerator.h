@@ -0,0 +1,42 @@
+#ifndef CORPUSGENERATOR_H
+#define CORPUSGENERATOR_H
+
+#include <QString>
+#include <QStringList>
+
+/*合成测试语料生成器，生成可复现的mp3/lrc文件，供基准测试和手工测试导入使用
+ *  同样的参数和种子总是生成逐字节相同的文件，方便在不同版本之间比较性能
+ *      随机数用自带的xorshift32，不依赖Qt版本或标准库的实现
+ *  mp3文件：ID3v2.4标签（UTF-8编码的TIT2/TPE1/TALB，部分歌曲带中文）+ 若干个MPEG-1 Layer III帧
+ *      帧头合法（128kbps 44.1kHz），帧内容是伪随机字节，不能正常解码，但足够测试标签读取和内容哈希
+ *      歌手和专辑从一个较小的集合中选取，和真实的歌曲库一样有大量重复
+ *  lrc文件：按比例生成，带[ti:] [ar:] [al:]标签和按时间递增的歌词行，偶尔一行有多个时间戳
+ *      其中一部分可以按GBK（GB18030）编码保存，模拟编码混杂的歌曲库
+ *  文件按每个子目录100首分散存放，目录结构也可以用来测试文件夹扫描
+ */
+class CorpusGenerator
+{
+public:
+    struct Options
+    {
+        Options() : songs(1000), lyricLines(60), audioFrames(64), lyricRatio(0.8), gbkRatio(0.0), seed(1) {}
+
+        int songs;              //歌曲数量
+        int lyricLines;         //每个歌词文件的平均行数
+        int audioFrames;        //每个mp3文件的音频帧数（每帧417字节）
+        double lyricRatio;      //带歌词文件的歌曲比例
+        double gbkRatio;        //歌词文件中按GBK编码保存的比例
+        quint32 seed;           //随机数种子
+    };
+
+    //在dir下生成语料，返回生成的mp3文件路径（按生成顺序），失败返回空列表
+    static QStringList generate(const QString & dir, const Options & options);
+
+    //生成一个歌词文件的内容（UTF-8），lines行歌词
+    static QByteArray lyricText(int lines, quint32 seed);
+
+    //把UTF-8文本转成GB18030编码
+    static QByteArray toGb18030(const QByteArray & utf8);
+};
+
+#endif // CORPUSGENERATOR_H
@@ -0,0 +1,20 @@
+QT       += core testlib
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../../core/core.pri)
+include(../corpus.pri)
+
+# The search benchmark sets its results on the list's filter model, which only needs QtCore
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    $$PWD/../../songfiltermodel.cpp \
+    tst_loopybench.cpp
+
+HEADERS += \
+    $$PWD/../../songfiltermodel.h
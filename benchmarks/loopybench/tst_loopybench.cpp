@@ -0,0 +1,706 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QThread>
+#include <cmath>
+#include <cstring>
+#include "audiomix.h"
+#include "corpusgenerator.h"
+#include "lrcparser.h"
+#include "lyrictimeline.h"
+#include "pcmringbuffer.h"
+#include "realfft.h"
+#include "searchindex.h"
+#include "seekindex.h"
+#include "song.h"
+#include "songfiltermodel.h"
+#include "spectrum.h"
+#include "worker.h"
+
+/*基准测试
+ *  启动时用CorpusGenerator在临时目录生成语料，歌曲数由环境变量LOOPY_BENCH_SONGS指定，默认1000
+ *  覆盖导入和播放时的热点：歌词解析、整首歌的导入、消息队列的并发收发、歌曲管理的插入和查找、当前歌词行的查找、
+ *      搜索索引的查询和过滤模型设置结果
+ *  用QtTest的参数选择计时方式，比如 -tickcounter、-callgrind、-perf，-iterations固定迭代次数
+ */
+class LoopyBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void readLyrics();
+    void parseLyricsInMemory_data();
+    void parseLyricsInMemory();
+    void import_data();
+    void import();
+    void messageQueue_data();
+    void messageQueue();
+    void songManagerInsert_data();
+    void songManagerInsert();
+    void songManagerFind_data();
+    void songManagerFind();
+    void lyricLookup_data();
+    void lyricLookup();
+    void search_data();
+    void search();
+    void audioMix_data();
+    void audioMix();
+    void pcmRing();
+    void spectrum_data();
+    void spectrum();
+    void seekIndex_data();
+    void seekIndex();
+
+private:
+    //从消息队列取走结果，累计处理的歌曲数和成功解析的数量；wait为true时一直取到处理完expected首为止
+    static void drain(int expected, bool wait, int & handled, int & parsed);
+    static QVector<QUrl> syntheticUrls(int count);
+
+private:
+    QTemporaryDir m_dir;
+    QList<QUrl> m_songs;        //语料中的所有mp3文件
+    QList<QUrl> m_lyricSongs;   //其中带歌词文件的
+};
+
+void LoopyBench::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    CorpusGenerator::Options options;
+    QByteArray songs = qgetenv("LOOPY_BENCH_SONGS");
+    if (!songs.isEmpty()) { options.songs = songs.toInt(); }
+
+    QStringList files = CorpusGenerator::generate(m_dir.path(), options);
+    QCOMPARE(files.size(), options.songs);
+
+    for (const QString & file : files)
+    {
+        m_songs.append(QUrl::fromLocalFile(file));
+        if (QFileInfo(QString(file).replace(".mp3", ".lrc")).isFile())
+        {
+            m_lyricSongs.append(m_songs.last());
+        }
+    }
+    QVERIFY(!m_lyricSongs.isEmpty());
+
+    //运行时选择的实现，和测量结果一起看
+    qInfo() << "AudioMix:" << AudioMix::implementation();
+    qInfo() << "RealFft:" << RealFft::implementation();
+}
+
+void LoopyBench::cleanupTestCase()
+{
+    SongManager::getInstance().clear();
+}
+
+//播放时按需加载整首歌的歌词：打开文件、解析全部歌词行
+void LoopyBench::readLyrics()
+{
+    int count = qMin(100, m_lyricSongs.size());
+    int lines = 0;
+    QBENCHMARK
+    {
+        lines = 0;
+        for (int i = 0; i < count; i++)
+        {
+            lines += Worker::readLyrics(m_lyricSongs[i]).size();
+        }
+    }
+    QVERIFY(lines > 0);
+}
+
+void LoopyBench::parseLyricsInMemory_data()
+{
+    QTest::addColumn<QByteArray>("text");
+    QTest::addColumn<int>("encoding");
+
+    QByteArray utf8 = CorpusGenerator::lyricText(500, 7);
+    QTest::newRow("utf8") << utf8 << (int)LrcParser::Utf8;
+    QTest::newRow("utf8 bom") << QByteArray("\xEF\xBB\xBF") + utf8 << (int)LrcParser::Utf8;
+    QTest::newRow("gbk") << CorpusGenerator::toGb18030(utf8) << (int)LrcParser::Gb18030;
+}
+
+//只测解析本身（包括编码检测），不含文件读写
+void LoopyBench::parseLyricsInMemory()
+{
+    QFETCH(QByteArray, text);
+    QFETCH(int, encoding);
+
+    LrcParser::Result result;
+    QBENCHMARK
+    {
+        result = LrcParser::Result();
+        LrcParser::parse(text.constData(), text.size(), result);
+    }
+    QVERIFY(result.lyrics.size() >= 500);
+    QCOMPARE((int)result.encoding, encoding);
+}
+
+void LoopyBench::import_data()
+{
+    QTest::addColumn<bool>("pooled");
+    QTest::addColumn<bool>("hashContent");
+
+    QTest::newRow("getASong") << false << false;
+    QTest::newRow("getSongs") << true << false;
+    QTest::newRow("getSongs+hash") << true << true;
+}
+
+//整首歌的导入：读取标签、歌词信息（可选内容哈希），经过重排和批量投递进入消息队列
+void LoopyBench::import()
+{
+    QFETCH(bool, pooled);
+    QFETCH(bool, hashContent);
+
+    Worker worker;
+    worker.setContentHashing(hashContent);
+
+    int parsed = 0;
+    QBENCHMARK
+    {
+        int handled = 0;
+        parsed = 0;
+        if (pooled)
+        {
+            worker.getSongs(m_songs);
+        }
+        else
+        {
+            //getASong在当前线程解析，边解析边取走结果，避免消息队列满了阻塞在入队上
+            for (const QUrl & url : m_songs)
+            {
+                worker.getASong(url);
+                drain(m_songs.size(), false, handled, parsed);
+            }
+        }
+        drain(m_songs.size(), true, handled, parsed);
+    }
+    QCOMPARE(parsed, m_songs.size());
+}
+
+void LoopyBench::drain(int expected, bool wait, int & handled, int & parsed)
+{
+    MessageQueue & queue = MessageQueue::getInstance();
+    Message message;
+    while (handled < expected && (wait ? queue.pop(message, 10000) : queue.try_pop(message)))
+    {
+        if (message.type() == Message::Result)
+        {
+            parsed += message.songs().size();
+            handled += message.songs().size();
+            qDeleteAll(message.songs());
+        }
+        else if (message.type() == Message::Error)
+        {
+            handled++;
+        }
+    }
+
+    //取完剩下的进度消息，清除已通知标记
+    if (wait) { queue.popAll(); }
+}
+
+/*消息队列生产者线程，连续入队count条进度消息*/
+class ProducerThread : public QThread
+{
+public:
+    explicit ProducerThread(int count) : m_count(count) {}
+
+protected:
+    void run() override
+    {
+        MessageQueue & queue = MessageQueue::getInstance();
+        for (int i = 0; i < m_count; i++)
+        {
+            queue.push(Message::progress(i, m_count));
+        }
+    }
+
+private:
+    int m_count;
+};
+
+void LoopyBench::messageQueue_data()
+{
+    QTest::addColumn<int>("producers");
+
+    QTest::newRow("1 producer") << 1;
+    QTest::newRow("2 producers") << 2;
+    QTest::newRow("4 producers") << 4;
+    QTest::newRow("8 producers") << 8;
+}
+
+//多个生产者同时入队，一个消费者（当前线程）出队，队列满时生产者按Block策略等待
+void LoopyBench::messageQueue()
+{
+    QFETCH(int, producers);
+
+    const int total = 200000;
+    MessageQueue & queue = MessageQueue::getInstance();
+    queue.setOverflowPolicy(MessageQueue::Block);
+
+    int popped = 0;
+    QBENCHMARK
+    {
+        QVector<ProducerThread*> threads;
+        for (int i = 0; i < producers; i++)
+        {
+            threads.append(new ProducerThread(total / producers));
+            threads.last()->start();
+        }
+
+        popped = 0;
+        Message message;
+        while (popped < total / producers * producers && queue.pop(message, 10000))
+        {
+            popped++;
+        }
+
+        for (ProducerThread * thread : threads)
+        {
+            thread->wait();
+        }
+        qDeleteAll(threads);
+    }
+    QCOMPARE(popped, total / producers * producers);
+}
+
+QVector<QUrl> LoopyBench::syntheticUrls(int count)
+{
+    //和真实歌曲库一样，大量歌曲共用少数目录
+    QVector<QUrl> urls;
+    urls.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+        urls.append(QUrl::fromLocalFile(QString("/music/artist%1/album%2/%3.mp3").arg(i / 200).arg(i / 10).arg(i)));
+    }
+    return urls;
+}
+
+static void songCounts()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+}
+
+void LoopyBench::songManagerInsert_data()
+{
+    songCounts();
+}
+
+//从空的歌曲管理对象开始插入count首歌，包括构造歌曲对象的开销
+void LoopyBench::songManagerInsert()
+{
+    QFETCH(int, count);
+
+    QVector<QUrl> urls = syntheticUrls(count);
+    SongManager & manager = SongManager::getInstance();
+    QBENCHMARK
+    {
+        manager.clear();
+        for (int i = 0; i < count; i++)
+        {
+            Song * song = new Song(urls[i], QString::number(i), QString("artist%1").arg(i / 200), QString("album%1").arg(i / 10));
+            manager.addSong(song);
+        }
+    }
+    QCOMPARE(manager.size(), count);
+    manager.clear();
+}
+
+void LoopyBench::songManagerFind_data()
+{
+    songCounts();
+}
+
+//在count首歌中查找10000次，一半命中一半不命中
+void LoopyBench::songManagerFind()
+{
+    QFETCH(int, count);
+
+    QVector<QUrl> urls = syntheticUrls(count);
+    SongManager & manager = SongManager::getInstance();
+    manager.clear();
+    for (int i = 0; i < count; i++)
+    {
+        manager.addSong(new Song(urls[i], QString::number(i), QString(), QString()));
+    }
+
+    QVector<QUrl> queries;
+    for (int i = 0; i < 10000; i++)
+    {
+        quint32 k = (quint32)i * 2654435761u;
+        queries.append(i % 2 == 0 ? urls[k % count] : QUrl::fromLocalFile(QString("/missing/%1.mp3").arg(k)));
+    }
+
+    int found = 0;
+    QBENCHMARK
+    {
+        found = 0;
+        for (const QUrl & url : queries)
+        {
+            if (manager.find(url) >= 0) { found++; }
+        }
+    }
+    QCOMPARE(found, 5000);
+    manager.clear();
+}
+
+void LoopyBench::lyricLookup_data()
+{
+    QTest::addColumn<bool>("sequential");
+
+    QTest::newRow("playback") << true;
+    QTest::newRow("seek") << false;
+}
+
+//当前歌词行的查找：playback模拟正常播放，进度每50毫秒前进一次；seek每次跳到任意位置
+void LoopyBench::lyricLookup()
+{
+    QFETCH(bool, sequential);
+
+    QByteArray text = CorpusGenerator::lyricText(200, 3);
+    LrcParser::Result lrc;
+    LrcParser::parse(text.constData(), text.size(), lrc);
+    const LyricTimeline & timeline = lrc.lyrics;
+    qint64 length = timeline.time(timeline.size() - 1) + 5000;
+
+    QVector<qint64> positions;
+    for (qint64 i = 0; positions.size() < 10000; i++)
+    {
+        positions.append(sequential ? i * 50 % length : (qint64)((quint32)i * 2654435761u % (quint32)length));
+    }
+
+    LyricCursor cursor;
+    qint64 sum = 0;
+    QBENCHMARK
+    {
+        cursor.reset(&timeline);
+        sum = 0;
+        for (qint64 position : positions)
+        {
+            sum += cursor.seek(position);
+        }
+    }
+    QVERIFY(sum > 0);
+}
+
+void LoopyBench::search_data()
+{
+    QTest::addColumn<QString>("query");
+
+    QTest::newRow("one char") << QString("l");
+    QTest::newRow("two chars") << QString("lo");
+    QTest::newRow("word") << QString("love");
+    QTest::newRow("two words") << QString("summer rain");
+    QTest::newRow("chinese") << QString("我的心");
+    QTest::newRow("no match") << QString("qqqq");
+}
+
+//只有行数的歌曲列表，给过滤模型做源模型
+class RowsModel : public QAbstractListModel
+{
+public:
+    explicit RowsModel(int rows) : m_rows(rows) {}
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override { return parent.isValid() ? 0 : m_rows; }
+    QVariant data(const QModelIndex &, int) const override { return QVariant(); }
+
+private:
+    int m_rows;
+};
+
+//在10万首歌的搜索索引中查询，每10首歌有一首带歌词，再把结果设置到过滤模型上；每次输入一个字就是一次这样的查询
+void LoopyBench::search()
+{
+    QFETCH(QString, query);
+
+    static RowsModel songs(100000);
+    static SongFilterModel filter;
+    if (filter.sourceModel() == nullptr) { filter.setSourceModel(&songs); }
+
+    static SearchIndex index;
+    if (index.size() == 0)
+    {
+        QVector<quint64> grams;
+        for (int i = 0; i < 100000; i++)
+        {
+            QByteArray text = CorpusGenerator::lyricText(i % 10 == 0 ? 40 : 0, (quint32)i + 1);
+            LrcParser::Result lrc;
+            LrcParser::parse(text.constData(), text.size(), lrc);
+
+            grams.clear();
+            SearchIndex::appendGrams(lrc.title, true, grams);
+            SearchIndex::appendGrams(lrc.artist, true, grams);
+            SearchIndex::appendGrams(lrc.album, true, grams);
+            for (const QString & line : lrc.lyrics.texts())
+            {
+                SearchIndex::appendGrams(line, false, grams);
+            }
+            index.insert(i, grams);
+        }
+    }
+
+    QBENCHMARK
+    {
+        filter.setFilter(index.search(query));
+    }
+    filter.clearFilter();
+}
+
+void LoopyBench::audioMix_data()
+{
+    QTest::addColumn<QString>("kernel");
+
+    QTest::newRow("ramp") << QString("ramp");
+    QTest::newRow("mixRamp") << QString("mixRamp");
+    QTest::newRow("crossfade") << QString("crossfade");
+    QTest::newRow("toInt16") << QString("toInt16");
+}
+
+//音频引擎的混音内核，每次处理1秒48kHz双声道的数据
+void LoopyBench::audioMix()
+{
+    QFETCH(QString, kernel);
+
+    const int frames = 48000;
+    QVector<float> a(frames * 2), b(frames * 2);
+    QVector<qint16> out(frames * 2);
+    for (int i = 0; i < a.size(); i++)
+    {
+        a[i] = (float)((i * 7919) % 2001 - 1000) / 1000.0f;
+        b[i] = (float)((i * 104729) % 2001 - 1000) / 1000.0f;
+    }
+
+    QBENCHMARK
+    {
+        if (kernel == "ramp")
+        {
+            //增益取-1，反复执行时采样不会越来越小，不会碰到非规格化数
+            AudioMix::ramp(a.data(), frames, 2, -1.0f, -1.0f);
+        }
+        else if (kernel == "mixRamp")
+        {
+            AudioMix::mixRamp(a.data(), b.constData(), frames, 2, 0.0f, 0.001f);
+        }
+        else if (kernel == "crossfade")
+        {
+            AudioMix::crossfade(a.data(), b.constData(), frames, 2, 0, frames);
+        }
+        else
+        {
+            AudioMix::toInt16(a.constData(), out.data(), a.size());
+        }
+    }
+}
+
+/*PCM环形缓冲区生产者线程，按解码器的节奏每次写入1152帧（一个mp3帧），写满时让出CPU*/
+class PcmProducerThread : public QThread
+{
+public:
+    PcmProducerThread(PcmRingBuffer * ring, int frames) : m_ring(ring), m_frames(frames) {}
+
+protected:
+    void run() override
+    {
+        QVector<float> block(1152 * 2);
+        int written = 0;
+        while (written < m_frames)
+        {
+            int n = qMin(1152, m_frames - written);
+            for (int i = 0; i < n; i++)
+            {
+                block[i * 2] = block[i * 2 + 1] = (float)(written + i);
+            }
+            int done = 0;
+            while (done < n)
+            {
+                int w = m_ring->write(block.constData() + done * 2, n - done);
+                if (w == 0) { QThread::yieldCurrentThread(); }
+                done += w;
+            }
+            written += n;
+        }
+    }
+
+private:
+    PcmRingBuffer * m_ring;
+    int m_frames;
+};
+
+//解码线程写、输出线程读，输出端按音频回调的节奏每次读480帧（48kHz下10毫秒），检查帧的顺序
+void LoopyBench::pcmRing()
+{
+    const int total = 48000 * 60;   //一分钟的音频
+    int errors = 0;
+
+    QBENCHMARK
+    {
+        PcmRingBuffer ring(48000 * 2, 2);
+        PcmProducerThread producer(&ring, total);
+        producer.start();
+
+        QVector<float> callback(480 * 2);
+        int read = 0;
+        errors = 0;
+        while (read < total)
+        {
+            int n = ring.read(callback.data(), 480);
+            if (n == 0) { QThread::yieldCurrentThread(); }
+            for (int i = 0; i < n; i++)
+            {
+                if (callback[i * 2] != (float)(read + i)) { errors++; }
+            }
+            read += n;
+        }
+        producer.wait();
+    }
+    QCOMPARE(errors, 0);
+}
+
+void LoopyBench::spectrum_data()
+{
+    QTest::addColumn<int>("fftSize");
+
+    QTest::newRow("1024") << 1024;
+    QTest::newRow("2048") << 2048;
+    QTest::newRow("4096") << 4096;
+}
+
+//频谱分析的一帧：加窗、实数FFT、分48个对数频带；界面每秒60帧，每帧的耗时乘60就是占用一个核的比例
+void LoopyBench::spectrum()
+{
+    QFETCH(int, fftSize);
+
+    Spectrum analysis(fftSize, 48);
+    analysis.setSampleRate(48000);
+
+    QVector<float> samples(fftSize);
+    for (int i = 0; i < fftSize; i++)
+    {
+        samples[i] = (float)(0.5 * std::sin(i * 0.13) + 0.25 * std::sin(i * 0.021));
+    }
+    QVector<float> bands(48);
+
+    QBENCHMARK
+    {
+        analysis.process(samples.constData(), bands.data());
+    }
+}
+
+//生成minutes分钟的MPEG-1 Layer III帧（44.1kHz立体声），只有帧头，帧体全0；vbr为true时每帧的码率随机
+static QByteArray mp3Frames(int minutes, bool vbr)
+{
+    static const int bitrates[] = { 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+
+    const int frames = minutes * 60 * 44100 / 1152;
+    QByteArray data;
+    data.reserve(frames * 1441);
+    quint32 seed = 1;
+    for (int i = 0; i < frames; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        const int index = vbr ? (int)((seed >> 16) % 14) : 8;
+        const int length = 144 * bitrates[index] * 1000 / 44100;
+
+        const int start = data.size();
+        data.append(QByteArray(length, '\0'));
+        data[start] = (char)0xFF;
+        data[start + 1] = (char)0xFB;
+        data[start + 2] = (char)((index + 1) << 4);
+    }
+    return data;
+}
+
+//LAME写的信息帧（128kbps），tag为Xing（VBR）或Info（固定码率），带总帧数和均匀的目录
+static QByteArray xingFrame(const char * tag, quint32 frames)
+{
+    QByteArray data(144 * 128 * 1000 / 44100, '\0');
+    data[0] = (char)0xFF;
+    data[1] = (char)0xFB;
+    data[2] = (char)(9 << 4);
+
+    //MPEG-1立体声，信息头在帧头和32字节的边信息之后
+    char * p = data.data() + 4 + 32;
+    memcpy(p, tag, 4);
+    p[7] = 0x1 | 0x4;
+    for (int i = 0; i < 4; i++) { p[8 + i] = (char)(frames >> (24 - 8 * i)); }
+    for (int i = 0; i < SeekIndex::TocSize; i++) { p[12 + i] = (char)(i * 256 / SeekIndex::TocSize); }
+    return data;
+}
+
+void LoopyBench::seekIndex_data()
+{
+    QTest::addColumn<QString>("mode");
+
+    QTest::newRow("scan-60min") << "scan";
+    QTest::newRow("xing-60min") << "xing";
+    QTest::newRow("info-60min") << "info";
+    QTest::newRow("cbr-60min") << "cbr";
+    QTest::newRow("xing-table-60min") << "xing-table";
+    QTest::newRow("locate") << "locate";
+}
+
+//导入时建立跳转索引的开销（没有信息头的VBR逐帧扫描，Xing、Info只读信息头，固定码率抽查），
+//第一次跳转时建立Xing偏移表的开销，以及一次跳转换算的开销
+void LoopyBench::seekIndex()
+{
+    QFETCH(QString, mode);
+
+    const quint32 frames = 60 * 60 * 44100 / 1152;
+    QByteArray data = mp3Frames(60, mode != "cbr" && mode != "info");
+    if (mode.startsWith("xing"))
+    {
+        data.prepend(xingFrame("Xing", frames));
+    }
+    else if (mode == "info")
+    {
+        data.prepend(xingFrame("Info", frames));
+    }
+
+    if (mode != "locate")
+    {
+        const bool table = mode == "xing-table";
+        SeekIndex index;
+        QBENCHMARK
+        {
+            index = SeekIndex::build(data.constData(), data.size(), 0, table);
+        }
+        const SeekIndex::Source source = mode == "scan" ? SeekIndex::Scan : (mode.startsWith("xing") ? SeekIndex::Xing : SeekIndex::Cbr);
+        QCOMPARE(index.source(), source);
+        QCOMPARE(index.hasTable(), table);
+
+        //有偏移表时每一项都正好是一帧的开头，返回的时间不晚于请求的时间
+        if (index.hasTable())
+        {
+            for (qint64 ms = 0; ms < index.duration(); ms += 60 * 1000)
+            {
+                const SeekIndex::Point point = index.locate(ms);
+                QVERIFY(point.ms <= ms);
+                QCOMPARE((uchar)data[(int)point.offset], (uchar)0xFF);
+            }
+        }
+        return;
+    }
+
+    const SeekIndex index = SeekIndex::build(data.constData(), data.size(), 0, true);
+    const qint64 duration = index.duration();
+    qint64 checksum = 0;
+    QBENCHMARK
+    {
+        for (qint64 ms = 0; ms < duration; ms += 997)
+        {
+            checksum += index.locate(ms).offset;
+        }
+    }
+    QVERIFY(checksum > 0);
+}
+
+QTEST_GUILESS_MAIN(LoopyBench)
+
+#include "tst_loopybench.moc"
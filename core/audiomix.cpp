@@ -0,0 +1,139 @@
+#include "audiomix.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOOPY_MIX_SSE2
+#endif
+
+static const float kHalfPi = 1.57079632679489662f;
+
+const char * AudioMix::implementation()
+{
+#ifdef LOOPY_MIX_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+#ifdef LOOPY_MIX_SSE2
+/*
+ * 4个采样对应的帧号和每次前进的帧数
+ *  单声道：4个采样是4帧 <0, 1, 2, 3>，每次前进4帧
+ *  双声道：4个采样是2帧 <0, 0, 1, 1>，每次前进2帧
+ *  增益由帧号直接算出，不累加步长，长时间渐变也没有误差积累
+ */
+static inline void laneFrames(int channels, __m128 & index, __m128 & advance)
+{
+    if (channels == 1)
+    {
+        index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        advance = _mm_set1_ps(4.0f);
+    }
+    else
+    {
+        index = _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f);
+        advance = _mm_set1_ps(2.0f);
+    }
+}
+#endif
+
+void AudioMix::ramp(float * samples, int frames, int channels, float from, float to)
+{
+    if (frames <= 0) { return; }
+    if (from == 1.0f && to == 1.0f) { return; }
+
+    const float step = (to - from) / frames;
+    const int count = frames * channels;
+    int i = 0;
+#ifdef LOOPY_MIX_SSE2
+    if (channels <= 2)
+    {
+        __m128 index, advance;
+        laneFrames(channels, index, advance);
+        const __m128 base = _mm_set1_ps(from);
+        const __m128 slope = _mm_set1_ps(step);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 gain = _mm_add_ps(base, _mm_mul_ps(slope, index));
+            _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), gain));
+            index = _mm_add_ps(index, advance);
+        }
+    }
+#endif
+    for (; i < count; i++)
+    {
+        samples[i] *= from + step * (i / channels);
+    }
+}
+
+void AudioMix::mixRamp(float * dst, const float * src, int frames, int channels, float from, float to)
+{
+    if (frames <= 0) { return; }
+
+    const float step = (to - from) / frames;
+    const int count = frames * channels;
+    int i = 0;
+#ifdef LOOPY_MIX_SSE2
+    if (channels <= 2)
+    {
+        __m128 index, advance;
+        laneFrames(channels, index, advance);
+        const __m128 base = _mm_set1_ps(from);
+        const __m128 slope = _mm_set1_ps(step);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 gain = _mm_add_ps(base, _mm_mul_ps(slope, index));
+            __m128 mixed = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), gain));
+            _mm_storeu_ps(dst + i, mixed);
+            index = _mm_add_ps(index, advance);
+        }
+    }
+#endif
+    for (; i < count; i++)
+    {
+        dst[i] += src[i] * (from + step * (i / channels));
+    }
+}
+
+void AudioMix::crossfade(float * out, const float * in, int frames, int channels, int offset, int length)
+{
+    if (length <= 0) { return; }
+
+    for (int done = 0; done < frames; )
+    {
+        // 每段的两端按等功率曲线取增益，段内线性变化
+        int n = qMin((int)CrossfadeSegment, frames - done);
+        float t0 = qBound(0.0f, float(offset + done) / length, 1.0f);
+        float t1 = qBound(0.0f, float(offset + done + n) / length, 1.0f);
+
+        float * o = out + (qint64)done * channels;
+        ramp(o, n, channels, std::cos(t0 * kHalfPi), std::cos(t1 * kHalfPi));
+        mixRamp(o, in + (qint64)done * channels, n, channels, std::sin(t0 * kHalfPi), std::sin(t1 * kHalfPi));
+        done += n;
+    }
+}
+
+void AudioMix::toInt16(const float * in, qint16 * out, int count)
+{
+    int i = 0;
+#ifdef LOOPY_MIX_SSE2
+    // 先限制范围：超出int32的值转换后是0x80000000，正的过载会变成负满幅
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(32767.0f);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128 a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi), scale);
+        __m128 b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), lo), hi), scale);
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128((__m128i *)(out + i), packed);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        float v = qBound(-1.0f, in[i], 1.0f) * 32767.0f;
+        out[i] = (qint16)std::lrint(v);
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef AUDIOMIX_H
+#define AUDIOMIX_H
+
+#include <QtGlobal>
+
+/*音频混音内核，音频引擎在解码线程和输出线程中调用
+ *  采样都是交错存储的float，frames为帧数，增益按帧线性变化，同一帧的各个声道增益相同
+ *      第i帧的增益 = from + (to - from) * i / frames，最后一帧之后正好到达to
+ *  单声道和双声道用SSE2一次处理4个采样（双声道是2帧），其他声道数走标量实现
+ *  交叉淡化是等功率的（淡出cos、淡入sin），按64帧一段用线性增益逼近曲线，每段调用上面的内核
+ *  所有函数都不分配内存，可以在音频回调中使用
+ */
+class AudioMix
+{
+public:
+    enum { CrossfadeSegment = 64 };
+
+    //原地乘上线性变化的增益，用于音量渐变和暂停、恢复时的淡出淡入
+    static void ramp(float * samples, int frames, int channels, float from, float to);
+
+    //dst += src * 线性变化的增益
+    static void mixRamp(float * dst, const float * src, int frames, int channels, float from, float to);
+
+    //等功率交叉淡化：out淡出、in淡入，结果写回out
+    //  offset是这段在整个淡化过程中的起始帧，length是整个淡化过程的帧数
+    static void crossfade(float * out, const float * in, int frames, int channels, int offset, int length);
+
+    //float转16位整数，先限制在-1~1再按32767缩放并就近取整
+    static void toInt16(const float * in, qint16 * out, int count);
+
+    static const char * implementation();   //当前使用的实现名称，用于日志
+};
+
+#endif // AUDIOMIX_H
@@ -0,0 +1,314 @@
+#include "contenthash.h"
+#include <QFile>
+#include <QtEndian>
+#include <cstring>
+#include "id3reader.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOOPY_HASH_SSE2
+#endif
+
+#if defined(LOOPY_HASH_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define LOOPY_HASH_AVX2
+#endif
+
+static const int kLanes = 8;
+static const int kStripesPerBlock = ContentHash::BlockSize / ContentHash::StripeSize;
+//映射失败时每次读入的字节数，必须是块大小的整数倍
+static const qint64 kReadChunk = 1024 * 1024;
+
+static const quint64 kPrime32 = 0x9E3779B1ULL;
+static const quint64 kPrime64_1 = 0x9E3779B185EBCA87ULL;
+static const quint64 kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const quint64 kPrime64_3 = 0x165667B19E3779F9ULL;
+
+//每个累加器通道的密钥，16字节对齐以便SIMD直接加载
+alignas(32) static const quint64 kSecret[kLanes] = {
+    0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL, 0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+    0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL, 0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL
+};
+
+typedef void (*AccumulateFunc)(quint64 * acc, const char * p, qint64 blocks);
+
+/*
+ * 标量实现，也是其他实现的参考定义
+ *  条带：第i个64位数据d和密钥异或得到x，acc[i] += 低32位(x) * 高32位(x)，acc[i ^ 1] += d
+ *  块：16个条带之后 acc ^= acc >> 47，acc ^= 密钥，acc *= kPrime32
+ */
+static inline void stripeScalar(quint64 * acc, const char * p)
+{
+    for (int i = 0; i < kLanes; i++)
+    {
+        quint64 d = qFromLittleEndian<quint64>(reinterpret_cast<const uchar *>(p + 8 * i));
+        quint64 x = d ^ kSecret[i];
+        acc[i ^ 1] += d;
+        acc[i] += (x & 0xFFFFFFFFULL) * (x >> 32);
+    }
+}
+
+static inline void scrambleScalar(quint64 * acc)
+{
+    for (int i = 0; i < kLanes; i++)
+    {
+        quint64 a = acc[i];
+        a ^= a >> 47;
+        a ^= kSecret[i];
+        acc[i] = a * kPrime32;
+    }
+}
+
+static void accumulateScalar(quint64 * acc, const char * p, qint64 blocks)
+{
+    for (qint64 b = 0; b < blocks; b++)
+    {
+        for (int s = 0; s < kStripesPerBlock; s++, p += ContentHash::StripeSize)
+        {
+            stripeScalar(acc, p);
+        }
+        scrambleScalar(acc);
+    }
+}
+
+#ifdef LOOPY_HASH_SSE2
+//SSE2实现：每个128位寄存器是两个通道，低32位*高32位用_mm_mul_epu32，acc[i ^ 1]的交换用shuffle
+static void accumulateSse2(quint64 * acc, const char * p, qint64 blocks)
+{
+    __m128i a[4];
+    __m128i k[4];
+    for (int j = 0; j < 4; j++)
+    {
+        a[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc) + j);
+        k[j] = _mm_load_si128(reinterpret_cast<const __m128i *>(kSecret) + j);
+    }
+    const __m128i prime = _mm_set1_epi32((int)kPrime32);
+
+    for (qint64 b = 0; b < blocks; b++)
+    {
+        for (int s = 0; s < kStripesPerBlock; s++, p += ContentHash::StripeSize)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p) + j);
+                __m128i x = _mm_xor_si128(d, k[j]);
+                __m128i product = _mm_mul_epu32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 3, 0, 1)));
+                __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+                a[j] = _mm_add_epi64(a[j], _mm_add_epi64(product, swapped));
+            }
+        }
+
+        //64位乘32位常数：低32位和高32位分别相乘，高位的积左移32位再相加
+        for (int j = 0; j < 4; j++)
+        {
+            __m128i x = _mm_xor_si128(a[j], _mm_srli_epi64(a[j], 47));
+            x = _mm_xor_si128(x, k[j]);
+            __m128i lo = _mm_mul_epu32(x, prime);
+            __m128i hi = _mm_mul_epu32(_mm_srli_epi64(x, 32), prime);
+            a[j] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+        }
+    }
+
+    for (int j = 0; j < 4; j++)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(acc) + j, a[j]);
+    }
+}
+#endif
+
+#ifdef LOOPY_HASH_AVX2
+//AVX2实现：和SSE2相同，每个256位寄存器是四个通道，只在运行时检测到AVX2时调用
+__attribute__((target("avx2")))
+static void accumulateAvx2(quint64 * acc, const char * p, qint64 blocks)
+{
+    __m256i a[2];
+    __m256i k[2];
+    for (int j = 0; j < 2; j++)
+    {
+        a[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc) + j);
+        k[j] = _mm256_load_si256(reinterpret_cast<const __m256i *>(kSecret) + j);
+    }
+    const __m256i prime = _mm256_set1_epi32((int)kPrime32);
+
+    for (qint64 b = 0; b < blocks; b++)
+    {
+        for (int s = 0; s < kStripesPerBlock; s++, p += ContentHash::StripeSize)
+        {
+            for (int j = 0; j < 2; j++)
+            {
+                __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p) + j);
+                __m256i x = _mm256_xor_si256(d, k[j]);
+                __m256i product = _mm256_mul_epu32(x, _mm256_shuffle_epi32(x, _MM_SHUFFLE(0, 3, 0, 1)));
+                __m256i swapped = _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+                a[j] = _mm256_add_epi64(a[j], _mm256_add_epi64(product, swapped));
+            }
+        }
+
+        for (int j = 0; j < 2; j++)
+        {
+            __m256i x = _mm256_xor_si256(a[j], _mm256_srli_epi64(a[j], 47));
+            x = _mm256_xor_si256(x, k[j]);
+            __m256i lo = _mm256_mul_epu32(x, prime);
+            __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), prime);
+            a[j] = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+        }
+    }
+
+    for (int j = 0; j < 2; j++)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc) + j, a[j]);
+    }
+}
+#endif
+
+struct Kernel
+{
+    AccumulateFunc accumulate;
+    const char * name;
+};
+
+//第一次使用时按CPU选择实现，之后不再检测
+static const Kernel & kernel()
+{
+    static const Kernel selected = []() -> Kernel {
+#ifdef LOOPY_HASH_AVX2
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) { return Kernel{ accumulateAvx2, "avx2" }; }
+#endif
+#ifdef LOOPY_HASH_SSE2
+        return Kernel{ accumulateSse2, "sse2" };
+#else
+        return Kernel{ accumulateScalar, "scalar" };
+#endif
+    }();
+    return selected;
+}
+
+const char * ContentHash::implementation()
+{
+    return kernel().name;
+}
+
+/*流式计算的状态：整块交给SIMD实现，最后不足一块的部分逐个条带处理，不足一个条带的部分补0*/
+class HashState
+{
+public:
+    HashState() : m_length(0), m_tail(nullptr), m_tailSize(0)
+    {
+        for (int i = 0; i < kLanes; i++) { m_acc[i] = kPrime64_1 * (i + 1); }
+    }
+
+    //追加数据，除了最后一次，size必须是块大小的整数倍
+    void update(const char * p, qint64 size)
+    {
+        qint64 blocks = size / ContentHash::BlockSize;
+        kernel().accumulate(m_acc, p, blocks);
+        m_tail = p + blocks * ContentHash::BlockSize;
+        m_tailSize = size - blocks * ContentHash::BlockSize;
+        m_length += size;
+    }
+
+    quint64 finish()
+    {
+        const char * p = m_tail;
+        qint64 size = m_length > 0 ? m_tailSize : 0;
+        while (size >= ContentHash::StripeSize)
+        {
+            stripeScalar(m_acc, p);
+            p += ContentHash::StripeSize;
+            size -= ContentHash::StripeSize;
+        }
+        if (size > 0)
+        {
+            char last[ContentHash::StripeSize] = {};
+            memcpy(last, p, size);
+            stripeScalar(m_acc, last);
+        }
+
+        //合并8个累加器，最后和xxHash64一样做一次雪崩
+        quint64 h = (quint64)m_length * kPrime64_1;
+        for (int i = 0; i < kLanes; i++)
+        {
+            quint64 a = m_acc[i] * kPrime64_2;
+            a = (a << 31) | (a >> 33);
+            h ^= a * kPrime64_1;
+            h = ((h << 27) | (h >> 37)) * kPrime64_1 + kPrime64_3;
+        }
+        h ^= h >> 33;
+        h *= kPrime64_2;
+        h ^= h >> 29;
+        h *= kPrime64_3;
+        h ^= h >> 32;
+
+        return h == 0 ? 1 : h;     //0保留为"没有哈希"
+    }
+
+private:
+    quint64 m_acc[kLanes];
+    qint64 m_length;
+    const char * m_tail;
+    qint64 m_tailSize;
+};
+
+quint64 ContentHash::hash(const char * data, qint64 size)
+{
+    HashState state;
+    state.update(data, size);
+    return state.finish();
+}
+
+/*
+ * 计算文件音频数据的哈希
+ *  先读开头10字节确定ID3v2标签的长度，再定位读最后128字节判断有没有ID3v1标签，剩下的就是音频数据
+ *  音频数据整段内存映射，由内核顺序预读；映射失败时按kReadChunk分块读入，流式计算
+ */
+bool ContentHash::hashFile(const QString & path, quint64 & hash)
+{
+    QFile qfile(path);
+    if (!qfile.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    const qint64 fileSize = qfile.size();
+    qint64 begin = 0;
+    qint64 end = fileSize;
+
+    char header[10];
+    if (qfile.read(header, sizeof(header)) == (qint64)sizeof(header))
+    {
+        begin = qMin(Id3Reader::tagSize(header, sizeof(header)), fileSize);
+    }
+
+    char tail[3];
+    if (end - begin >= 128 && qfile.seek(fileSize - 128) && qfile.read(tail, 3) == 3 && memcmp(tail, "TAG", 3) == 0)
+    {
+        end -= 128;
+    }
+
+    HashState state;
+    const qint64 size = end - begin;
+    uchar * mapped = size > 0 ? qfile.map(begin, size) : nullptr;
+    if (mapped)
+    {
+        state.update(reinterpret_cast<const char *>(mapped), size);
+        hash = state.finish();
+        qfile.unmap(mapped);
+        return true;
+    }
+
+    QByteArray buffer;
+    qfile.seek(begin);
+    qint64 remaining = size;
+    while (remaining > 0)
+    {
+        buffer = qfile.read(qMin(remaining, kReadChunk));
+        if (buffer.isEmpty()) { return false; }
+
+        state.update(buffer.constData(), buffer.size());
+        remaining -= buffer.size();
+        if (remaining > 0 && buffer.size() % BlockSize != 0) { return false; }
+    }
+    hash = state.finish();
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include <QString>
+
+/*音频内容哈希，用于导入时识别复制到不同文件夹中的同一首歌
+ *  只对音频数据计算哈希，不包括文件开头的ID3v2标签和文件末尾的ID3v1标签，改过标签的副本仍然算重复
+ *  非加密哈希，结构和XXH3的长输入部分类似：
+ *      8个64位累加器，每64字节（一个条带）做一次 乘法累加；每1024字节（一个块）做一次 打乱
+ *      累加器之间互不依赖，正好对应SIMD的各个通道
+ *  按CPU选择实现：AVX2（运行时检测）、SSE2、标量，三种实现的结果完全相同，可以混用保存的哈希值
+ *  结果0保留，表示没有计算过哈希
+ *  线程安全，在解析线程池中并发调用
+ */
+class ContentHash
+{
+public:
+    enum { StripeSize = 64, BlockSize = 1024 };
+
+    //计算一段内存的哈希
+    static quint64 hash(const char * data, qint64 size);
+
+    //计算mp3文件音频数据的哈希，跳过ID3标签；音频数据只内存映射，映射失败时分块读入；文件打不开返回false
+    static bool hashFile(const QString & path, quint64 & hash);
+
+    static const char * implementation();   //当前使用的实现名称，用于日志
+};
+
+#endif // CONTENTHASH_H
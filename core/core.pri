@@ -0,0 +1,13 @@
+# Link against the core library (core.pro). Include this from any target that uses it.
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+LOOPYCORE_DIR = $$shadowed($$PWD)
+win32:CONFIG(release, debug|release): LOOPYCORE_DIR = $$LOOPYCORE_DIR/release
+else:win32:CONFIG(debug, debug|release): LOOPYCORE_DIR = $$LOOPYCORE_DIR/debug
+
+LIBS += -L$$LOOPYCORE_DIR -lloopycore
+
+win32-g++|!win32: PRE_TARGETDEPS += $$LOOPYCORE_DIR/libloopycore.a
+else: PRE_TARGETDEPS += $$LOOPYCORE_DIR/loopycore.lib
@@ -0,0 +1,68 @@
+# GUI-free core of the player: songs and the song manager, the import worker and message queue,
+# tag/lyric parsing, MP3 seek indexes, the library index, the search index, loudness and waveform analysis,
+# audio mixing kernels and the PCM ring buffer, FFT spectrum analysis, track prefetching, startup timing, and logging.
+# Only depends on QtCore, so it can be used by command-line tools and benchmarks without a display.
+TEMPLATE = lib
+TARGET = loopycore
+
+QT       = core
+
+CONFIG += c++11 staticlib
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# Log statements below LOOPY_LOG_MIN_LEVEL (0 trace, 1 debug, 2 info, 3 warning, 4 error) are compiled out.
+# Every build, release included, compiles everything in so tracing can be switched on in production through
+# the LOOPY_LOG environment variable; a disabled statement costs one atomic load and a branch.
+# To strip them anyway, pass it on the qmake command line so all targets agree: qmake "DEFINES+=LOOPY_LOG_MIN_LEVEL=2"
+
+SOURCES += \
+    audiomix.cpp \
+    contenthash.cpp \
+    folderwatcher.cpp \
+    id3reader.cpp \
+    importpool.cpp \
+    libraryindex.cpp \
+    log.cpp \
+    loudness.cpp \
+    lrcparser.cpp \
+    lyriccache.cpp \
+    lyrictimeline.cpp \
+    realfft.cpp \
+    searchindex.cpp \
+    searchindexer.cpp \
+    seekindex.cpp \
+    seektablecache.cpp \
+    song.cpp \
+    spectrum.cpp \
+    startupprobe.cpp \
+    trackprefetcher.cpp \
+    waveform.cpp \
+    worker.cpp
+
+HEADERS += \
+    audiomix.h \
+    contenthash.h \
+    folderwatcher.h \
+    id3reader.h \
+    importpool.h \
+    libraryindex.h \
+    log.h \
+    loudness.h \
+    lrcparser.h \
+    lyriccache.h \
+    lyrictimeline.h \
+    mpmcqueue.h \
+    pcmringbuffer.h \
+    realfft.h \
+    searchindex.h \
+    searchindexer.h \
+    seekindex.h \
+    seektablecache.h \
+    song.h \
+    spectrum.h \
+    startupprobe.h \
+    trackprefetcher.h \
+    triplebuffer.h \
+    waveform.h \
+    worker.h
@@ -0,0 +1,90 @@
+#include "folderwatcher.h"
+#include <QDir>
+#include "log.h"
+
+//目录停止变化多久之后才扫描（毫秒）
+static const int kDefaultDelayMs = 1000;
+
+FolderWatcher::FolderWatcher(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(kDefaultDelayMs);
+
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &FolderWatcher::handle_watcher_directoryChanged);
+    connect(&m_timer, &QTimer::timeout, this, &FolderWatcher::handle_timer_timeout);
+}
+
+void FolderWatcher::setDelay(int ms)
+{
+    m_timer.setInterval(qMax(0, ms));
+}
+
+QSet<QString> FolderWatcher::watchedDirectories() const
+{
+    QSet<QString> result;
+    for (const QString & dir : m_watcher.directories())
+    {
+        result.insert(dir);
+    }
+    return result;
+}
+
+void FolderWatcher::watch(const QStringList & dirs)
+{
+    QSet<QString> known = watchedDirectories();
+
+    QStringList added;
+    for (const QString & dir : dirs)
+    {
+        if (known.contains(dir)) { continue; }
+        known.insert(dir);
+        added.append(dir);
+    }
+
+    if (!added.isEmpty())
+    {
+        m_watcher.addPaths(added);
+        LOG_DEBUG(Import) << "开始监视文件夹：" << added.size() << "个";
+    }
+}
+
+//每次变化都重新计时，目录安静下来之后才扫描
+void FolderWatcher::handle_watcher_directoryChanged(const QString & dir)
+{
+    m_pending.insert(dir);
+    m_timer.start();
+}
+
+void FolderWatcher::handle_timer_timeout()
+{
+    QSet<QString> known = watchedDirectories();
+
+    QSet<QString> pending;
+    pending.swap(m_pending);
+
+    for (const QString & dir : pending)
+    {
+        QDir folder(dir);
+        if (!folder.exists())
+        {
+            LOG_DEBUG(Import) << "文件夹已删除：" << dir;
+            emit changed(dir, true);
+            continue;
+        }
+
+        emit changed(dir, false);
+
+        //新建或者移进来的子目录还没有被监视，整个递归扫描一次
+        QStringList added;
+        for (const QString & name : folder.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+        {
+            const QString sub = folder.filePath(name);
+            if (known.contains(sub)) { continue; }
+
+            emit changed(sub, true);
+            added.append(sub);
+        }
+        watch(added);
+    }
+}
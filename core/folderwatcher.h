@@ -0,0 +1,45 @@
+#ifndef FOLDERWATCHER_H
+#define FOLDERWATCHER_H
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+/*文件夹监视类，在导入过的文件夹发生变化时触发增量扫描
+ *  内部使用QFileSystemWatcher监视目录（不监视单个文件，目录数量远少于歌曲数量）
+ *  拷贝大量文件时同一个目录会连续收到很多通知，先记下变化的目录，
+ *      停止变化m_delayMs毫秒后才合并发出changed信号，每个目录只扫描一次
+ *  发出信号时：
+ *      目录已经不存在          递归扫描，删除该目录下的所有歌曲
+ *      目录还在                只扫描这一层目录
+ *      其中新出现的子目录       递归扫描，并开始监视
+ *  注意：网络挂载目录上由其他机器做的修改，本机可能收不到通知
+ *  只在主线程使用
+ */
+class FolderWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FolderWatcher(QObject *parent = nullptr);
+
+    void watch(const QStringList & dirs);   //开始监视这些目录，已经在监视的忽略
+    void setDelay(int ms);                  //设置合并通知的等待时间
+
+signals:
+    void changed(const QString & dir, bool recursive);  //需要重新扫描的目录
+
+private slots:
+    void handle_watcher_directoryChanged(const QString & dir);
+    void handle_timer_timeout();
+
+private:
+    QSet<QString> watchedDirectories() const;
+
+    QFileSystemWatcher m_watcher;
+    QTimer m_timer;
+    QSet<QString> m_pending;        //等待扫描的目录
+};
+
+#endif // FOLDERWATCHER_H
@@ -0,0 +1,274 @@
+#include "id3reader.h"
+#include <QFile>
+#include <QVarLengthArray>
+#include <cstring>
+
+static const int kHeaderSize = 10;
+static const int kV1Size = 128;
+
+//4字节同步安全整数，每字节只用低7位
+static inline quint32 syncSafe(const uchar * p)
+{
+    return ((quint32)(p[0] & 0x7F) << 21) | ((quint32)(p[1] & 0x7F) << 14)
+            | ((quint32)(p[2] & 0x7F) << 7) | (quint32)(p[3] & 0x7F);
+}
+
+static inline quint32 bigEndian32(const uchar * p)
+{
+    return ((quint32)p[0] << 24) | ((quint32)p[1] << 16) | ((quint32)p[2] << 8) | (quint32)p[3];
+}
+
+static inline quint32 bigEndian24(const uchar * p)
+{
+    return ((quint32)p[0] << 16) | ((quint32)p[1] << 8) | (quint32)p[2];
+}
+
+//[p, end)中是否出现反同步插入的0xFF 0x00
+static bool hasUnsyncBytes(const char * p, const char * end)
+{
+    while (p < end)
+    {
+        const char * ff = static_cast<const char *>(memchr(p, 0xFF, end - p));
+        if (!ff || ff + 1 >= end) { return false; }
+        if (ff[1] == 0) { return true; }
+        p = ff + 1;
+    }
+    return false;
+}
+
+//还原反同步：0xFF后面插入的0x00去掉，写到out，返回写入的字节数（out至少和输入一样长）
+static int removeUnsync(const char * p, const char * end, char * out)
+{
+    char * q = out;
+    while (p < end)
+    {
+        char c = *p++;
+        *q++ = c;
+        if ((uchar)c == 0xFF && p < end && *p == 0) { p++; }
+    }
+    return (int)(q - out);
+}
+
+/*
+ * 解码文本帧的内容
+ *  第一个字节是编码，后面是文本；遇到结束符'\0'（UTF-16为两个字节的0）就停止，只取第一个值
+ *  UTF-16逐个码元写进预先分配好长度的QString，不经过中间缓冲区
+ */
+static QString decodeText(const char * p, const char * end)
+{
+    if (p >= end) { return QString(); }
+
+    const uchar encoding = (uchar)*p++;
+    if (encoding == 0 || encoding == 3)
+    {
+        const char * nul = static_cast<const char *>(memchr(p, 0, end - p));
+        int size = (int)((nul ? nul : end) - p);
+        QString text = encoding == 0 ? QString::fromLatin1(p, size) : QString::fromUtf8(p, size);
+        return text.trimmed();
+    }
+    if (encoding != 1 && encoding != 2) { return QString(); }
+
+    bool bigEndian = encoding == 2;
+    if (encoding == 1 && end - p >= 2)
+    {
+        //带BOM的UTF-16，BOM决定字节序
+        if ((uchar)p[0] == 0xFE && (uchar)p[1] == 0xFF) { bigEndian = true; p += 2; }
+        else if ((uchar)p[0] == 0xFF && (uchar)p[1] == 0xFE) { bigEndian = false; p += 2; }
+    }
+
+    int units = (int)((end - p) / 2);
+    for (int i = 0; i < units; i++)
+    {
+        if (p[2 * i] == 0 && p[2 * i + 1] == 0) { units = i; break; }
+    }
+
+    QString text(units, Qt::Uninitialized);
+    QChar * out = text.data();
+    const uchar * in = reinterpret_cast<const uchar *>(p);
+    for (int i = 0; i < units; i++, in += 2)
+    {
+        out[i] = bigEndian ? QChar((ushort)((in[0] << 8) | in[1])) : QChar((ushort)((in[1] << 8) | in[0]));
+    }
+    return text.trimmed();
+}
+
+qint64 Id3Reader::tagSize(const char * header, qint64 size)
+{
+    const uchar * h = reinterpret_cast<const uchar *>(header);
+    if (size < kHeaderSize || memcmp(header, "ID3", 3) != 0) { return 0; }
+    if (h[3] < 2 || h[3] > 4 || h[4] == 0xFF) { return 0; }
+    if ((h[6] | h[7] | h[8] | h[9]) & 0x80) { return 0; }
+
+    qint64 total = kHeaderSize + syncSafe(h + 6);
+    if (h[3] == 4 && (h[5] & 0x10)) { total += kHeaderSize; }    //v2.4的尾部
+    return total;
+}
+
+/*
+ * 解析ID3v2标签
+ *  按版本确定帧头格式：v2.2为3字节ID + 3字节长度；v2.3为4字节ID + 4字节长度 + 2字节标志；
+ *  v2.4和v2.3相同，但帧长度是同步安全整数，帧标志的位置也不同
+ *  只取三个文本帧，其他帧按长度跳过
+ */
+bool Id3Reader::parseV2(const char * data, qint64 size, Result & result)
+{
+    qint64 total = tagSize(data, size);
+    if (total == 0) { return false; }
+
+    const uchar * h = reinterpret_cast<const uchar *>(data);
+    const int version = h[3];
+    const uchar flags = h[5];
+
+    const char * p = data + kHeaderSize;
+    const char * end = data + qMin(size, (qint64)kHeaderSize + syncSafe(h + 6));
+
+    //v2.2/v2.3的标签级反同步作用于整个标签（包括帧头），真的有插入字节时先整体还原
+    QByteArray restored;
+    if ((flags & 0x80) && version < 4 && hasUnsyncBytes(p, end))
+    {
+        restored.resize((int)(end - p));
+        restored.resize(removeUnsync(p, end, restored.data()));
+        p = restored.constData();
+        end = p + restored.size();
+    }
+
+    //跳过扩展头部：v2.3的长度不包括自身的4字节，v2.4的长度是同步安全整数并且包括自身
+    if ((flags & 0x40) && version >= 3 && end - p >= 4)
+    {
+        const uchar * e = reinterpret_cast<const uchar *>(p);
+        qint64 extended = version == 3 ? (qint64)bigEndian32(e) + 4 : (qint64)syncSafe(e);
+        if (extended > end - p) { return true; }
+        p += extended;
+    }
+
+    const int frameHeaderSize = version == 2 ? 6 : 10;
+
+    while (end - p >= frameHeaderSize && !result.isComplete())
+    {
+        //遇到填充（全0）说明后面没有帧了
+        if (*p == 0) { break; }
+
+        const uchar * f = reinterpret_cast<const uchar *>(p);
+        qint64 frameSize = 0;
+        uchar formatFlags = 0;
+        if (version == 2)
+        {
+            frameSize = bigEndian24(f + 3);
+        }
+        else
+        {
+            frameSize = version == 4 ? syncSafe(f + 4) : bigEndian32(f + 4);
+            formatFlags = f[9];
+        }
+
+        const char * body = p + frameHeaderSize;
+        if (frameSize > end - body) { break; }
+        const char * bodyEnd = body + frameSize;
+
+        QString * field = nullptr;
+        if (version == 2)
+        {
+            if (memcmp(p, "TT2", 3) == 0) { field = &result.title; }
+            else if (memcmp(p, "TP1", 3) == 0) { field = &result.artist; }
+            else if (memcmp(p, "TAL", 3) == 0) { field = &result.album; }
+        }
+        else
+        {
+            if (memcmp(p, "TIT2", 4) == 0) { field = &result.title; }
+            else if (memcmp(p, "TPE1", 4) == 0) { field = &result.artist; }
+            else if (memcmp(p, "TALB", 4) == 0) { field = &result.album; }
+        }
+        p = bodyEnd;
+
+        if (!field || !field->isEmpty()) { continue; }
+
+        //压缩和加密的帧不解析
+        bool compressed = version == 4 ? (formatFlags & 0x0C) != 0 : (formatFlags & 0xC0) != 0;
+        if (compressed) { continue; }
+
+        //v2.3的分组标识占1字节，v2.4的分组标识和数据长度指示分别占1字节和4字节
+        if (version == 3 && (formatFlags & 0x20)) { body++; }
+        if (version == 4 && (formatFlags & 0x40)) { body++; }
+        if (version == 4 && (formatFlags & 0x01)) { body += 4; }
+        if (body >= bodyEnd) { continue; }
+
+        //v2.4的反同步按帧标记（标签头的标志表示所有帧都反同步过），文本帧很短，还原到栈上
+        if (version == 4 && ((formatFlags & 0x02) || (flags & 0x80)) && hasUnsyncBytes(body, bodyEnd))
+        {
+            QVarLengthArray<char, 256> buffer((int)(bodyEnd - body));
+            int restoredSize = removeUnsync(body, bodyEnd, buffer.data());
+            *field = decodeText(buffer.constData(), buffer.constData() + restoredSize);
+            continue;
+        }
+
+        *field = decodeText(body, bodyEnd);
+    }
+
+    return true;
+}
+
+//ID3v1的字段是定长的Latin-1文本，不足的部分用'\0'或空格填充
+static QString v1Field(const char * p, int size)
+{
+    const char * nul = static_cast<const char *>(memchr(p, 0, size));
+    if (nul) { size = (int)(nul - p); }
+    return QString::fromLatin1(p, size).trimmed();
+}
+
+bool Id3Reader::parseV1(const char * data, qint64 size, Result & result)
+{
+    if (size < kV1Size || memcmp(data, "TAG", 3) != 0) { return false; }
+
+    if (result.title.isEmpty()) { result.title = v1Field(data + 3, 30); }
+    if (result.artist.isEmpty()) { result.artist = v1Field(data + 33, 30); }
+    if (result.album.isEmpty()) { result.album = v1Field(data + 63, 30); }
+    return true;
+}
+
+/*
+ * 读取文件的标签
+ *  ID3v2：先读头部，确认有标签后只映射标签区域；映射失败时只读入这一段
+ *  ID3v1：三个字段还没找全时，定位到文件最后128字节读一次
+ */
+bool Id3Reader::readFile(const QString & path, Result & result)
+{
+    QFile qfile(path);
+    if (!qfile.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    const qint64 fileSize = qfile.size();
+
+    char header[kHeaderSize];
+    if (qfile.read(header, kHeaderSize) == kHeaderSize)
+    {
+        qint64 total = qMin(tagSize(header, kHeaderSize), fileSize);
+        if (total > kHeaderSize)
+        {
+            uchar * mapped = qfile.map(0, total);
+            if (mapped)
+            {
+                parseV2(reinterpret_cast<const char *>(mapped), total, result);
+                qfile.unmap(mapped);
+            }
+            else
+            {
+                qfile.seek(0);
+                QByteArray buffer = qfile.read(total);
+                parseV2(buffer.constData(), buffer.size(), result);
+            }
+        }
+    }
+
+    if (!result.isComplete() && fileSize >= kV1Size && qfile.seek(fileSize - kV1Size))
+    {
+        char tail[kV1Size];
+        if (qfile.read(tail, kV1Size) == kV1Size)
+        {
+            parseV1(tail, kV1Size, result);
+        }
+    }
+
+    return true;
+}
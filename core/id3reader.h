@@ -0,0 +1,43 @@
+#ifndef ID3READER_H
+#define ID3READER_H
+
+#include <QString>
+
+/*ID3标签读取器，从mp3文件中读取歌名、歌手、专辑
+ *  只读文件开头的ID3v2标签区域和最后128字节的ID3v1标签，不读音频数据
+ *      先读10字节的ID3v2头部得到标签长度，再只内存映射标签区域（映射失败时只读入这一段）
+ *      逐个帧头跳转，只访问TIT2/TPE1/TALB（v2.2为TT2/TP1/TAL）三个帧的内容，
+ *      封面等大帧的内容不会被访问到，三个字段都找到后立即停止
+ *      ID3v1用一次定位读取读到栈上的缓冲区，只补充ID3v2中没有的字段
+ *  支持ID3v2.2/2.3/2.4：扩展头部、v2.4的同步安全帧长度和数据长度指示、标签级和帧级的反同步
+ *      压缩和加密的帧直接跳过
+ *      反同步只在确实出现0xFF 0x00时才还原到临时缓冲区，否则直接在映射的内存上解析
+ *  文本编码：ISO-8859-1、带BOM的UTF-16、UTF-16BE、UTF-8，直接从原始字节解码成QString，没有中间拷贝
+ *      v2.4一个文本帧中用'\0'分隔的多个值只取第一个
+ */
+class Id3Reader
+{
+public:
+    struct Result
+    {
+        QString title;
+        QString artist;
+        QString album;
+
+        bool isComplete() const { return !title.isEmpty() && !artist.isEmpty() && !album.isEmpty(); }
+    };
+
+    //读取mp3文件的标签，文件打不开返回false；没有标签时返回true，结果为空
+    static bool readFile(const QString & path, Result & result);
+
+    //解析内存中完整的ID3v2标签（从"ID3"头部开始），返回是否是有效的ID3v2标签
+    static bool parseV2(const char * data, qint64 size, Result & result);
+
+    //解析128字节的ID3v1标签（从"TAG"开始），只填写result中还为空的字段
+    static bool parseV1(const char * data, qint64 size, Result & result);
+
+    //ID3v2头部声明的整个标签长度（包括头部和尾部），不是ID3v2头部返回0
+    static qint64 tagSize(const char * header, qint64 size);
+};
+
+#endif // ID3READER_H
@@ -0,0 +1,149 @@
+#include "importpool.h"
+
+//解析线程，只负责运行线程池的主循环
+class ImportThread : public QThread
+{
+public:
+    ImportThread(ImportPool * pool, int lane) : m_pool(pool), m_lane(lane) {}
+
+protected:
+    void run() override { m_pool->run(m_lane); }
+
+private:
+    ImportPool * m_pool;
+    int m_lane;
+};
+
+ImportPool::ImportPool(int threadCount)
+    : m_queued(0), m_stopping(false)
+{
+    if (threadCount <= 0) { threadCount = QThread::idealThreadCount(); }
+    if (threadCount <= 0) { threadCount = 1; }  //获取不到核心数时退化为单线程
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        m_lanes.append(new Lane);
+    }
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        QThread * thread = new ImportThread(this, i);
+        m_threads.append(thread);
+        thread->start();
+    }
+}
+
+ImportPool::~ImportPool()
+{
+    shutdown();
+    qDeleteAll(m_lanes);
+}
+
+/*
+ * 提交一批任务
+ *  把任务按连续区间均分给各个线程队列：第i个队列分到[i*n/L, (i+1)*n/L)
+ *      这样每个线程基本按提交顺序处理自己的区间，结果的乱序程度小，重排缓冲区也小
+ *  全部入队后再在m_idleMutex保护下增加计数并唤醒线程，保证睡眠线程不会错过唤醒
+ */
+void ImportPool::submit(const QVector<Task> & tasks)
+{
+    if (tasks.isEmpty()) { return; }
+
+    const int lanes = m_lanes.size();
+    const int count = tasks.size();
+    for (int i = 0; i < lanes; i++)
+    {
+        int begin = (qint64)count * i / lanes;
+        int end = (qint64)count * (i + 1) / lanes;
+        if (begin == end) { continue; }
+
+        Lane * lane = m_lanes[i];
+        QMutexLocker locker(&lane->mutex);
+        for (int j = begin; j < end; j++)
+        {
+            lane->tasks.push_back(tasks[j]);
+        }
+    }
+
+    QMutexLocker locker(&m_idleMutex);
+    m_queued.fetch_add(count);
+    m_wakeup.wakeAll();
+}
+
+void ImportPool::shutdown()
+{
+    {
+        QMutexLocker locker(&m_idleMutex);
+        if (m_stopping && m_threads.isEmpty()) { return; }
+        m_stopping = true;
+        m_wakeup.wakeAll();
+    }
+
+    for (auto thread : m_threads)
+    {
+        thread->wait();
+        delete thread;
+    }
+    m_threads.clear();
+
+    for (auto lane : m_lanes)
+    {
+        QMutexLocker locker(&lane->mutex);
+        lane->tasks.clear();
+    }
+    m_queued.store(0);
+}
+
+bool ImportPool::takeTask(int lane, Task & task)
+{
+    //1.自己队列的头部
+    {
+        Lane * own = m_lanes[lane];
+        QMutexLocker locker(&own->mutex);
+        if (!own->tasks.empty())
+        {
+            task = std::move(own->tasks.front());
+            own->tasks.pop_front();
+            m_queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    //2.依次窃取其他队列的尾部，从相邻的队列开始，避免所有空闲线程都去抢同一个队列
+    const int lanes = m_lanes.size();
+    for (int i = 1; i < lanes; i++)
+    {
+        Lane * victim = m_lanes[(lane + i) % lanes];
+        QMutexLocker locker(&victim->mutex);
+        if (!victim->tasks.empty())
+        {
+            task = std::move(victim->tasks.back());
+            victim->tasks.pop_back();
+            m_queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ImportPool::run(int lane)
+{
+    Task task;
+    forever
+    {
+        if (takeTask(lane, task))
+        {
+            task();
+            task = Task();  //尽早释放任务捕获的数据
+            continue;
+        }
+
+        QMutexLocker locker(&m_idleMutex);
+        if (m_stopping) { return; }
+        if (m_queued.load() == 0)
+        {
+            m_wakeup.wait(&m_idleMutex);
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef IMPORTPOOL_H
+#define IMPORTPOOL_H
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <QVector>
+#include <atomic>
+#include <deque>
+#include <functional>
+
+/*歌曲解析线程池，取代单个Worker线程逐个解析歌曲
+ *  线程数固定（有界），默认等于机器的逻辑核心数QThread::idealThreadCount()
+ *  每个解析线程拥有一个自己的任务队列（lane），提交的一批任务按连续区间均分到各个队列
+ *      线程优先从自己队列的头部取任务（顺序访问，局部性好）
+ *      自己的队列空了，就从其他线程队列的尾部窃取任务（work-stealing），保证负载均衡
+ *  每个队列各自一把锁，只有窃取时才会和别的线程竞争，竞争很小
+ *  没有任务时线程在条件变量上睡眠，不空转
+ */
+class ImportPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    explicit ImportPool(int threadCount = 0);   //threadCount <= 0 时使用逻辑核心数
+    ~ImportPool();
+
+    void submit(const QVector<Task> & tasks);   //提交一批任务，按连续区间分配到各个线程队列
+    void shutdown();                            //停止所有线程，未执行的任务直接丢弃
+    int threadCount() const { return m_lanes.size(); }
+
+private:
+    ImportPool(const ImportPool & other);
+    ImportPool & operator=(const ImportPool & other);
+
+    bool takeTask(int lane, Task & task);       //先取自己队列头部，取不到再窃取其他队列尾部
+    void run(int lane);                         //解析线程主循环
+
+    friend class ImportThread;
+
+private:
+    struct Lane
+    {
+        QMutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    QVector<Lane *> m_lanes;        //每个线程一个任务队列
+    QVector<QThread *> m_threads;   //解析线程
+    std::atomic<int> m_queued;      //所有队列中尚未被取走的任务总数
+    QMutex m_idleMutex;             //保护睡眠/唤醒，避免丢失唤醒
+    QWaitCondition m_wakeup;
+    bool m_stopping;
+};
+
+#endif // IMPORTPOOL_H
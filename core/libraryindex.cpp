@@ -0,0 +1,337 @@
+#include "libraryindex.h"
+#include "log.h"
+#include <QDir>
+#include <QHash>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+
+static const char kMagic[8] = { 'L', 'P', 'Y', 'I', 'D', 'X', '\0', '\0' };
+static const quint32 kByteOrder = 0x01020304;
+
+LibraryIndex::LibraryIndex()
+    : m_data(nullptr)
+    , m_header(nullptr)
+    , m_songs(nullptr)
+    , m_seekData(nullptr)
+    , m_strings(nullptr)
+{
+
+}
+
+LibraryIndex::~LibraryIndex()
+{
+    close();
+}
+
+QString LibraryIndex::defaultPath()
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dir);
+    return dir + "/library.idx";
+}
+
+/*
+ * 打开索引文件
+ *  映射整个文件，校验头部和各部分的长度，之后的读取都直接访问映射的内存
+ *  记录内的字符串引用和目录区间在读取时再逐个校验
+ *  接受版本MinVersion到Version，版本6的跳转表每项4字节
+ */
+bool LibraryIndex::open(const QString & path)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) { return false; }
+
+    qint64 size = m_file.size();
+    if (size < (qint64)sizeof(Header))
+    {
+        close();
+        return false;
+    }
+
+    m_data = m_file.map(0, size);
+    if (!m_data)
+    {
+        LOG_WARNING(General) << "歌曲库索引映射失败：" << path;
+        close();
+        return false;
+    }
+
+    const Header * header = reinterpret_cast<const Header *>(m_data);
+    if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0
+            || header->version < MinVersion || header->version > Version
+            || header->byteOrder != kByteOrder)
+    {
+        LOG_INFO(General) << "歌曲库索引格式不匹配，忽略：" << path;
+        close();
+        return false;
+    }
+
+    const qint64 seekBytes = header->version == 6 ? (qint64)header->seekBytes * sizeof(quint32) : header->seekBytes;
+    qint64 expected = sizeof(Header)
+            + (qint64)header->songCount * sizeof(SongRecord)
+            + seekBytes
+            + header->stringBytes;
+    if (expected != size)
+    {
+        LOG_WARNING(General) << "歌曲库索引长度不正确，忽略：" << path;
+        close();
+        return false;
+    }
+
+    const uchar * p = m_data + sizeof(Header);
+    m_songs = reinterpret_cast<const SongRecord *>(p);
+    p += header->songCount * sizeof(SongRecord);
+    m_seekData = p;
+    p += seekBytes;
+    m_strings = reinterpret_cast<const char *>(p);
+    m_header = header;
+    if (header->version != Version)
+    {
+        LOG_INFO(General) << "歌曲库索引是版本" << header->version << "，保存时升级：" << path;
+    }
+    return true;
+}
+
+void LibraryIndex::close()
+{
+    if (m_data)
+    {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+    m_file.close();
+    m_header = nullptr;
+    m_songs = nullptr;
+    m_seekData = nullptr;
+    m_strings = nullptr;
+}
+
+int LibraryIndex::size() const
+{
+    return m_header ? (int)m_header->songCount : 0;
+}
+
+//读取字符串引用，越界时返回空字符串
+QString LibraryIndex::string(const StringRef & ref) const
+{
+    if ((quint64)ref.offset + ref.size > m_header->stringBytes) { return QString(); }
+    return QString::fromUtf8(m_strings + ref.offset, (int)ref.size);
+}
+
+QString LibraryIndex::url(int index) const { return string(m_songs[index].url); }
+qint64 LibraryIndex::fileTime(int index) const { return m_songs[index].fileTime; }
+qint64 LibraryIndex::fileSize(int index) const { return m_songs[index].fileSize; }
+qint64 LibraryIndex::lyricTime(int index) const { return m_songs[index].lyricTime; }
+quint64 LibraryIndex::contentHash(int index) const { return m_songs[index].contentHash; }
+
+/*
+ * 读取跳转索引，目录区间越界时不带目录
+ *  版本6只取参数，不读跳转表；Xing的跳转索引不能用，返回无效的索引，由调用者重新建立（见seekIndexStale）
+ */
+SeekIndex LibraryIndex::seekIndex(int index) const
+{
+    const SeekRecord & record = m_songs[index].seek;
+    if (seekIndexStale(index)) { return SeekIndex(); }
+
+    QByteArray toc;
+    if (m_header->version != 6 && record.count > 0 && (quint64)record.first + record.count <= m_header->seekBytes)
+    {
+        toc = QByteArray(reinterpret_cast<const char *>(m_seekData) + record.first, (int)record.count);
+    }
+    return SeekIndex(SeekIndex::Source(record.source), (int)record.sampleRate, record.samplesPerFrame,
+                     record.frames, record.base, record.bytes, toc);
+}
+
+bool LibraryIndex::seekIndexStale(int index) const
+{
+    return m_header->version == 6 && m_songs[index].seek.source == SeekIndex::Xing;
+}
+
+Song * LibraryIndex::song(int index) const
+{
+    const SongRecord & record = m_songs[index];
+
+    Song * song = new Song(QUrl(string(record.url)),
+                           string(record.name),
+                           string(record.artist),
+                           string(record.album));
+    song->fileTime(record.fileTime);
+    song->fileSize(record.fileSize);
+    song->lyricTime(record.lyricTime);
+    song->lyricCount((int)record.lyricCount);
+    song->contentHash(record.contentHash);
+    song->loudness(record.loudness, record.truePeak);
+    song->seekIndex(seekIndex(index));
+
+    return song;
+}
+
+/*
+ * 读取旧版本索引中的歌曲路径
+ *  各个版本的头部都是32字节，前面的魔数、版本号、字节序标记和歌曲数位置不变，
+ *  每条记录的第一个字段都是路径的字符串引用，按版本算出记录长度和字符串区的位置就能取出所有路径
+ *      版本1       头部在歌曲数之后是歌词行数和字符串区字节数，记录64字节，记录之后是歌词表（每行16字节）
+ *      版本2、3    记录64字节
+ *      版本4       记录72字节（增加内容哈希）
+ *      版本5       记录80字节（增加响度和真峰值）
+ *  版本6起可以直接打开，不经过这里
+ *  只在格式升级后的第一次启动读取一次，直接整个读入内存
+ */
+bool LibraryIndex::readLegacyUrls(const QString & path, QStringList & urls)
+{
+    static const qint64 kLegacyHeaderSize = 32;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) { return false; }
+    const QByteArray data = file.readAll();
+    if (data.size() < kLegacyHeaderSize || memcmp(data.constData(), kMagic, sizeof(kMagic)) != 0) { return false; }
+
+    auto field = [&data](qint64 offset) -> quint32 {
+        quint32 value;
+        memcpy(&value, data.constData() + offset, sizeof(value));
+        return value;
+    };
+
+    if (field(12) != kByteOrder) { return false; }
+
+    const quint32 version = field(8);
+    const quint32 songCount = field(16);
+    qint64 recordSize = 0;
+    qint64 tableBytes = 0;
+    quint32 stringBytes = 0;
+    switch (version)
+    {
+    case 1:
+        recordSize = 64;
+        tableBytes = (qint64)field(20) * 16;
+        stringBytes = field(24);
+        break;
+    case 2:
+    case 3:
+        recordSize = 64;
+        stringBytes = field(20);
+        break;
+    case 4:
+        recordSize = 72;
+        stringBytes = field(20);
+        break;
+    case 5:
+        recordSize = 80;
+        stringBytes = field(20);
+        break;
+    default:
+        return false;
+    }
+
+    const qint64 stringsOffset = kLegacyHeaderSize + (qint64)songCount * recordSize + tableBytes;
+    if (stringsOffset + stringBytes != data.size())
+    {
+        LOG_WARNING(General) << "旧版本歌曲库索引长度不正确，忽略：" << path;
+        return false;
+    }
+
+    urls.clear();
+    urls.reserve((int)songCount);
+    for (quint32 i = 0; i < songCount; i++)
+    {
+        const qint64 record = kLegacyHeaderSize + (qint64)i * recordSize;
+        const quint32 offset = field(record);
+        const quint32 size = field(record + 4);
+        if ((quint64)offset + size > stringBytes) { continue; }
+        urls.append(QString::fromUtf8(data.constData() + stringsOffset + offset, (int)size));
+    }
+
+    LOG_INFO(General) << "读取版本" << version << "的歌曲库索引，歌曲数：" << urls.size();
+    return true;
+}
+
+/*
+ * 保存索引
+ *  先在内存中构造歌曲记录和字符串区，相同的字符串（歌手、专辑）只存一份
+ *  然后通过QSaveFile一次写出，提交时才替换原文件
+ */
+bool LibraryIndex::save(const QString & path, const SongManager & songs)
+{
+    QVector<SongRecord> songRecords;
+    QByteArray tocs;
+    QByteArray strings;
+    QHash<QString, StringRef> refs;
+
+    auto addString = [&strings, &refs](const QString & text) -> StringRef {
+        auto it = refs.constFind(text);
+        if (it != refs.constEnd()) { return it.value(); }
+
+        QByteArray utf8 = text.toUtf8();
+        StringRef ref = { (quint32)strings.size(), (quint32)utf8.size() };
+        strings.append(utf8);
+        refs.insert(text, ref);
+        return ref;
+    };
+
+    songRecords.reserve(songs.size());
+    for (SongId id = 0; id < songs.size(); id++)
+    {
+        SongRecord record;
+        memset(&record, 0, sizeof(record));
+        record.url = addString(songs.url(id).toString());
+        record.name = addString(songs.name(id));
+        record.artist = addString(songs.artist(id));
+        record.album = addString(songs.album(id));
+        record.fileTime = songs.fileTime(id);
+        record.fileSize = songs.fileSize(id);
+        record.lyricTime = songs.lyricTime(id);
+        record.lyricCount = (quint32)songs.lyricCount(id);
+        record.contentHash = songs.contentHash(id);
+        record.loudness = songs.loudness(id);
+        record.truePeak = songs.truePeak(id);
+
+        const SeekIndex & seek = songs.seekIndex(id);
+        if (seek.isValid())
+        {
+            record.seek.base = seek.base();
+            record.seek.bytes = seek.bytes();
+            record.seek.frames = seek.frames();
+            record.seek.first = (quint32)tocs.size();
+            record.seek.count = (quint32)seek.toc().size();
+            record.seek.sampleRate = (quint32)seek.sampleRate();
+            record.seek.samplesPerFrame = (quint16)seek.samplesPerFrame();
+            record.seek.source = (quint8)seek.source();
+            tocs += seek.toc();
+        }
+
+        songRecords.append(record);
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = Version;
+    header.byteOrder = kByteOrder;
+    header.songCount = (quint32)songRecords.size();
+    header.stringBytes = (quint32)strings.size();
+    header.seekBytes = (quint32)tocs.size();
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        LOG_WARNING(General) << "歌曲库索引保存失败：" << path;
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(songRecords.constData()), songRecords.size() * sizeof(SongRecord));
+    file.write(tocs);
+    file.write(strings);
+
+    if (!file.commit())
+    {
+        LOG_WARNING(General) << "歌曲库索引保存失败：" << path;
+        return false;
+    }
+
+    LOG_INFO(General) << "歌曲库索引已保存，歌曲数：" << songs.size();
+    return true;
+}
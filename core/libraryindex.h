@@ -0,0 +1,123 @@
+#ifndef LIBRARYINDEX_H
+#define LIBRARYINDEX_H
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "song.h"
+
+/*歌曲库索引文件，保存在应用数据目录下，下次启动时不用重新解析没有变化的歌曲
+ *  紧凑的二进制格式，按主机字节序存储，启动时整个文件内存映射，按需读取
+ *      Header                  魔数、版本号、字节序标记、各部分的数量
+ *      SongRecord[songCount]   每首歌一条定长记录：路径、歌名、歌手、专辑（字符串引用），
+ *                              媒体文件修改时间和大小、歌词文件修改时间、歌词行数、音频内容哈希，响度和真峰值，
+ *                              以及跳转索引的参数和它的目录在目录区中的区间
+ *      目录区                  有目录的跳转索引（Xing）的目录字节依次排列，每个100字节
+ *      字符串区                 所有字符串的UTF-8字节，字符串引用为<偏移, 长度>
+ *  版本2起歌词不再存入索引，和歌曲对象一样只记录行数，播放时从歌词文件按需加载
+ *  版本3起歌名、歌手、专辑优先取自ID3标签，格式没有变化，升级版本号让旧索引中的歌曲重新解析一次
+ *  版本4起每条记录增加音频内容哈希（没有计算过为0）
+ *  版本5起每条记录增加响度分析结果：综合响度（没有分析过为NaN）和真峰值
+ *  版本6起每条记录增加跳转索引（见SeekIndex），偏移表放在单独的跳转表中
+ *  版本7起不再保存偏移表（播放时第一次跳转才建立，见SeekTableCache），跳转表换成只放Xing目录的目录区，
+ *      Info头的文件改按固定码率处理；记录的格式不变
+ *  版本6的索引可以直接打开：其他字段照用，跳转索引只取参数；Xing的跳转索引是按目录换算的偏移表，不能还原出目录，
+ *      由seekIndexStale标出来，只重新建立跳转索引；下次保存时写成当前版本
+ *  更旧的索引（版本1到5）不能直接打开，readLegacyUrls从中取出上次的歌曲路径，全部重新解析一次，
+ *      解析完成后按当前版本保存；魔数或字节序不匹配、长度不对的索引当作无效
+ *  保存时先写临时文件再替换（QSaveFile），写到一半断电也不会损坏原来的索引
+ */
+class LibraryIndex
+{
+public:
+    enum { Version = 7, MinVersion = 6 };   //MinVersion：能直接打开的最旧版本
+
+    LibraryIndex();
+    ~LibraryIndex();
+
+    static QString defaultPath();   //应用数据目录下的library.idx
+
+    bool open(const QString & path);    //内存映射并校验索引文件
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    int size() const;                   //歌曲数量
+    QString url(int index) const;       //第index首歌的路径
+    qint64 fileTime(int index) const;
+    qint64 fileSize(int index) const;
+    qint64 lyricTime(int index) const;
+    quint64 contentHash(int index) const;
+    SeekIndex seekIndex(int index) const;
+    bool seekIndexStale(int index) const;   //跳转索引需要重新建立（版本6的Xing）
+    Song * song(int index) const;       //用第index条记录构造一个歌曲对象
+
+    //读取旧版本索引中按顺序排列的歌曲路径，不是可识别的旧版本时返回false
+    static bool readLegacyUrls(const QString & path, QStringList & urls);
+
+    //按歌曲ID的顺序（即添加顺序）保存歌曲管理类中的所有歌曲
+    static bool save(const QString & path, const SongManager & songs);
+
+private:
+    LibraryIndex(const LibraryIndex & other);
+    LibraryIndex & operator=(const LibraryIndex & other);
+
+    struct StringRef
+    {
+        quint32 offset;
+        quint32 size;
+    };
+
+    struct Header
+    {
+        char magic[8];
+        quint32 version;
+        quint32 byteOrder;
+        quint32 songCount;
+        quint32 stringBytes;
+        quint32 seekBytes;      //目录区的字节数；版本6为跳转表的项数
+        quint32 reserved;
+    };
+
+    struct SeekRecord
+    {
+        qint64 base;
+        qint64 bytes;
+        quint32 frames;
+        quint32 framesPerEntry; //版本6偏移表每项间隔的帧数，版本7起为0
+        quint32 first;          //目录在目录区中的字节区间[first, first + count)；版本6为偏移表在跳转表中的项区间
+        quint32 count;
+        quint32 sampleRate;
+        quint16 samplesPerFrame;
+        quint8 source;
+        quint8 reserved;
+    };
+
+    struct SongRecord
+    {
+        StringRef url;
+        StringRef name;
+        StringRef artist;
+        StringRef album;
+        qint64 fileTime;
+        qint64 fileSize;
+        qint64 lyricTime;
+        quint32 lyricCount;
+        quint32 reserved;
+        quint64 contentHash;
+        float loudness;
+        float truePeak;
+        SeekRecord seek;
+    };
+
+    QString string(const StringRef & ref) const;
+
+    QFile m_file;
+    uchar * m_data;
+    const Header * m_header;
+    const SongRecord * m_songs;
+    const uchar * m_seekData;           //目录区，版本6为跳转表
+    const char * m_strings;
+};
+
+#endif // LIBRARYINDEX_H
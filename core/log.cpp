@@ -0,0 +1,210 @@
+#include "log.h"
+#include <QThread>
+#include <cstdio>
+
+//日志环形缓冲区的容量（条数）
+static const int kLogRingCapacity = 8192;
+//后台线程没有日志可写时的睡眠间隔（毫秒）
+static const int kFlushIntervalMs = 20;
+
+//后台输出线程：不断从环形缓冲区取出日志写出，没有日志时短暂睡眠
+class LogFlusher : public QThread
+{
+public:
+    explicit LogFlusher(Logger * logger) : m_logger(logger), m_stopping(false) {}
+
+    void requestStop() { m_stopping.store(true); }
+
+protected:
+    void run() override
+    {
+        Logger::Record record;
+        forever
+        {
+            bool wrote = false;
+            while (m_logger->m_ring.try_pop(record))
+            {
+                m_logger->output(record);
+                wrote = true;
+            }
+
+            if (wrote) { fflush(m_logger->m_file); }
+            if (m_stopping.load()) { break; }
+            if (!wrote) { msleep(kFlushIntervalMs); }
+        }
+    }
+
+private:
+    Logger * m_logger;
+    std::atomic<bool> m_stopping;
+};
+
+Logger::Logger()
+    : m_ring(kLogRingCapacity)
+    , m_dropped(0)
+    , m_running(false)
+    , m_flusher(nullptr)
+    , m_file(stderr)
+{
+    m_clock.start();
+    for (int i = 0; i < CategoryCount; i++)
+    {
+        m_levels[i].store(Info);
+    }
+
+    QByteArray spec = qgetenv("LOOPY_LOG");
+    if (!spec.isEmpty())
+    {
+        configure(QString::fromLatin1(spec));
+    }
+}
+
+Logger::~Logger()
+{
+    stop();
+}
+
+Logger & Logger::getInstance()
+{
+    static Logger instance;
+    return instance;
+}
+
+void Logger::setLevel(Level level)
+{
+    for (int i = 0; i < CategoryCount; i++)
+    {
+        m_levels[i].store(level);
+    }
+}
+
+void Logger::setLevel(Category category, Level level)
+{
+    m_levels[category].store(level);
+}
+
+//按名字查找级别，找不到返回-1
+static int parseLevel(const QString & name)
+{
+    for (int level = Logger::Trace; level <= Logger::Off; level++)
+    {
+        if (name.compare(QLatin1String(Logger::levelName(level)), Qt::CaseInsensitive) == 0)
+        {
+            return level;
+        }
+    }
+    return -1;
+}
+
+/*
+ * 解析日志配置
+ *  "debug"                     所有类别设为debug
+ *  "import=trace,queue=debug"  分别设置某些类别
+ *  两种写法可以混用，从左到右依次生效
+ */
+void Logger::configure(const QString & spec)
+{
+    const QStringList items = spec.split(',', QString::SkipEmptyParts);
+    for (const QString & item : items)
+    {
+        int equal = item.indexOf('=');
+        if (equal < 0)
+        {
+            int level = parseLevel(item.trimmed());
+            if (level >= 0) { setLevel(Level(level)); }
+            continue;
+        }
+
+        QString name = item.left(equal).trimmed();
+        int level = parseLevel(item.mid(equal + 1).trimmed());
+        if (level < 0) { continue; }
+
+        for (int category = 0; category < CategoryCount; category++)
+        {
+            if (name.compare(QLatin1String(categoryName(category)), Qt::CaseInsensitive) == 0)
+            {
+                setLevel(Category(category), Level(level));
+            }
+        }
+    }
+}
+
+void Logger::start(const QString & filePath)
+{
+    if (m_running.load()) { return; }
+
+    if (!filePath.isEmpty())
+    {
+        FILE * file = fopen(filePath.toLocal8Bit().constData(), "a");
+        if (file) { m_file = file; }
+    }
+
+    m_flusher = new LogFlusher(this);
+    m_flusher->start(QThread::LowPriority);
+    m_running.store(true);
+}
+
+void Logger::stop()
+{
+    if (!m_running.exchange(false)) { return; }
+
+    m_flusher->requestStop();
+    m_flusher->wait();
+    delete m_flusher;
+    m_flusher = nullptr;
+
+    //停止之后才写入缓冲区的日志
+    Record record;
+    while (m_ring.try_pop(record))
+    {
+        output(record);
+    }
+    fflush(m_file);
+
+    if (m_file != stderr)
+    {
+        fclose(m_file);
+        m_file = stderr;
+    }
+}
+
+void Logger::write(Level level, Category category, const QString & text)
+{
+    Record record;
+    record.nsecs = m_clock.nsecsElapsed();
+    record.level = level;
+    record.category = category;
+    record.text = text;
+
+    if (!m_running.load())
+    {
+        output(record);
+        return;
+    }
+
+    if (!m_ring.try_push(std::move(record)))
+    {
+        m_dropped.fetch_add(1);
+    }
+}
+
+void Logger::output(const Record & record)
+{
+    fprintf(m_file, "[%10.6f] %-7s %-8s %s\n",
+            record.nsecs / 1e9,
+            levelName(record.level),
+            categoryName(record.category),
+            record.text.toUtf8().constData());
+}
+
+const char * Logger::levelName(int level)
+{
+    static const char * names[] = { "trace", "debug", "info", "warning", "error", "off" };
+    return (level >= Trace && level <= Off) ? names[level] : "?";
+}
+
+const char * Logger::categoryName(int category)
+{
+    static const char * names[] = { "general", "import", "lyrics", "playback", "queue", "analysis", "search" };
+    return (category >= 0 && category < CategoryCount) ? names[category] : "?";
+}
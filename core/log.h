@@ -0,0 +1,124 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <QDebug>
+#include <QString>
+#include <QElapsedTimer>
+#include <atomic>
+#include "mpmcqueue.h"
+
+class LogFlusher;
+
+/*日志类，取代热点路径上直接调用的qDebug
+ *  日志分级别Level和类别Category，每个类别有自己的运行时级别
+ *  两道开关：
+ *      编译期：低于LOOPY_LOG_MIN_LEVEL的日志语句整个被编译器删掉，参数也不会求值
+ *          默认为Trace（全部编译进来，发布版本也一样），需要彻底去掉时在qmake命令行定义，让所有目标一致，
+ *              比如 qmake "DEFINES+=LOOPY_LOG_MIN_LEVEL=2"；这样编出来的程序运行时也打不开被去掉的级别
+ *      运行期：低于类别当前级别的日志只有一次原子读和一次分支，不格式化字符串
+ *          默认Info，启动时从环境变量LOOPY_LOG读取，比如 LOOPY_LOG=trace 或 LOOPY_LOG=import=trace,playback=debug
+ *          这样发布版本里也可以临时打开跟踪
+ *  开启的日志格式化后写入无锁环形缓冲区，由后台线程异步写到标准错误或LOOPY_LOG_FILE指定的文件
+ *      缓冲区满时丢弃并计数，不会阻塞调用者
+ *      后台线程没有启动时（比如命令行工具）直接同步输出
+ *  用法：LOG_DEBUG(Import) << "读取歌曲文件: " << url;
+ */
+class Logger
+{
+public:
+    enum Level { Trace, Debug, Info, Warning, Error, Off };
+    enum Category { General, Import, Lyrics, Playback, Queue, Analysis, Search, CategoryCount };
+
+    struct Record
+    {
+        qint64 nsecs;       //距程序启动的纳秒数
+        int level;
+        int category;
+        QString text;
+    };
+
+private:
+    Logger();
+    Logger(const Logger & other);
+    ~Logger();
+
+public:
+    static Logger & getInstance();
+
+    bool isEnabled(Level level, Category category) const
+    {
+        return level >= m_levels[category].load(std::memory_order_relaxed);
+    }
+
+    void setLevel(Level level);                     //设置所有类别的级别
+    void setLevel(Category category, Level level);  //设置某个类别的级别
+    void configure(const QString & spec);           //按"级别"或"类别=级别,..."的格式设置
+
+    void start(const QString & filePath = QString()); //启动后台输出线程，filePath为空时输出到标准错误
+    void stop();                                    //输出剩余的日志并停止后台线程
+
+    void write(Level level, Category category, const QString & text);
+    quint64 dropped() const { return m_dropped.load(); }
+
+    static const char * levelName(int level);
+    static const char * categoryName(int category);
+
+private:
+    friend class LogFlusher;
+    void output(const Record & record);             //格式化一条记录并写出
+
+    MpmcQueue<Record> m_ring;                       //日志环形缓冲区
+    std::atomic<int> m_levels[CategoryCount];       //每个类别的运行时级别
+    std::atomic<quint64> m_dropped;                 //缓冲区满时丢弃的日志条数
+    std::atomic<bool> m_running;                    //后台线程是否在运行
+    QElapsedTimer m_clock;
+    LogFlusher * m_flusher;
+    FILE * m_file;
+};
+
+/*一条日志语句的临时对象，借用QDebug格式化各种类型，语句结束析构时写入Logger*/
+class LogStream
+{
+public:
+    LogStream(Logger::Level level, Logger::Category category)
+        : m_level(level), m_category(category), m_debug(new QDebug(&m_text)) {}
+
+    ~LogStream()
+    {
+        delete m_debug;     //QDebug析构时才把内容刷到m_text
+        Logger::getInstance().write(m_level, m_category, m_text);
+    }
+
+    template <typename T>
+    LogStream & operator<<(const T & value) { *m_debug << value; return *this; }
+
+private:
+    LogStream(const LogStream & other);
+    LogStream & operator=(const LogStream & other);
+
+    Logger::Level m_level;
+    Logger::Category m_category;
+    QString m_text;
+    QDebug * m_debug;
+};
+
+#ifndef LOOPY_LOG_MIN_LEVEL
+#define LOOPY_LOG_MIN_LEVEL 0
+#endif
+
+/*
+ * 级别是常量，低于编译期阈值时循环条件恒为假，循环体（包括<<后面的参数）整个被删掉
+ *  用只执行一次的for而不是if/else：宏展开是一条完整的语句，写在不带花括号的if/else里也不会和外面的else配错
+ */
+#define LOOPY_LOG(level, category) \
+    for (bool loopyLogOn = (level) >= LOOPY_LOG_MIN_LEVEL && Logger::getInstance().isEnabled((level), (category)); \
+         loopyLogOn; loopyLogOn = false) \
+        LogStream((level), (category))
+
+#define LOG_TRACE(category)     LOOPY_LOG(Logger::Trace, Logger::category)
+#define LOG_DEBUG(category)     LOOPY_LOG(Logger::Debug, Logger::category)
+#define LOG_INFO(category)      LOOPY_LOG(Logger::Info, Logger::category)
+#define LOG_WARNING(category)   LOOPY_LOG(Logger::Warning, Logger::category)
+#define LOG_ERROR(category)     LOOPY_LOG(Logger::Error, Logger::category)
+
+#endif // LOG_H
@@ -0,0 +1,299 @@
+#include "loudness.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOOPY_LOUDNESS_SSE2
+#endif
+
+const double LoudnessMeter::Silence = -70.0;
+
+static const double kPi = 3.14159265358979323846;
+static const int kTaps = 12;
+static const int kPhases = 4;
+
+//BS.1770附录2的4倍过采样多相FIR系数，kPhaseTaps[抽头][相位]，抽头已经按时间倒序排列，直接和按时间顺序的采样相乘
+static const float kPhaseTaps[kTaps][kPhases] = {
+    { -0.0083007812500f, -0.0189208984375f, -0.0291748046875f,  0.0017089843750f },
+    {  0.0148925781250f,  0.0330810546875f,  0.0292968750000f,  0.0109863281250f },
+    { -0.0266113281250f, -0.0582275390625f, -0.0517578125000f, -0.0196533203125f },
+    {  0.0476074218750f,  0.1015625000000f,  0.0891113281250f,  0.0332031250000f },
+    { -0.1022949218750f, -0.2003173828125f, -0.1665039062500f, -0.0594482421875f },
+    {  0.9721679687500f,  0.7797851562500f,  0.4650878906250f,  0.1373291015625f },
+    {  0.1373291015625f,  0.4650878906250f,  0.7797851562500f,  0.9721679687500f },
+    { -0.0594482421875f, -0.1665039062500f, -0.2003173828125f, -0.1022949218750f },
+    {  0.0332031250000f,  0.0891113281250f,  0.1015625000000f,  0.0476074218750f },
+    { -0.0196533203125f, -0.0517578125000f, -0.0582275390625f, -0.0266113281250f },
+    {  0.0109863281250f,  0.0292968750000f,  0.0330810546875f,  0.0148925781250f },
+    {  0.0017089843750f, -0.0291748046875f, -0.0189208984375f, -0.0083007812500f },
+};
+
+/*
+ * 构造
+ *  K计权滤波器系数按libebur128的方法由BS.1770给出的模拟参数做双线性变换，
+ *  48kHz时和标准中的系数一致，其他采样率同样适用
+ */
+LoudnessMeter::LoudnessMeter(int sampleRate, int channels)
+    : m_sampleRate(qMax(1, sampleRate))
+    , m_channels(qBound(1, channels, (int)MaxChannels))
+    , m_subBlockFrames(qMax(1, m_sampleRate / 10))
+    , m_subBlockFilled(0)
+    , m_recentCount(0)
+    , m_truePeak(0)
+{
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = std::tan(kPi * f0 / m_sampleRate);
+    double vh = std::pow(10.0, gain / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    m_shelf.b0 = (vh + vb * k / q + k * k) / a0;
+    m_shelf.b1 = 2.0 * (k * k - vh) / a0;
+    m_shelf.b2 = (vh - vb * k / q + k * k) / a0;
+    m_shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+    m_shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = std::tan(kPi * f0 / m_sampleRate);
+    a0 = 1.0 + k / q + k * k;
+    m_highpass.b0 = 1.0;
+    m_highpass.b1 = -2.0;
+    m_highpass.b2 = 1.0;
+    m_highpass.a1 = 2.0 * (k * k - 1.0) / a0;
+    m_highpass.a2 = (1.0 - k / q + k * k) / a0;
+
+    memset(m_state, 0, sizeof(m_state));
+    memset(m_subBlockSums, 0, sizeof(m_subBlockSums));
+    memset(m_recent, 0, sizeof(m_recent));
+    memset(m_history, 0, sizeof(m_history));
+
+    //5.1声道的顺序为 左 右 中 低音 左环绕 右环绕
+    for (int c = 0; c < MaxChannels; c++)
+    {
+        m_weights[c] = 1.0;
+    }
+    if (m_channels == 6)
+    {
+        m_weights[3] = 0.0;
+        m_weights[4] = 1.41;
+        m_weights[5] = 1.41;
+    }
+
+    m_blocks.reserve(4096);
+}
+
+const char * LoudnessMeter::implementation()
+{
+#ifdef LOOPY_LOUDNESS_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+//按子块边界切开，每段滤波、求平方和，再做真峰值
+void LoudnessMeter::addFrames(const float * samples, int frames)
+{
+    measurePeak(samples, frames);
+
+    while (frames > 0)
+    {
+        int n = qMin(frames, m_subBlockFrames - m_subBlockFilled);
+        filter(samples, n);
+        samples += n * m_channels;
+        frames -= n;
+
+        m_subBlockFilled += n;
+        if (m_subBlockFilled == m_subBlockFrames)
+        {
+            finishSubBlock();
+        }
+    }
+}
+
+//子块结束：加权均方值放入最近4个子块中，凑够4个就得到一个400ms的块（每100ms一个，重叠75%）
+void LoudnessMeter::finishSubBlock()
+{
+    double energy = 0;
+    for (int c = 0; c < m_channels; c++)
+    {
+        energy += m_weights[c] * m_subBlockSums[c] / m_subBlockFrames;
+        m_subBlockSums[c] = 0;
+    }
+    m_subBlockFilled = 0;
+
+    m_recent[m_recentCount % 4] = energy;
+    m_recentCount++;
+    if (m_recentCount >= 4)
+    {
+        m_blocks.append((m_recent[0] + m_recent[1] + m_recent[2] + m_recent[3]) / 4.0);
+    }
+}
+
+//一个双二阶滤波器的一步（转置直接II型），s为该声道该级的z1、z2
+static inline double biquadStep(double x, const double * coeffs, double * s)
+{
+    double y = coeffs[0] * x + s[0];
+    s[0] = coeffs[1] * x - coeffs[3] * y + s[1];
+    s[1] = coeffs[2] * x - coeffs[4] * y;
+    return y;
+}
+
+void LoudnessMeter::filter(const float * samples, int frames)
+{
+    const double * shelf = &m_shelf.b0;
+    const double * highpass = &m_highpass.b0;
+    int c = 0;
+
+#ifdef LOOPY_LOUDNESS_SSE2
+    //相邻两个声道一组，两个声道的采样正好在内存中相邻，一次读两个float转成两个double
+    const __m128d sb0 = _mm_set1_pd(m_shelf.b0), sb1 = _mm_set1_pd(m_shelf.b1), sb2 = _mm_set1_pd(m_shelf.b2);
+    const __m128d sa1 = _mm_set1_pd(m_shelf.a1), sa2 = _mm_set1_pd(m_shelf.a2);
+    const __m128d hb0 = _mm_set1_pd(m_highpass.b0), hb1 = _mm_set1_pd(m_highpass.b1), hb2 = _mm_set1_pd(m_highpass.b2);
+    const __m128d ha1 = _mm_set1_pd(m_highpass.a1), ha2 = _mm_set1_pd(m_highpass.a2);
+
+    for (; c + 1 < m_channels; c += 2)
+    {
+        __m128d s1 = _mm_set_pd(m_state[c + 1][0], m_state[c][0]);
+        __m128d s2 = _mm_set_pd(m_state[c + 1][1], m_state[c][1]);
+        __m128d s3 = _mm_set_pd(m_state[c + 1][2], m_state[c][2]);
+        __m128d s4 = _mm_set_pd(m_state[c + 1][3], m_state[c][3]);
+        __m128d sum = _mm_setzero_pd();
+
+        const float * p = samples + c;
+        for (int i = 0; i < frames; i++, p += m_channels)
+        {
+            __m128d x = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))));
+
+            __m128d y = _mm_add_pd(_mm_mul_pd(sb0, x), s1);
+            s1 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(sb1, x), _mm_mul_pd(sa1, y)), s2);
+            s2 = _mm_sub_pd(_mm_mul_pd(sb2, x), _mm_mul_pd(sa2, y));
+
+            __m128d z = _mm_add_pd(_mm_mul_pd(hb0, y), s3);
+            s3 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(hb1, y), _mm_mul_pd(ha1, z)), s4);
+            s4 = _mm_sub_pd(_mm_mul_pd(hb2, y), _mm_mul_pd(ha2, z));
+
+            sum = _mm_add_pd(sum, _mm_mul_pd(z, z));
+        }
+
+        double out[2];
+        _mm_storeu_pd(out, s1); m_state[c][0] = out[0]; m_state[c + 1][0] = out[1];
+        _mm_storeu_pd(out, s2); m_state[c][1] = out[0]; m_state[c + 1][1] = out[1];
+        _mm_storeu_pd(out, s3); m_state[c][2] = out[0]; m_state[c + 1][2] = out[1];
+        _mm_storeu_pd(out, s4); m_state[c][3] = out[0]; m_state[c + 1][3] = out[1];
+        _mm_storeu_pd(out, sum); m_subBlockSums[c] += out[0]; m_subBlockSums[c + 1] += out[1];
+    }
+#endif
+
+    for (; c < m_channels; c++)
+    {
+        double sum = 0;
+        const float * p = samples + c;
+        for (int i = 0; i < frames; i++, p += m_channels)
+        {
+            double y = biquadStep(*p, shelf, m_state[c]);
+            double z = biquadStep(y, highpass, m_state[c] + 2);
+            sum += z * z;
+        }
+        m_subBlockSums[c] += sum;
+    }
+}
+
+/*
+ * 真峰值
+ *  每个声道的历史采样（11个）和本段采样拼成一段连续的缓冲区，每个输出位置取12个采样，
+ *  和4个相位的系数同时乘加，得到4个过采样点
+ */
+void LoudnessMeter::measurePeak(const float * samples, int frames)
+{
+    if (frames <= 0) { return; }
+
+    const int history = kTaps - 1;
+    if (m_peakBuffer.size() < history + frames)
+    {
+        m_peakBuffer.resize(history + frames);
+    }
+    float * buffer = m_peakBuffer.data();
+
+    for (int c = 0; c < m_channels; c++)
+    {
+        memcpy(buffer, m_history[c], history * sizeof(float));
+        const float * p = samples + c;
+        for (int i = 0; i < frames; i++, p += m_channels)
+        {
+            buffer[history + i] = *p;
+        }
+
+        float peak = 0;
+#ifdef LOOPY_LOUDNESS_SSE2
+        const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        __m128 taps[kTaps];
+        for (int j = 0; j < kTaps; j++)
+        {
+            taps[j] = _mm_loadu_ps(kPhaseTaps[j]);
+        }
+
+        __m128 peaks = _mm_setzero_ps();
+        for (int i = 0; i < frames; i++)
+        {
+            const float * window = buffer + i;
+            __m128 out = _mm_setzero_ps();
+            for (int j = 0; j < kTaps; j++)
+            {
+                out = _mm_add_ps(out, _mm_mul_ps(_mm_set1_ps(window[j]), taps[j]));
+            }
+            peaks = _mm_max_ps(peaks, _mm_and_ps(out, signMask));
+        }
+
+        float lanes[4];
+        _mm_storeu_ps(lanes, peaks);
+        peak = qMax(qMax(lanes[0], lanes[1]), qMax(lanes[2], lanes[3]));
+#else
+        for (int i = 0; i < frames; i++)
+        {
+            const float * window = buffer + i;
+            for (int phase = 0; phase < kPhases; phase++)
+            {
+                float out = 0;
+                for (int j = 0; j < kTaps; j++)
+                {
+                    out += window[j] * kPhaseTaps[j][phase];
+                }
+                peak = qMax(peak, std::fabs(out));
+            }
+        }
+#endif
+
+        m_truePeak = qMax(m_truePeak, (double)peak);
+        memcpy(m_history[c], buffer + frames, history * sizeof(float));
+    }
+}
+
+//两道门限，见类说明
+double LoudnessMeter::integratedLoudness() const
+{
+    const double absoluteGate = std::pow(10.0, (Silence + 0.691) / 10.0);
+
+    double sum = 0;
+    int count = 0;
+    for (double energy : m_blocks)
+    {
+        if (energy > absoluteGate) { sum += energy; count++; }
+    }
+    if (count == 0) { return Silence; }
+
+    const double relativeGate = sum / count * 0.1;     //-10LU
+
+    sum = 0;
+    count = 0;
+    for (double energy : m_blocks)
+    {
+        if (energy > absoluteGate && energy > relativeGate) { sum += energy; count++; }
+    }
+    if (count == 0) { return Silence; }
+
+    return -0.691 + 10.0 * std::log10(sum / count);
+}
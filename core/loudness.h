@@ -0,0 +1,69 @@
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include <QVector>
+
+/*响度测量，按EBU R128 / ITU-R BS.1770计算一首歌的综合响度（LUFS）和真峰值
+ *  K计权：每个声道两级双二阶滤波（高架 + 高通），系数按采样率由模拟原型换算
+ *  门限：每100ms一个子块，连续4个子块组成一个400ms的块（重叠75%），
+ *      先去掉低于-70LUFS的块（绝对门限），再去掉比剩余平均响度低10LU的块（相对门限）
+ *  真峰值：4倍过采样，BS.1770附录2的48抽头多相FIR，取过采样后的最大绝对值
+ *  向量化：
+ *      滤波和平方和：相邻两个声道放在一个128位寄存器的两个double通道里同时计算（立体声正好一个寄存器）
+ *      真峰值：4个相位的输出放在一个128位寄存器的4个float通道里，每个抽头一次乘加，不需要水平求和
+ *      没有SSE2时使用结果相同的标量实现
+ *  所有缓冲区在构造时或第一次遇到更大的一段输入时分配，之后逐段送入数据不再分配内存
+ */
+class LoudnessMeter
+{
+public:
+    enum { MaxChannels = 8 };
+
+    LoudnessMeter(int sampleRate, int channels);
+
+    //送入一段交错存储的float采样（范围-1~1），frames为帧数
+    void addFrames(const float * samples, int frames);
+
+    //综合响度（LUFS），没有任何块超过门限（静音或者不足400ms）时返回Silence
+    double integratedLoudness() const;
+
+    //真峰值（线性值，1.0为满幅）
+    double truePeak() const { return m_truePeak; }
+
+    int sampleRate() const { return m_sampleRate; }
+    int channels() const { return m_channels; }
+
+    static const double Silence;
+    static const char * implementation();
+
+private:
+    struct Biquad
+    {
+        double b0, b1, b2, a1, a2;
+    };
+
+    void filter(const float * samples, int frames);
+    void measurePeak(const float * samples, int frames);
+    void finishSubBlock();
+
+private:
+    int m_sampleRate;
+    int m_channels;
+    Biquad m_shelf;                     //第一级：高架滤波
+    Biquad m_highpass;                  //第二级：高通滤波
+    double m_state[MaxChannels][4];     //每个声道两级滤波器的状态z1、z2
+    double m_weights[MaxChannels];      //声道权重，环绕声道1.41，低音声道0
+
+    int m_subBlockFrames;               //100ms的帧数
+    int m_subBlockFilled;               //当前子块已有的帧数
+    double m_subBlockSums[MaxChannels]; //当前子块每个声道的平方和
+    double m_recent[4];                 //最近4个子块的加权均方值
+    int m_recentCount;
+    QVector<double> m_blocks;           //所有400ms块的加权均方值
+
+    float m_history[MaxChannels][12];   //真峰值FIR每个声道最近的采样
+    QVector<float> m_peakBuffer;        //一个声道的历史采样 + 本段采样，复用
+    double m_truePeak;
+};
+
+#endif // LOUDNESS_H
@@ -0,0 +1,556 @@
+#include "lrcparser.h"
+#include <QFile>
+#include <QTextCodec>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOOPY_LRC_SSE2
+#endif
+
+#if defined(LOOPY_LRC_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define LOOPY_LRC_SSSE3
+#endif
+
+//一行最多识别的时间戳个数，超过的部分忽略
+static const int kMaxTimestampsPerLine = 32;
+//不是UTF-8时，GB18030的非法序列不超过合法序列的1/kGbMaxInvalidRatio才按GB18030解码
+static const int kGbMaxInvalidRatio = 20;
+
+bool LrcParser::parseFile(const QString & path, Result & result, Mode mode)
+{
+    QFile qfile(path);
+    if (!qfile.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    qint64 size = qfile.size();
+    if (size <= 0) { return true; }
+
+    //优先内存映射，映射失败（比如某些网络文件系统）时一次性读入
+    uchar * mapped = qfile.map(0, size);
+    if (mapped)
+    {
+        parse(reinterpret_cast<const char *>(mapped), size, result, mode);
+        qfile.unmap(mapped);
+    }
+    else
+    {
+        QByteArray buffer = qfile.readAll();
+        parse(buffer.constData(), buffer.size(), result, mode);
+    }
+
+    return true;
+}
+
+//从p开始连续的ASCII字节数
+static qint64 asciiPrefix(const uchar * p, qint64 size)
+{
+    qint64 i = 0;
+#ifdef LOOPY_LRC_SSE2
+    for (; i + 16 <= size; i += 16)
+    {
+        if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i))) != 0) { break; }
+    }
+#endif
+    while (i < size && p[i] < 0x80) { i++; }
+    return i;
+}
+
+//p处一个UTF-8多字节序列的长度，不合法返回0
+static inline int utf8SequenceLength(const uchar * p, const uchar * end)
+{
+    uchar c = p[0];
+    int length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC2 ? 2 : 0;
+    if (length == 0 || c > 0xF4 || end - p < length) { return 0; }
+    for (int i = 1; i < length; i++)
+    {
+        if ((p[i] & 0xC0) != 0x80) { return 0; }
+    }
+    //过长编码、代理区、超过U+10FFFF
+    if (c == 0xE0 && p[1] < 0xA0) { return 0; }
+    if (c == 0xED && p[1] >= 0xA0) { return 0; }
+    if (c == 0xF0 && p[1] < 0x90) { return 0; }
+    if (c == 0xF4 && p[1] >= 0x90) { return 0; }
+    return length;
+}
+
+static bool isValidUtf8Scalar(const uchar * p, const uchar * end)
+{
+    while (p < end)
+    {
+        p += asciiPrefix(p, end - p);
+        if (p >= end) { break; }
+
+        int length = utf8SequenceLength(p, end);
+        if (length == 0) { return false; }
+        p += length;
+    }
+    return true;
+}
+
+#ifdef LOOPY_LRC_SSSE3
+/*
+ * SSSE3实现：查表法（Keiser & Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte"）
+ *  每个字节和它前一个字节的高4位、前一个字节的低4位、本字节的高4位各查一次16项的表（pshufb），
+ *  三个结果按位与，非0的位就是某一种错误（太短、太长、过长编码、代理区、超出范围、多余的后续字节）
+ *  三、四字节序列的第3、4个字节另外按前2、3个字节是不是E0以上/F0以上的首字节检查
+ *  最后补一个全0的块，检查文件末尾被截断的序列
+ */
+static const uchar kTooShort = 1 << 0;
+static const uchar kTooLong = 1 << 1;
+static const uchar kOverlong3 = 1 << 2;
+static const uchar kTooLarge = 1 << 3;
+static const uchar kSurrogate = 1 << 4;
+static const uchar kOverlong2 = 1 << 5;
+static const uchar kTooLarge1000 = 1 << 6;
+static const uchar kOverlong4 = 1 << 6;
+static const uchar kTwoConts = 1 << 7;
+static const uchar kCarry = kTooShort | kTooLong | kTwoConts;
+
+alignas(16) static const uchar kByte1High[16] = {
+    kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+    kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+    kTooShort | kOverlong2,
+    kTooShort,
+    kTooShort | kOverlong3 | kSurrogate,
+    kTooShort | kTooLarge | kTooLarge1000 | kOverlong4
+};
+alignas(16) static const uchar kByte1Low[16] = {
+    kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+    kCarry | kOverlong2,
+    kCarry,
+    kCarry,
+    kCarry | kTooLarge,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000
+};
+alignas(16) static const uchar kByte2High[16] = {
+    kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooShort, kTooShort, kTooShort, kTooShort
+};
+
+__attribute__((target("ssse3")))
+static inline __m128i utf8BlockErrors(__m128i input, __m128i previous)
+{
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i byte1High = _mm_load_si128(reinterpret_cast<const __m128i *>(kByte1High));
+    const __m128i byte1Low = _mm_load_si128(reinterpret_cast<const __m128i *>(kByte1Low));
+    const __m128i byte2High = _mm_load_si128(reinterpret_cast<const __m128i *>(kByte2High));
+
+    __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+    __m128i special = _mm_and_si128(
+                _mm_and_si128(_mm_shuffle_epi8(byte1High, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+                              _mm_shuffle_epi8(byte1Low, _mm_and_si128(prev1, nibble))),
+                _mm_shuffle_epi8(byte2High, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+
+    __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+    __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80)));    //只有111_____会 >= 0x80
+    __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80)));   //只有1111____会 >= 0x80
+    __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
+    return _mm_xor_si128(must23, special);
+}
+
+__attribute__((target("ssse3")))
+static bool isValidUtf8Ssse3(const uchar * p, qint64 size)
+{
+    __m128i previous = _mm_setzero_si128();
+    __m128i error = _mm_setzero_si128();
+
+    qint64 i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        error = _mm_or_si128(error, utf8BlockErrors(input, previous));
+        previous = input;
+    }
+
+    //不足16字节的尾部补0（ASCII）
+    alignas(16) uchar tail[16] = { 0 };
+    memcpy(tail, p + i, (size_t)(size - i));
+    __m128i input = _mm_load_si128(reinterpret_cast<const __m128i *>(tail));
+    error = _mm_or_si128(error, utf8BlockErrors(input, previous));
+    error = _mm_or_si128(error, utf8BlockErrors(_mm_setzero_si128(), input));
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+#endif
+
+bool LrcParser::isValidUtf8(const char * data, qint64 size)
+{
+    const uchar * p = reinterpret_cast<const uchar *>(data);
+    qint64 ascii = asciiPrefix(p, size);
+    if (ascii == size) { return true; }
+    p += ascii;
+    size -= ascii;
+
+#ifdef LOOPY_LRC_SSSE3
+    static const bool ssse3 = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3") != 0;
+    }();
+    if (ssse3) { return isValidUtf8Ssse3(p, size); }
+#endif
+    return isValidUtf8Scalar(p, p + size);
+}
+
+/*
+ * 不是合法UTF-8的文本打分：同时按UTF-8和GB18030统计合法、非法的多字节序列个数
+ *  GB18030：双字节 首字节0x81~0xFE + 尾字节0x40~0x7E/0x80~0xFE，四字节 0x81~0xFE 0x30~0x39 0x81~0xFE 0x30~0x39
+ *  GB18030的非法序列足够少、并且不比UTF-8多时按GB18030，否则UTF-8的错误少就还按UTF-8（个别损坏的字节），
+ *  两者都不合适时按Latin-1
+ */
+static LrcParser::Encoding scoreLegacy(const uchar * begin, const uchar * end)
+{
+    int gbValid = 0;
+    int gbInvalid = 0;
+    for (const uchar * p = begin; p < end; )
+    {
+        p += asciiPrefix(p, end - p);
+        if (p >= end) { break; }
+
+        uchar c = p[0];
+        if (c >= 0x81 && c <= 0xFE && end - p >= 2)
+        {
+            uchar c2 = p[1];
+            if ((c2 >= 0x40 && c2 <= 0x7E) || (c2 >= 0x80 && c2 <= 0xFE))
+            {
+                gbValid++;
+                p += 2;
+                continue;
+            }
+            if (c2 >= 0x30 && c2 <= 0x39 && end - p >= 4
+                    && p[2] >= 0x81 && p[2] <= 0xFE && p[3] >= 0x30 && p[3] <= 0x39)
+            {
+                gbValid++;
+                p += 4;
+                continue;
+            }
+        }
+        gbInvalid++;
+        p++;
+    }
+
+    int utf8Valid = 0;
+    int utf8Invalid = 0;
+    for (const uchar * p = begin; p < end; )
+    {
+        p += asciiPrefix(p, end - p);
+        if (p >= end) { break; }
+
+        int length = utf8SequenceLength(p, end);
+        if (length > 0) { utf8Valid++; p += length; }
+        else { utf8Invalid++; p++; }
+    }
+
+    if (gbValid > 0 && gbInvalid * kGbMaxInvalidRatio <= gbValid && gbInvalid <= utf8Invalid)
+    {
+        return LrcParser::Gb18030;
+    }
+    if (utf8Valid > 0 && utf8Invalid * kGbMaxInvalidRatio <= utf8Valid)
+    {
+        return LrcParser::Utf8;
+    }
+    return LrcParser::Latin1;
+}
+
+LrcParser::Encoding LrcParser::detectEncoding(const char * data, qint64 size, int & bomSize)
+{
+    const uchar * p = reinterpret_cast<const uchar *>(data);
+    bomSize = 0;
+    if (size >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF)
+    {
+        bomSize = 3;
+        return Utf8;
+    }
+    if (size >= 2 && p[0] == 0xFF && p[1] == 0xFE)
+    {
+        bomSize = 2;
+        return Utf16LE;
+    }
+    if (size >= 2 && p[0] == 0xFE && p[1] == 0xFF)
+    {
+        bomSize = 2;
+        return Utf16BE;
+    }
+
+    if (isValidUtf8(data, size)) { return Utf8; }
+    return scoreLegacy(p, p + size);
+}
+
+//UTF-16文本逐个码元转成UTF-8，不经过QString；落单的代理码元转成U+FFFD
+static QByteArray utf16ToUtf8(const uchar * p, qint64 size, bool bigEndian)
+{
+    QByteArray out;
+    out.reserve((int)(size / 2 * 3));
+    qint64 count = size / 2;
+    auto unit = [&](qint64 i) -> uint {
+        return bigEndian ? (uint)(p[2 * i] << 8 | p[2 * i + 1]) : (uint)(p[2 * i + 1] << 8 | p[2 * i]);
+    };
+
+    for (qint64 i = 0; i < count; i++)
+    {
+        uint c = unit(i);
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < count && unit(i + 1) >= 0xDC00 && unit(i + 1) <= 0xDFFF)
+        {
+            c = 0x10000 + ((c - 0xD800) << 10) + (unit(++i) - 0xDC00);
+        }
+        else if (c >= 0xD800 && c <= 0xDFFF)
+        {
+            c = 0xFFFD;
+        }
+
+        if (c < 0x80)
+        {
+            out.append((char)c);
+        }
+        else if (c < 0x800)
+        {
+            out.append((char)(0xC0 | c >> 6));
+            out.append((char)(0x80 | (c & 0x3F)));
+        }
+        else if (c < 0x10000)
+        {
+            out.append((char)(0xE0 | c >> 12));
+            out.append((char)(0x80 | (c >> 6 & 0x3F)));
+            out.append((char)(0x80 | (c & 0x3F)));
+        }
+        else
+        {
+            out.append((char)(0xF0 | c >> 18));
+            out.append((char)(0x80 | (c >> 12 & 0x3F)));
+            out.append((char)(0x80 | (c >> 6 & 0x3F)));
+            out.append((char)(0x80 | (c & 0x3F)));
+        }
+    }
+    return out;
+}
+
+/*文本解码器，把一行歌词或一个标签值按文件的编码直接解码成QString
+ *  纯ASCII的文本不需要知道编码；第一次遇到非ASCII文本时才检测整个文件的编码，之后都按检测结果解码
+ *  GB18030中换行符和'[' ']' ':'这些ASCII字节不会出现在多字节序列里，按字节切出的行可以单独解码
+ */
+class TextDecoder
+{
+public:
+    TextDecoder(const char * data, qint64 size, LrcParser::Encoding * known)
+        : m_data(data), m_size(size), m_detected(known != nullptr)
+        , m_encoding(known ? *known : LrcParser::Utf8), m_codec(nullptr)
+    {
+        if (m_detected) { selectCodec(); }
+    }
+
+    QString decode(const char * p, int size)
+    {
+        if (!m_detected)
+        {
+            if (asciiPrefix(reinterpret_cast<const uchar *>(p), size) == size) { return QString::fromLatin1(p, size); }
+
+            int bomSize = 0;
+            m_encoding = LrcParser::detectEncoding(m_data, m_size, bomSize);
+            m_detected = true;
+            selectCodec();
+        }
+
+        switch (m_encoding)
+        {
+        case LrcParser::Gb18030:
+            if (m_codec) { return m_codec->toUnicode(p, size); }
+            break;
+        case LrcParser::Latin1:
+            return QString::fromLatin1(p, size);
+        default:
+            break;
+        }
+        return QString::fromUtf8(p, size);
+    }
+
+    LrcParser::Encoding encoding() const { return m_encoding; }
+
+private:
+    void selectCodec()
+    {
+        if (m_encoding != LrcParser::Gb18030) { return; }
+
+        //GB18030兼容GBK和GB2312；Qt没有编译这个编码时退回UTF-8
+        static QTextCodec * const codec = QTextCodec::codecForName("GB18030");
+        m_codec = codec;
+    }
+
+private:
+    const char * m_data;
+    qint64 m_size;
+    bool m_detected;
+    LrcParser::Encoding m_encoding;
+    QTextCodec * m_codec;
+};
+
+//解析一个无符号十进制数，返回数字个数，最多maxDigits位
+static inline int scanDigits(const char * p, const char * end, int maxDigits, int & value)
+{
+    int count = 0;
+    value = 0;
+    while (p < end && count < maxDigits && *p >= '0' && *p <= '9')
+    {
+        value = value * 10 + (*p - '0');
+        p++;
+        count++;
+    }
+    return count;
+}
+
+/*
+ * 扫描时间戳 [分钟数:秒数.小数部分]
+ *  分钟数1~3位，秒数1~2位，小数部分0~3位，小数分隔符可以是'.'或':'
+ *  小数部分按位数换算成毫秒：1位*100，2位*10，3位*1
+ */
+int LrcParser::scanTimestamp(const char * p, const char * end, qint64 & ms)
+{
+    const char * begin = p;
+    if (p >= end || *p != '[') { return 0; }
+    p++;
+
+    int minutes = 0;
+    int n = scanDigits(p, end, 3, minutes);
+    if (n == 0) { return 0; }
+    p += n;
+
+    if (p >= end || *p != ':') { return 0; }
+    p++;
+
+    int seconds = 0;
+    n = scanDigits(p, end, 2, seconds);
+    if (n == 0) { return 0; }
+    p += n;
+
+    int fraction = 0;
+    if (p < end && (*p == '.' || *p == ':'))
+    {
+        p++;
+        n = scanDigits(p, end, 3, fraction);
+        p += n;
+        if (n == 1) { fraction *= 100; }
+        else if (n == 2) { fraction *= 10; }
+
+        //超过3位的小数直接忽略
+        while (p < end && *p >= '0' && *p <= '9') { p++; }
+    }
+
+    if (p >= end || *p != ']') { return 0; }
+    p++;
+
+    ms = (qint64)(minutes * 60 + seconds) * 1000 + fraction;
+    return (int)(p - begin);
+}
+
+//判断[begin, end)是否以标签tag开头，比如"[ar:"
+static inline bool startsWithTag(const char * begin, const char * end, QLatin1String tag)
+{
+    return end - begin >= tag.size() && memcmp(begin, tag.latin1(), tag.size()) == 0;
+}
+
+//截取标签值：去掉标签名和最后的']'，再去掉两端空白
+static inline QString tagValue(const char * begin, const char * end, int tagSize, TextDecoder & decoder)
+{
+    const char * value = begin + tagSize;
+    const char * close = static_cast<const char *>(memchr(value, ']', end - value));
+    if (close) { end = close; }
+    return decoder.decode(value, (int)(end - value)).trimmed();
+}
+
+void LrcParser::parse(const char * data, qint64 size, Result & result, Mode mode)
+{
+    const uchar * bytes = reinterpret_cast<const uchar *>(data);
+
+    //UTF-16只能从BOM识别，先转成UTF-8再按字节解析
+    if (size >= 2 && ((bytes[0] == 0xFF && bytes[1] == 0xFE) || (bytes[0] == 0xFE && bytes[1] == 0xFF)))
+    {
+        bool bigEndian = bytes[0] == 0xFE;
+        QByteArray utf8 = utf16ToUtf8(bytes + 2, size - 2, bigEndian);
+        parse(utf8.constData(), utf8.size(), result, mode);
+        result.encoding = bigEndian ? Utf16BE : Utf16LE;
+        return;
+    }
+
+    const char * p = data;
+    const char * end = data + size;
+
+    //有UTF-8的BOM时跳过，编码已知，不用检测
+    Encoding utf8 = Utf8;
+    bool bom = size >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF;
+    if (bom) { p += 3; }
+    TextDecoder decoder(p, end - p, bom ? &utf8 : nullptr);
+
+    qint64 stamps[kMaxTimestampsPerLine];
+
+    while (p < end)
+    {
+        //确定这一行的范围[line, lineEnd)，去掉行尾的'\r'
+        const char * line = p;
+        const char * newline = static_cast<const char *>(memchr(p, '\n', end - p));
+        const char * lineEnd = newline ? newline : end;
+        p = newline ? newline + 1 : end;
+        if (lineEnd > line && lineEnd[-1] == '\r') { lineEnd--; }
+
+        //去掉行首空白
+        while (line < lineEnd && (*line == ' ' || *line == '\t')) { line++; }
+        if (line >= lineEnd || *line != '[') { continue; }
+
+        //连续扫描行首的时间戳
+        int count = 0;
+        qint64 ms = 0;
+        int n = 0;
+        while ((n = scanTimestamp(line, lineEnd, ms)) > 0)
+        {
+            if (count < kMaxTimestampsPerLine) { stamps[count++] = ms; }
+            line += n;
+        }
+
+        if (count > 0)
+        {
+            result.lineCount += count;
+            if (mode == MetadataOnly) { continue; }
+
+            //多个时间戳共用同一句歌词，QString隐式共享，只解码一次
+            QString text = decoder.decode(line, (int)(lineEnd - line));
+            for (int i = 0; i < count; i++)
+            {
+                result.lyrics.append(stamps[i], text);
+            }
+            continue;
+        }
+
+        //不是歌词行，检查是不是歌曲信息标签
+        if (startsWithTag(line, lineEnd, QLatin1String("[ar:")))
+        {
+            result.artist = tagValue(line, lineEnd, 4, decoder);
+        }
+        else if (startsWithTag(line, lineEnd, QLatin1String("[al:")))
+        {
+            result.album = tagValue(line, lineEnd, 4, decoder);
+        }
+        else if (startsWithTag(line, lineEnd, QLatin1String("[ti:")))
+        {
+            result.title = tagValue(line, lineEnd, 4, decoder);
+        }
+    }
+
+    result.lyrics.finish();
+    result.encoding = decoder.encoding();
+}
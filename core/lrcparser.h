@@ -0,0 +1,59 @@
+#ifndef LRCPARSER_H
+#define LRCPARSER_H
+
+#include <QString>
+#include "lyrictimeline.h"
+
+/*LRC歌词解析器，一次遍历同时解析出歌曲信息（歌名、歌手、专辑）和全部歌词
+ *  整个文件只打开一次，内存映射（映射失败时一次性读入）到一块连续的字节缓冲区
+ *  直接在原始字节上按行扫描，只用指针表示行和字段的范围（切片），不为每一行构造QString
+ *      标签名用QLatin1String比较，时间戳用手写的扫描函数转换成毫秒，不经过split/toInt/toDouble
+ *      只有真正要存储的文本（歌词、歌手名等）才解码成QString，这是唯一的堆分配
+ *  支持的行格式：
+ *      [ti:歌名] [ar:歌手] [al:专辑]
+ *      [mm:ss] [mm:ss.x] [mm:ss.xx] [mm:ss.xxx] [mm:ss:xx]，一行可以有多个时间戳共用一句歌词
+ *  其他标签行（[by:] [offset:]等）和无法识别的行直接跳过
+ *  编码检测：歌词文件常见UTF-8和GBK/GB18030两种编码，同一个歌曲库里经常混在一起
+ *      有BOM时按BOM（UTF-8、UTF-16LE/BE）；UTF-16的文件先逐字转成UTF-8再解析
+ *      否则验证整个文件是否是合法的UTF-8（SIMD，运行时检测到SSSE3时一次验证16字节，否则跳过纯ASCII的块）
+ *      不是UTF-8时统计按GB18030和UTF-8解析的合法/非法序列个数打分，GB18030更合适时按GB18030解码，都不合适时按Latin-1
+ *      检测推迟到第一次需要解码非ASCII文本时才做，MetadataOnly模式下标签都是ASCII时完全不用检测
+ *      每个文件最多检测一次，文本按检测结果逐行直接解码进时间轴，不生成整个文件的QString，也不会解码两遍
+ *  MetadataOnly模式用于导入：只解析歌曲信息并统计歌词行数，不解码、不保存歌词文本
+ *      歌词在真正需要显示时才按Full模式加载（见LyricCache）
+ */
+class LrcParser
+{
+public:
+    enum Mode { Full, MetadataOnly };
+    enum Encoding { Utf8, Utf16LE, Utf16BE, Gb18030, Latin1 };
+
+    struct Result
+    {
+        Result() : lineCount(0), encoding(Utf8) {}
+
+        QString title;
+        QString artist;
+        QString album;
+        LyricTimeline lyrics;   //按时间戳排序的歌词时间轴，MetadataOnly模式下为空
+        int lineCount;          //歌词行数（时间戳个数）
+        Encoding encoding;      //检测出的文件编码，没有非ASCII文本需要解码时为Utf8
+    };
+
+    //解析歌词文件，文件打不开返回false
+    static bool parseFile(const QString & path, Result & result, Mode mode = Full);
+
+    //解析内存中的歌词文本，编码自动检测
+    static void parse(const char * data, qint64 size, Result & result, Mode mode = Full);
+
+    //检测文本的编码，bomSize返回BOM的字节数（没有BOM为0）
+    static Encoding detectEncoding(const char * data, qint64 size, int & bomSize);
+
+    //是否是合法的UTF-8（拒绝过长编码、代理区和超出U+10FFFF的码点）
+    static bool isValidUtf8(const char * data, qint64 size);
+
+    //从p开始扫描一个"[mm:ss.xx]"时间戳，成功返回消耗的字节数（包括方括号）并把毫秒数写入ms，失败返回0
+    static int scanTimestamp(const char * p, const char * end, qint64 & ms);
+};
+
+#endif // LRCPARSER_H
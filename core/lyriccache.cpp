@@ -0,0 +1,108 @@
+#include "lyriccache.h"
+#include "worker.h"
+#include "log.h"
+#include <QRunnable>
+
+//加载歌词的后台线程数
+static const int kLoaderThreads = 2;
+
+//后台加载一首歌的歌词，完成后放入缓存并通知
+class LyricLoadTask : public QRunnable
+{
+public:
+    LyricLoadTask(LyricCache * cache, const QUrl & mp3Url) : m_cache(cache), m_url(mp3Url) {}
+
+    void run() override
+    {
+        LyricsPtr lyrics(new LyricTimeline(Worker::readLyrics(m_url)));
+        m_cache->insert(m_url, lyrics);
+    }
+
+private:
+    LyricCache * m_cache;
+    QUrl m_url;
+};
+
+LyricCache::LyricCache(int maxBytes, QObject *parent)
+    : QObject(parent)
+    , m_cache(maxBytes)
+{
+    qRegisterMetaType<LyricsPtr>("LyricsPtr");
+    m_pool.setMaxThreadCount(kLoaderThreads);
+}
+
+LyricCache::~LyricCache()
+{
+    m_pool.waitForDone();
+}
+
+/*
+ * 估算歌词占用的字节数
+ *  时间戳8字节，QString的数据按每个字符2字节加上头部，再加上两个数组中的指针
+ */
+int LyricCache::cost(const LyricTimeline & lyrics)
+{
+    int bytes = (int)sizeof(LyricTimeline);
+    for (int i = 0; i < lyrics.size(); i++)
+    {
+        bytes += (int)sizeof(qint64) + (int)sizeof(QString) + 24 + lyrics.text(i).size() * 2;
+    }
+    return qMax(1, bytes);
+}
+
+LyricsPtr LyricCache::find(const QUrl & mp3Url)
+{
+    QMutexLocker locker(&m_mutex);
+    Entry * entry = m_cache.object(mp3Url);     //命中时移到最近使用的位置
+    return entry ? entry->lyrics : LyricsPtr();
+}
+
+void LyricCache::request(const QUrl & mp3Url)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_cache.contains(mp3Url) || m_loading.contains(mp3Url)) { return; }
+        m_loading.insert(mp3Url);
+    }
+
+    LOG_TRACE(Lyrics) << "后台加载歌词：" << mp3Url;
+    m_pool.start(new LyricLoadTask(this, mp3Url));
+}
+
+void LyricCache::insert(const QUrl & mp3Url, const LyricsPtr & lyrics)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_loading.remove(mp3Url);
+
+        Entry * entry = new Entry;
+        entry->lyrics = lyrics;
+        m_cache.insert(mp3Url, entry, cost(*lyrics)); //超过总预算的单首歌词不会被缓存，由QCache直接释放
+    }
+
+    emit loaded(mp3Url, lyrics);    //接收者在主线程，跨线程信号自动排队
+}
+
+void LyricCache::setMaxBytes(int maxBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.setMaxCost(maxBytes);
+}
+
+int LyricCache::maxBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.maxCost();
+}
+
+int LyricCache::totalBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.totalCost();
+}
+
+void LyricCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.clear();
+}
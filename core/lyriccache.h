@@ -0,0 +1,59 @@
+#ifndef LYRICCACHE_H
+#define LYRICCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QUrl>
+#include "lyrictimeline.h"
+
+//歌词时间轴的共享指针，歌词加载完成信号的参数类型，需要注册元类型才能跨线程排队传递
+typedef QSharedPointer<const LyricTimeline> LyricsPtr;
+Q_DECLARE_METATYPE(LyricsPtr)
+
+/*歌词缓存，按字节数限制容量的LRU缓存
+ *  导入时不再把歌词常驻在歌曲对象中，只有当前播放和预取的歌曲才加载歌词
+ *  内部使用QCache，以歌词占用的估算字节数作为开销，超出预算时淘汰最久没有访问的歌词
+ *  find只查缓存，不阻塞；request在后台线程池中加载，加载完成后发出loaded信号并带上歌词
+ *      单首歌词超过整个预算时不进缓存，但仍然通过信号交给使用者
+ *  缓存中的歌词以QSharedPointer返回，使用者持有期间即使被淘汰也仍然有效
+ *  线程安全：find/request可以在任意线程调用，加载线程通过insert放入缓存
+ */
+class LyricCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LyricCache(int maxBytes = 8 * 1024 * 1024, QObject *parent = nullptr);
+    ~LyricCache();
+
+    LyricsPtr find(const QUrl & mp3Url);  //查缓存，没有返回空指针
+    void request(const QUrl & mp3Url);                              //异步加载，已缓存或正在加载时忽略
+    void setMaxBytes(int maxBytes);
+    int maxBytes() const;
+    int totalBytes() const;
+    void clear();
+
+    static int cost(const LyricTimeline & lyrics);  //估算歌词占用的字节数
+
+signals:
+    void loaded(const QUrl & mp3Url, const LyricsPtr & lyrics);   //某首歌的歌词加载完成
+
+private:
+    friend class LyricLoadTask;
+    void insert(const QUrl & mp3Url, const LyricsPtr & lyrics);
+
+    struct Entry
+    {
+        LyricsPtr lyrics;
+    };
+
+    mutable QMutex m_mutex;         //保护m_cache和m_loading
+    QCache<QUrl, Entry> m_cache;
+    QSet<QUrl> m_loading;           //正在加载的歌曲，避免重复加载
+    QThreadPool m_pool;             //加载歌词的后台线程，和解析线程池分开，不会排在大批量导入后面
+};
+
+#endif // LYRICCACHE_H
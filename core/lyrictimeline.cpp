@@ -0,0 +1,69 @@
+#include "lyrictimeline.h"
+#include <algorithm>
+
+/*
+ * 按时间戳稳定排序
+ *  大多数歌词文件本身就是按时间排列的，先检查一遍，有序就不排序
+ *  一行多个时间戳（副歌重复）的文件会乱序，此时对下标排序后再按新顺序重排两个数组
+ */
+void LyricTimeline::finish()
+{
+    if (!std::is_sorted(m_times.constBegin(), m_times.constEnd()))
+    {
+        QVector<int> order(m_times.size());
+        for (int i = 0; i < order.size(); i++) { order[i] = i; }
+
+        const QVector<qint64> & times = m_times;
+        std::stable_sort(order.begin(), order.end(), [&times](int a, int b) {
+            return times[a] < times[b];
+        });
+
+        QVector<qint64> sortedTimes(order.size());
+        QVector<QString> sortedTexts(order.size());
+        for (int i = 0; i < order.size(); i++)
+        {
+            sortedTimes[i] = m_times[order[i]];
+            sortedTexts[i] = m_texts[order[i]];
+        }
+        m_times.swap(sortedTimes);
+        m_texts.swap(sortedTexts);
+    }
+
+    m_times.squeeze();
+    m_texts.squeeze();
+}
+
+int LyricTimeline::indexAt(qint64 position) const
+{
+    //upper_bound找到第一个起始时间 > position 的行，它的前一行就是当前行
+    auto it = std::upper_bound(m_times.constBegin(), m_times.constEnd(), position);
+    return int(it - m_times.constBegin()) - 1;
+}
+
+int LyricCursor::seek(qint64 position)
+{
+    if (!m_timeline || m_timeline->isEmpty())
+    {
+        m_index = -1;
+        return m_index;
+    }
+
+    const int size = m_timeline->size();
+
+    //1.还在当前行：当前行起始时间 <= position < 下一行起始时间
+    //2.刚进入下一行：下一行起始时间 <= position < 下下行起始时间
+    for (int i = m_index; i <= m_index + 1 && i < size; i++)
+    {
+        bool afterStart = (i < 0) || m_timeline->time(i) <= position;
+        bool beforeNext = (i + 1 >= size) || position < m_timeline->time(i + 1);
+        if (afterStart && beforeNext)
+        {
+            m_index = i;
+            return m_index;
+        }
+    }
+
+    //3.跳转了，二分查找重新定位
+    m_index = m_timeline->indexAt(position);
+    return m_index;
+}
@@ -0,0 +1,55 @@
+#ifndef LYRICTIMELINE_H
+#define LYRICTIMELINE_H
+
+#include <QString>
+#include <QVector>
+
+/*歌词时间轴，取代按时间戳排序的QMap<qint64, QString>
+ *  两个平行的扁平数组：times[i]是第i行歌词的起始时间（毫秒），texts[i]是对应的文本
+ *  times按升序排列，内存连续，查找播放进度对应的行用二分查找 O(log n)
+ *  解析时用append按文件顺序追加，结束后调用finish排序（文件本身有序时不排序）
+ */
+class LyricTimeline
+{
+private:
+    QVector<qint64> m_times;
+    QVector<QString> m_texts;
+
+public:
+    void append(qint64 time, const QString & text) { m_times.append(time); m_texts.append(text); }
+    void finish();      //按时间戳稳定排序，并释放多余的容量
+    void clear() { m_times.clear(); m_texts.clear(); }
+
+    int size() const { return m_times.size(); }
+    bool isEmpty() const { return m_times.isEmpty(); }
+    qint64 time(int index) const { return m_times[index]; }
+    const QString & text(int index) const { return m_texts[index]; }
+    const QVector<qint64> & times() const { return m_times; }
+    const QVector<QString> & texts() const { return m_texts; }
+
+    //二分查找播放进度position所在的行：最后一个起始时间 <= position 的行，在第一行之前返回-1
+    int indexAt(qint64 position) const;
+};
+
+/*歌词游标，记住播放时当前所在的行
+ *  正常播放时进度单调递增，先检查是否还在当前行、或者刚进入下一行，O(1)
+ *  拖动进度条（跳转）之后这两种情况都不满足，再用二分查找重新定位
+ */
+class LyricCursor
+{
+private:
+    const LyricTimeline * m_timeline;
+    int m_index;
+
+public:
+    LyricCursor() : m_timeline(nullptr), m_index(-1) {}
+
+    void reset(const LyricTimeline * timeline) { m_timeline = timeline; m_index = -1; }
+    const LyricTimeline * timeline() const { return m_timeline; }
+    int index() const { return m_index; }
+
+    //根据播放进度更新并返回当前行，在第一行之前返回-1
+    int seek(qint64 position);
+};
+
+#endif // LYRICTIMELINE_H
@@ -0,0 +1,130 @@
+#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/*有界无锁多生产者多消费者环形队列（MPMC ring buffer）
+ *  容量向上取整为2的幂，下标用 pos & mask 计算
+ *  每个槽位带一个序号seq，生产者/消费者通过比较seq和自己抢到的位置判断槽位状态：
+ *      seq == pos          槽位空闲，生产者可以写入
+ *      seq == pos + 1      槽位有数据，消费者可以读取
+ *  生产者和消费者各自只用一次CAS抢位置，不加锁，也不会互相阻塞
+ *  入队位置和出队位置放在不同的缓存行，避免生产者和消费者之间的伪共享
+ *  队列满时try_push返回false，队列空时try_pop返回false，阻塞和背压策略由使用者实现
+ */
+template <typename T>
+class MpmcQueue
+{
+public:
+    explicit MpmcQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity) { size <<= 1; }
+
+        m_mask = size - 1;
+        m_cells = new Cell[size];
+        for (size_t i = 0; i < size; i++)
+        {
+            m_cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+        m_enqueuePos.store(0, std::memory_order_relaxed);
+        m_dequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    ~MpmcQueue() { delete[] m_cells; }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    //入队，队列满返回false
+    template <typename U>
+    bool try_push(U && value)
+    {
+        Cell * cell = nullptr;
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+            if (diff == 0)
+            {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+            }
+            else if (diff < 0)
+            {
+                return false;   //槽位还没被消费，队列满
+            }
+            else
+            {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);   //被别的生产者抢先，重新读取位置
+            }
+        }
+
+        cell->data = std::forward<U>(value);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    //出队，队列空返回false
+    bool try_pop(T & value)
+    {
+        Cell * cell = nullptr;
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+            }
+            else if (diff < 0)
+            {
+                return false;   //槽位还没被写入，队列空
+            }
+            else
+            {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(cell->data);
+        cell->data = T();   //释放槽位持有的资源，不留到下一轮覆盖时
+        cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    //近似大小，并发修改时只作参考
+    size_t size_approx() const
+    {
+        size_t enqueue = m_enqueuePos.load(std::memory_order_relaxed);
+        size_t dequeue = m_dequeuePos.load(std::memory_order_relaxed);
+        return enqueue > dequeue ? enqueue - dequeue : 0;
+    }
+
+private:
+    MpmcQueue(const MpmcQueue & other);
+    MpmcQueue & operator=(const MpmcQueue & other);
+
+    enum { CacheLineSize = 64 };
+
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    char m_pad0[CacheLineSize];
+    Cell * m_cells;
+    size_t m_mask;
+    char m_pad1[CacheLineSize - sizeof(Cell *) - sizeof(size_t)];
+    std::atomic<size_t> m_enqueuePos;
+    char m_pad2[CacheLineSize - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_dequeuePos;
+    char m_pad3[CacheLineSize - sizeof(std::atomic<size_t>)];
+};
+
+#endif // MPMCQUEUE_H
@@ -0,0 +1,126 @@
+#ifndef PCMRINGBUFFER_H
+#define PCMRINGBUFFER_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <cstring>
+
+/*无锁单生产者单消费者PCM环形缓冲区（SPSC ring buffer），音频引擎的解码线程写、输出线程读
+ *  存放交错存储的float采样，以帧为单位读写；容量向上取整为2的幂，下标用 pos & mask 计算
+ *  写位置只由生产者修改，读位置只由消费者修改，各自用release发布、用acquire读取对方的位置，
+ *      不加锁也不用CAS，输出线程在音频回调中读取时不会被解码线程阻塞
+ *  读写位置是不回绕的64位帧计数，同时也是整个播放过程中的帧编号，用来换算播放位置和曲目边界
+ *  跳转或切歌时生产者调用discardUntil，消费者下次读取时直接跳过这之前的所有帧，
+ *      不用让两个线程同时停下来清空缓冲区
+ *  读写位置放在不同的缓存行，避免生产者和消费者之间的伪共享
+ */
+class PcmRingBuffer
+{
+public:
+    PcmRingBuffer(int capacityFrames, int channels)
+        : m_channels(channels)
+    {
+        quint64 size = 2;
+        while (size < (quint64)capacityFrames) { size <<= 1; }
+
+        m_mask = size - 1;
+        m_samples = new float[size * channels];
+        m_writePos.store(0, std::memory_order_relaxed);
+        m_readPos.store(0, std::memory_order_relaxed);
+        m_discardPos.store(0, std::memory_order_relaxed);
+    }
+
+    ~PcmRingBuffer() { delete[] m_samples; }
+
+    int channels() const { return m_channels; }
+    int capacity() const { return (int)(m_mask + 1); }
+
+    //生产者：可以写入的帧数
+    int writable() const
+    {
+        return capacity() - (int)(m_writePos.load(std::memory_order_relaxed) - m_readPos.load(std::memory_order_acquire));
+    }
+
+    //生产者：已经写入的总帧数，也就是下一帧的编号
+    quint64 written() const { return m_writePos.load(std::memory_order_relaxed); }
+
+    //生产者：写入最多count帧，返回实际写入的帧数，空间不够时只写一部分
+    int write(const float * frames, int count)
+    {
+        const quint64 pos = m_writePos.load(std::memory_order_relaxed);
+        const int n = qMin(count, capacity() - (int)(pos - m_readPos.load(std::memory_order_acquire)));
+        if (n <= 0) { return 0; }
+
+        store(pos, frames, n);
+        m_writePos.store(pos + n, std::memory_order_release);
+        return n;
+    }
+
+    //生产者：让消费者跳过编号小于frame的所有帧
+    void discardUntil(quint64 frame) { m_discardPos.store(frame, std::memory_order_release); }
+
+    //消费者：可以读取的帧数（不含要跳过的帧）
+    int readable() const
+    {
+        const quint64 write = m_writePos.load(std::memory_order_acquire);
+        const quint64 read = qMax(m_readPos.load(std::memory_order_relaxed), qMin(m_discardPos.load(std::memory_order_acquire), write));
+        return (int)(write - read);
+    }
+
+    //任意线程：已经读走的总帧数，也就是消费者下一帧的编号
+    quint64 readPosition() const { return m_readPos.load(std::memory_order_acquire); }
+
+    //消费者：读出最多count帧，返回实际读出的帧数
+    int read(float * frames, int count)
+    {
+        const quint64 write = m_writePos.load(std::memory_order_acquire);
+        quint64 pos = m_readPos.load(std::memory_order_relaxed);
+        const quint64 discard = qMin(m_discardPos.load(std::memory_order_acquire), write);
+        if (discard > pos) { pos = discard; }
+
+        const int n = qMin(count, (int)(write - pos));
+        if (n > 0)
+        {
+            load(pos, frames, n);
+        }
+        m_readPos.store(pos + qMax(n, 0), std::memory_order_release);
+        return qMax(n, 0);
+    }
+
+private:
+    PcmRingBuffer(const PcmRingBuffer & other);
+    PcmRingBuffer & operator=(const PcmRingBuffer & other);
+
+    //从pos帧开始写入n帧，跨过末尾时分两段
+    void store(quint64 pos, const float * frames, int n)
+    {
+        const quint64 start = pos & m_mask;
+        const int first = (int)qMin<quint64>((quint64)n, m_mask + 1 - start);
+        memcpy(m_samples + start * m_channels, frames, sizeof(float) * first * m_channels);
+        memcpy(m_samples, frames + (size_t)first * m_channels, sizeof(float) * (n - first) * m_channels);
+    }
+
+    //从pos帧开始读出n帧，跨过末尾时分两段
+    void load(quint64 pos, float * frames, int n) const
+    {
+        const quint64 start = pos & m_mask;
+        const int first = (int)qMin<quint64>((quint64)n, m_mask + 1 - start);
+        memcpy(frames, m_samples + start * m_channels, sizeof(float) * first * m_channels);
+        memcpy(frames + (size_t)first * m_channels, m_samples, sizeof(float) * (n - first) * m_channels);
+    }
+
+    enum { CacheLineSize = 64 };
+
+    char m_pad0[CacheLineSize];
+    float * m_samples;
+    quint64 m_mask;
+    int m_channels;
+    char m_pad1[CacheLineSize];
+    std::atomic<quint64> m_writePos;
+    std::atomic<quint64> m_discardPos;
+    char m_pad2[CacheLineSize - 2 * sizeof(std::atomic<quint64>)];
+    std::atomic<quint64> m_readPos;
+    char m_pad3[CacheLineSize - sizeof(std::atomic<quint64>)];
+};
+
+#endif // PCMRINGBUFFER_H
@@ -0,0 +1,147 @@
+#include "realfft.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOOPY_FFT_SSE2
+#endif
+
+static const double kPi = 3.14159265358979323846;
+
+RealFft::RealFft(int size)
+    : m_size(size)
+    , m_half(size / 2)
+{
+    Q_ASSERT(size >= 8 && (size & (size - 1)) == 0);
+
+    int bits = 0;
+    while ((1 << bits) < m_half) { bits++; }
+
+    m_bitReverse.resize(m_half);
+    for (int i = 0; i < m_half; i++)
+    {
+        int r = 0;
+        for (int b = 0; b < bits; b++)
+        {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        m_bitReverse[i] = r;
+    }
+
+    m_re.resize(m_half);
+    m_im.resize(m_half);
+
+    // 宽度为h的一级：w_k = e^(-iπk/h)，k = 0 ~ h-1
+    m_twiddleRe.reserve(m_half);
+    m_twiddleIm.reserve(m_half);
+    for (int h = 1; h < m_half; h *= 2)
+    {
+        for (int k = 0; k < h; k++)
+        {
+            m_twiddleRe.append((float)std::cos(-kPi * k / h));
+            m_twiddleIm.append((float)std::sin(-kPi * k / h));
+        }
+    }
+
+    m_splitRe.resize(m_half + 1);
+    m_splitIm.resize(m_half + 1);
+    for (int k = 0; k <= m_half; k++)
+    {
+        m_splitRe[k] = (float)std::cos(-2.0 * kPi * k / m_size);
+        m_splitIm[k] = (float)std::sin(-2.0 * kPi * k / m_size);
+    }
+}
+
+const char * RealFft::implementation()
+{
+#ifdef LOOPY_FFT_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+void RealFft::transform()
+{
+    float * re = m_re.data();
+    float * im = m_im.data();
+    const float * twRe = m_twiddleRe.constData();
+    const float * twIm = m_twiddleIm.constData();
+
+    for (int h = 1; h < m_half; twRe += h, twIm += h, h *= 2)
+    {
+        for (int start = 0; start < m_half; start += 2 * h)
+        {
+            float * aRe = re + start;
+            float * aIm = im + start;
+            float * bRe = aRe + h;
+            float * bIm = aIm + h;
+
+            int k = 0;
+#ifdef LOOPY_FFT_SSE2
+            for (; k + 4 <= h; k += 4)
+            {
+                __m128 wr = _mm_loadu_ps(twRe + k);
+                __m128 wi = _mm_loadu_ps(twIm + k);
+                __m128 br = _mm_loadu_ps(bRe + k);
+                __m128 bi = _mm_loadu_ps(bIm + k);
+                __m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+                __m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+                __m128 ar = _mm_loadu_ps(aRe + k);
+                __m128 ai = _mm_loadu_ps(aIm + k);
+                _mm_storeu_ps(bRe + k, _mm_sub_ps(ar, tr));
+                _mm_storeu_ps(bIm + k, _mm_sub_ps(ai, ti));
+                _mm_storeu_ps(aRe + k, _mm_add_ps(ar, tr));
+                _mm_storeu_ps(aIm + k, _mm_add_ps(ai, ti));
+            }
+#endif
+            for (; k < h; k++)
+            {
+                float tr = bRe[k] * twRe[k] - bIm[k] * twIm[k];
+                float ti = bRe[k] * twIm[k] + bIm[k] * twRe[k];
+                bRe[k] = aRe[k] - tr;
+                bIm[k] = aIm[k] - ti;
+                aRe[k] += tr;
+                aIm[k] += ti;
+            }
+        }
+    }
+}
+
+/*
+ * 实数FFT
+ *  z[n] = x[2n] + i·x[2n+1]，Z = FFT(z)
+ *  X[k] = E[k] + e^(-2πik/N)·O[k]，其中 E[k] = (Z[k] + conj(Z[M-k])) / 2，O[k] = (Z[k] - conj(Z[M-k])) / 2i
+ */
+void RealFft::power(const float * in, float * out)
+{
+    float * re = m_re.data();
+    float * im = m_im.data();
+    const int * reverse = m_bitReverse.constData();
+    for (int n = 0; n < m_half; n++)
+    {
+        re[reverse[n]] = in[2 * n];
+        im[reverse[n]] = in[2 * n + 1];
+    }
+
+    transform();
+
+    for (int k = 0; k <= m_half; k++)
+    {
+        const int a = k & (m_half - 1);
+        const int b = (m_half - k) & (m_half - 1);
+        const float zr = re[a], zi = im[a];
+        const float cr = re[b], ci = -im[b];
+
+        const float er = 0.5f * (zr + cr);
+        const float ei = 0.5f * (zi + ci);
+        // (Z - conj) / 2i = (dI - i·dR) / 2
+        const float or_ = 0.5f * (zi - ci);
+        const float oi = -0.5f * (zr - cr);
+
+        const float wr = m_splitRe[k], wi = m_splitIm[k];
+        const float xr = er + or_ * wr - oi * wi;
+        const float xi = ei + or_ * wi + oi * wr;
+        out[k] = xr * xr + xi * xi;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef REALFFT_H
+#define REALFFT_H
+
+#include <QVector>
+
+/*实数序列的快速傅里叶变换，频谱分析用
+ *  N点实数FFT打包成N/2点复数FFT：偶数下标作实部、奇数下标作虚部，变换后再拆分出实数序列的频谱
+ *  复数FFT是按时间抽取的基2迭代算法，实部和虚部分开存放（SoA），
+ *      每级的旋转因子预先算好并连续存放，蝶形运算按k连续访问
+ *  蝶形宽度不小于4的各级用SSE2一次算4个蝶形，前两级（宽度1、2）的旋转因子是1和-i，用标量
+ *  构造时分配所有缓冲区，power不分配内存，可以每帧调用；同一个对象不能在多个线程中同时使用
+ */
+class RealFft
+{
+public:
+    explicit RealFft(int size);     //size是2的幂，不小于8
+
+    int size() const { return m_size; }
+
+    //计算功率谱|X[k]|²，k = 0 ~ size/2，out至少有size/2+1个元素
+    void power(const float * in, float * out);
+
+    static const char * implementation();   //当前使用的实现名称，用于日志
+
+private:
+    void transform();   //对m_re/m_im做复数FFT，输入已经按位反转顺序排好
+
+    int m_size;
+    int m_half;                 //复数FFT的点数
+    QVector<int> m_bitReverse;
+    QVector<float> m_re;
+    QVector<float> m_im;
+    QVector<float> m_twiddleRe; //各级的旋转因子，宽度为h的一级有h个，从宽度1开始依次存放
+    QVector<float> m_twiddleIm;
+    QVector<float> m_splitRe;   //拆分实数频谱用的旋转因子 e^(-2πik/N)
+    QVector<float> m_splitIm;
+};
+
+#endif // REALFFT_H
@@ -0,0 +1,272 @@
+#include "searchindex.h"
+#include <algorithm>
+
+//被删除的文档数超过这个数、并且超过现有文档数时整理一次
+static const int kCompactThreshold = 1024;
+
+//gram的键：低48位依次放最多3个UTF-16字符，第48位起是字符数，不同长度的gram不会相同
+static inline quint64 gramKey(const QChar * p, int length)
+{
+    quint64 key = (quint64)length << 48;
+    for (int i = 0; i < length; i++)
+    {
+        key |= (quint64)p[i].unicode() << (16 * i);
+    }
+    return key;
+}
+
+static inline bool isSeparator(QChar c)
+{
+    return c.isSpace() || c.isPunct() || c.isSymbol();
+}
+
+//大小写折叠后按词取gram：词长 >= 3 时取trigram；shortGrams时另外取单字和相邻两字
+//  查询时shortGrams为false，短于3个字符的词只取整个词本身（1或2个字符的gram）
+static void wordGrams(const QChar * word, int length, bool shortGrams, bool query, QVector<quint64> & grams)
+{
+    for (int i = 0; i + 3 <= length; i++)
+    {
+        grams.append(gramKey(word + i, 3));
+    }
+
+    if (query)
+    {
+        if (length < 3 && length > 0) { grams.append(gramKey(word, length)); }
+        return;
+    }
+
+    if (!shortGrams) { return; }
+    for (int i = 0; i < length; i++)
+    {
+        grams.append(gramKey(word + i, 1));
+        if (i + 1 < length) { grams.append(gramKey(word + i, 2)); }
+    }
+}
+
+static void splitGrams(const QString & text, bool shortGrams, bool query, QVector<quint64> & grams)
+{
+    QString folded = text.toCaseFolded();
+    const QChar * p = folded.constData();
+    const QChar * end = p + folded.size();
+    while (p < end)
+    {
+        while (p < end && isSeparator(*p)) { p++; }
+        const QChar * word = p;
+        while (p < end && !isSeparator(*p)) { p++; }
+        wordGrams(word, (int)(p - word), shortGrams, query, grams);
+    }
+}
+
+static void sortUnique(QVector<quint64> & grams)
+{
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+}
+
+void SearchIndex::Postings::append(quint32 doc)
+{
+    quint32 delta = count > 0 ? doc - last : doc;
+    while (delta >= 0x80)
+    {
+        data.append((char)(delta | 0x80));
+        delta >>= 7;
+    }
+    data.append((char)delta);
+    last = doc;
+    count++;
+}
+
+void SearchIndex::Postings::decode(QVector<quint32> & docs) const
+{
+    docs.resize(count);
+    const uchar * p = (const uchar *)data.constData();
+    quint32 doc = 0;
+    for (int i = 0; i < count; i++)
+    {
+        quint32 delta = 0;
+        int shift = 0;
+        while (*p & 0x80)
+        {
+            delta |= (quint32)(*p++ & 0x7F) << shift;
+            shift += 7;
+        }
+        delta |= (quint32)*p++ << shift;
+        doc = i > 0 ? doc + delta : delta;
+        docs[i] = doc;
+    }
+}
+
+SearchIndex::SearchIndex()
+    : m_count(0)
+    , m_dead(0)
+    , m_removals(0)
+{
+}
+
+void SearchIndex::appendGrams(const QString & text, bool shortGrams, QVector<quint64> & grams)
+{
+    splitGrams(text, shortGrams, false, grams);
+}
+
+void SearchIndex::insert(SongId id, QVector<quint64> grams)
+{
+    if (id < 0) { return; }
+    sortUnique(grams);
+
+    QWriteLocker locker(&m_lock);
+
+    if (id >= m_docs.size())
+    {
+        const int size = m_docs.size();
+        m_docs.resize(id + 1);
+        std::fill(m_docs.begin() + size, m_docs.end(), -1);
+    }
+    if (m_docs[id] >= 0)
+    {
+        m_ids[m_docs[id]] = -1;
+        m_count--;
+        m_dead++;
+    }
+
+    quint32 doc = (quint32)m_ids.size();
+    m_ids.append(id);
+    m_docs[id] = (qint32)doc;
+    m_count++;
+    for (quint64 gram : grams)
+    {
+        m_postings[gram].append(doc);
+    }
+
+    if (m_dead > kCompactThreshold && m_dead > m_count) { compact(); }
+}
+
+/*
+ * 删除歌曲
+ *  被删除的文档只做标记；后面的歌曲ID前移，按新的歌曲ID重写文档编号到歌曲ID的对应关系
+ *  开销和被删除歌曲之后的歌曲数有关，和倒排表的大小无关
+ */
+void SearchIndex::removeSongs(const QVector<QPair<int, int>> & ranges)
+{
+    QWriteLocker locker(&m_lock);
+
+    for (const QPair<int, int> & range : ranges)
+    {
+        const int first = range.first;
+        const int last = qMin(range.first + range.second, m_docs.size());
+        if (first < 0 || first >= last) { continue; }
+
+        for (int id = first; id < last; id++)
+        {
+            if (m_docs[id] < 0) { continue; }
+            m_ids[m_docs[id]] = -1;
+            m_count--;
+            m_dead++;
+        }
+        m_docs.erase(m_docs.begin() + first, m_docs.begin() + last);
+
+        for (int id = first; id < m_docs.size(); id++)
+        {
+            if (m_docs[id] >= 0) { m_ids[m_docs[id]] = id; }
+        }
+    }
+    m_removals++;
+
+    if (m_dead > kCompactThreshold && m_dead > m_count) { compact(); }
+}
+
+/*
+ * 查询
+ *  查询词的gram按倒排表长度从短到长排序，先解码最短的表作为候选集，
+ *  再和其余每个表做归并求交，候选集为空时提前结束
+ */
+QVector<SongId> SearchIndex::search(const QString & query, int * removals) const
+{
+    QVector<quint64> grams;
+    splitGrams(query, false, true, grams);
+    sortUnique(grams);
+
+    QReadLocker locker(&m_lock);
+    if (removals) { *removals = m_removals; }
+    if (grams.isEmpty()) { return QVector<SongId>(); }
+
+    QVector<const Postings *> lists;
+    lists.reserve(grams.size());
+    for (quint64 gram : grams)
+    {
+        auto it = m_postings.constFind(gram);
+        if (it == m_postings.constEnd()) { return QVector<SongId>(); }
+        lists.append(&it.value());
+    }
+    std::sort(lists.begin(), lists.end(), [](const Postings * a, const Postings * b) { return a->count < b->count; });
+
+    QVector<quint32> result;
+    lists[0]->decode(result);
+
+    QVector<quint32> docs;
+    QVector<quint32> common;
+    for (int i = 1; i < lists.size() && !result.isEmpty(); i++)
+    {
+        lists[i]->decode(docs);
+        common.resize(qMin(result.size(), docs.size()));
+        int n = (int)(std::set_intersection(result.constBegin(), result.constEnd(), docs.constBegin(), docs.constEnd(), common.begin()) - common.begin());
+        common.resize(n);
+        result.swap(common);
+    }
+
+    // 文档编号按加入顺序，更新过的歌曲排在后面，换成歌曲ID后重新排序
+    QVector<SongId> ids;
+    ids.reserve(result.size());
+    for (quint32 doc : result)
+    {
+        SongId id = m_ids[doc];
+        if (id >= 0) { ids.append(id); }
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+int SearchIndex::size() const
+{
+    QReadLocker locker(&m_lock);
+    return m_count;
+}
+
+void SearchIndex::compact()
+{
+    //旧编号 -> 新编号，被删除的文档为-1；保持原来的先后顺序，倒排表仍然有序
+    QVector<qint64> remap(m_ids.size(), -1);
+    QVector<SongId> ids;
+    ids.reserve(m_count);
+    for (int i = 0; i < m_ids.size(); i++)
+    {
+        if (m_ids[i] < 0) { continue; }
+        remap[i] = ids.size();
+        m_docs[m_ids[i]] = (qint32)ids.size();
+        ids.append(m_ids[i]);
+    }
+
+    QVector<quint32> docs;
+    for (auto it = m_postings.begin(); it != m_postings.end(); )
+    {
+        it.value().decode(docs);
+        Postings postings;
+        for (quint32 doc : docs)
+        {
+            if (remap[doc] >= 0) { postings.append((quint32)remap[doc]); }
+        }
+
+        if (postings.count == 0)
+        {
+            it = m_postings.erase(it);
+        }
+        else
+        {
+            postings.data.squeeze();
+            it.value() = postings;
+            ++it;
+        }
+    }
+
+    m_ids = ids;
+    m_dead = 0;
+}
@@ -0,0 +1,74 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+#include "song.h"
+
+/*全文搜索索引，n-gram倒排索引，用于在歌曲库中即时搜索
+ *  文本先大小写折叠，按空白和标点切成词，只在词内取n-gram，不跨词
+ *      每个词取所有连续3个字符的trigram；歌名、歌手、专辑这类短字段另外取1、2个字符的gram，
+ *      这样输入一两个字（常见于中文）也能搜到歌名；歌词只取trigram，控制索引大小
+ *  每个gram一个倒排表，记录包含它的文档编号；文档编号按加入顺序递增，倒排表只在末尾追加
+ *      倒排表按差值 + 变长整数编码存放在字节数组中，大部分编号只占1个字节
+ *  查询时把查询词同样切成gram，从最短的倒排表开始依次求交集，结果是包含全部gram的文档
+ *      gram只是必要条件：歌词中的结果可能只是各个gram都出现、并不连在一起，这里不再回查原文
+ *  文档用歌曲ID标识，查询直接返回歌曲ID，不用再按路径查找；同一首歌再次加入时替换旧文档
+ *      删除歌曲时和SongManager::removeSongs一样，后面的歌曲ID前移，只改文档编号和歌曲ID的对应关系，倒排表不动
+ *      被删除的文档只做标记，超过一半时整理一次，重新编号并重写倒排表
+ *  加入和删除在索引线程中按收到的顺序执行，可能落后于界面线程；查询同时返回已经执行过的删除次数，
+ *      调用者据此判断结果里的歌曲ID是不是和当前的编号一致
+ *  读写锁保护：索引线程加入文档时持写锁，界面线程查询时持读锁，查询不会被长时间阻塞
+ *      gram在加锁之前计算好，写锁内只追加倒排表
+ */
+class SearchIndex
+{
+public:
+    SearchIndex();
+
+    //把text切分出的gram追加到grams，shortGrams为true时包括1、2个字符的gram
+    static void appendGrams(const QString & text, bool shortGrams, QVector<quint64> & grams);
+
+    //加入一首歌，grams可以无序、有重复；这首歌已在索引中时替换旧文档
+    void insert(SongId id, QVector<quint64> grams);
+
+    //删除歌曲，每一段是[first, first + count)，按给出的顺序依次删除，后面的歌曲ID减去count
+    //  和SongListModel::removeSongs返回的各段一致（从后往前）；删除次数加1
+    void removeSongs(const QVector<QPair<int, int>> & ranges);
+
+    //查询，返回包含查询中全部gram的歌曲ID，升序；查询为空时返回空列表
+    //  removals不为空时返回这次查询看到的删除次数
+    QVector<SongId> search(const QString & query, int * removals = nullptr) const;
+
+    int size() const;       //当前文档数
+
+private:
+    struct Postings
+    {
+        Postings() : last(0), count(0) {}
+
+        QByteArray data;    //文档编号的差值，变长整数编码
+        quint32 last;       //最后一个文档编号
+        int count;          //文档数
+
+        void append(quint32 doc);
+        void decode(QVector<quint32> & docs) const;
+    };
+
+    void compact();         //丢弃被删除的文档，重新编号，调用时已持有写锁
+
+private:
+    mutable QReadWriteLock m_lock;
+    QHash<quint64, Postings> m_postings;    //<gram, 倒排表>
+    QVector<SongId> m_ids;                  //文档编号 -> 歌曲ID，被删除的文档为-1
+    QVector<qint32> m_docs;                 //歌曲ID -> 文档编号，不在索引中的歌曲为-1
+    int m_count;                            //没被删除的文档数
+    int m_dead;                             //被删除的文档数
+    int m_removals;                         //执行过的removeSongs次数
+};
+
+#endif // SEARCHINDEX_H
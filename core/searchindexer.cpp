@@ -0,0 +1,68 @@
+#include "searchindexer.h"
+#include "worker.h"
+#include "log.h"
+#include <QElapsedTimer>
+
+//大批量加入时每处理这么多首发出一次indexed信号
+static const int kNotifyInterval = 256;
+
+SearchIndexer::SearchIndexer(QObject *parent)
+    : QObject(parent)
+    , m_cancelled(false)
+{
+    qRegisterMetaType<SearchDocuments>("SearchDocuments");
+    qRegisterMetaType<QVector<QPair<int, int>>>("QVector<QPair<int,int>>");
+}
+
+void SearchIndexer::cancel()
+{
+    m_cancelled.store(true);
+}
+
+/*
+ * 加入一批歌曲
+ *  歌名、歌手、专辑包括1、2个字符的gram，歌词只取trigram
+ *  gram在不持锁时计算好，每首歌只在写入倒排表时短暂持有写锁
+ */
+void SearchIndexer::addSongs(const SearchDocuments & documents)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<quint64> grams;
+    int lyrics = 0;
+    for (int i = 0; i < documents.size(); i++)
+    {
+        if (m_cancelled.load()) { return; }
+
+        const SearchDocument & document = documents[i];
+        grams.clear();
+        SearchIndex::appendGrams(document.name, true, grams);
+        SearchIndex::appendGrams(document.artist, true, grams);
+        SearchIndex::appendGrams(document.album, true, grams);
+
+        if (document.hasLyrics)
+        {
+            LyricTimeline timeline = Worker::readLyrics(document.url);
+            for (const QString & text : timeline.texts())
+            {
+                SearchIndex::appendGrams(text, false, grams);
+            }
+            lyrics++;
+        }
+
+        m_index.insert(document.id, grams);
+
+        if ((i + 1) % kNotifyInterval == 0) { emit indexed(); }
+    }
+
+    LOG_DEBUG(Search) << "搜索索引加入" << documents.size() << "首（歌词" << lyrics << "首），用时"
+                       << timer.elapsed() << "ms，共" << m_index.size() << "首";
+    emit indexed();
+}
+
+void SearchIndexer::removeSongs(const QVector<QPair<int, int>> & ranges)
+{
+    m_index.removeSongs(ranges);
+    emit indexed();
+}
@@ -0,0 +1,57 @@
+#ifndef SEARCHINDEXER_H
+#define SEARCHINDEXER_H
+
+#include <QObject>
+#include <QMetaType>
+#include <QPair>
+#include <QUrl>
+#include <QVector>
+#include <atomic>
+#include "searchindex.h"
+
+/*要加入搜索索引的一首歌，歌词文本由索引线程自己读取*/
+struct SearchDocument
+{
+    SearchDocument() : id(-1), hasLyrics(false) {}
+
+    SongId id;          //歌曲ID，文档用它标识
+    QUrl url;
+    QString name;
+    QString artist;
+    QString album;
+    bool hasLyrics;     //有歌词文件时索引歌词文本
+};
+
+typedef QVector<SearchDocument> SearchDocuments;
+Q_DECLARE_METATYPE(SearchDocuments)
+
+/*搜索索引类，在后台建立和更新搜索索引（见SearchIndex）
+ *  和LoudnessAnalyzer一样是一个移到单独QThread中的对象，主线程通过信号槽投递新加入和删除的歌曲
+ *      读取歌词文件、切分gram都在索引线程中完成，界面线程只做查询
+ *  文档用歌曲ID标识（和SongManager中的编号一致），查询结果直接是歌曲ID；
+ *      主线程删除歌曲后按同样的各段投递removeSongs，索引里后面的歌曲ID跟着前移
+ *  每加入一批歌曲（大批量时每256首）发出一次indexed信号，主线程可以据此刷新正在显示的搜索结果
+ *  cancel可以在任意线程调用，正在处理和排队的请求全部丢弃，用于退出时尽快结束线程
+ */
+class SearchIndexer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SearchIndexer(QObject *parent = nullptr);
+
+    const SearchIndex & index() const { return m_index; }  //查询接口线程安全，可以在主线程直接调用
+    void cancel();
+
+signals:
+    void indexed();     //又有一批歌曲加入了索引
+
+public slots:
+    void addSongs(const SearchDocuments & documents);   //加入或更新歌曲
+    void removeSongs(const QVector<QPair<int, int>> & ranges); //删除歌曲，各段和SongListModel::removeSongs的返回值一致
+
+private:
+    SearchIndex m_index;
+    std::atomic<bool> m_cancelled;
+};
+
+#endif // SEARCHINDEXER_H
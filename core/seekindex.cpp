@@ -0,0 +1,460 @@
+#include "seekindex.h"
+#include "id3reader.h"
+#include <QFile>
+#include <cmath>
+#include <cstring>
+
+//没有信息头的文件，Scan每隔这么长时间记录一项，项数超过上限后间隔加倍
+static const int kScanIntervalMs = 500;
+
+//开头最多在这么多字节里寻找第一个帧，有些文件在标签和音频之间有垃圾数据
+static const qint64 kSyncSearchBytes = 64 * 1024;
+
+//扫描时遇到损坏的帧，最多向后找这么多字节重新同步，找不到就认为音频数据到此结束
+static const qint64 kResyncBytes = 4 * 1024;
+
+//判断是不是固定码率时，在文件中均匀抽查的位置数
+static const int kCbrProbes = 8;
+
+//各版本、各层的码率表（kbps），下标为帧头中的码率编号，0为自由格式，15无效
+static const int kBitratesV1[3][16] = {
+    { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },   //Layer I
+    { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },      //Layer II
+    { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 },       //Layer III
+};
+static const int kBitratesV2[3][16] = {
+    { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },
+    { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },
+    { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },
+};
+static const int kSampleRates[3] = { 44100, 48000, 32000 };
+
+//MPEG音频帧头
+struct FrameHeader
+{
+    int version;            //1为MPEG-1，2为MPEG-2，3为MPEG-2.5
+    int layer;              //1~3
+    int bitrate;            //kbps
+    int sampleRate;
+    int samplesPerFrame;
+    int length;             //整个帧的字节数，包括帧头
+    bool mono;
+
+    //同一个流中的帧，版本、层和采样率都相同
+    bool sameStream(const FrameHeader & other) const
+    {
+        return version == other.version && layer == other.layer && sampleRate == other.sampleRate;
+    }
+};
+
+static inline quint32 bigEndian32(const uchar * p)
+{
+    return ((quint32)p[0] << 24) | ((quint32)p[1] << 16) | ((quint32)p[2] << 8) | (quint32)p[3];
+}
+
+static inline quint32 bigEndian16(const uchar * p)
+{
+    return ((quint32)p[0] << 8) | (quint32)p[1];
+}
+
+//解析4字节的帧头，不是有效的帧头（包括自由格式码率）返回false
+static bool parseHeader(const uchar * p, FrameHeader & header)
+{
+    if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) { return false; }
+
+    const int versionBits = (p[1] >> 3) & 3;
+    const int layerBits = (p[1] >> 1) & 3;
+    const int bitrateIndex = p[2] >> 4;
+    const int rateIndex = (p[2] >> 2) & 3;
+    if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3)
+    {
+        return false;
+    }
+
+    header.version = versionBits == 3 ? 1 : (versionBits == 2 ? 2 : 3);
+    header.layer = 4 - layerBits;
+    header.bitrate = header.version == 1 ? kBitratesV1[header.layer - 1][bitrateIndex]
+                                         : kBitratesV2[header.layer - 1][bitrateIndex];
+    header.sampleRate = kSampleRates[rateIndex] >> (header.version - 1);
+    header.mono = (p[3] >> 6) == 3;
+
+    const int padding = (p[2] >> 1) & 1;
+    if (header.layer == 1)
+    {
+        header.samplesPerFrame = 384;
+        header.length = (12 * header.bitrate * 1000 / header.sampleRate + padding) * 4;
+    }
+    else
+    {
+        //Layer III的MPEG-2/2.5每帧只有一半的采样
+        const bool half = header.layer == 3 && header.version != 1;
+        header.samplesPerFrame = half ? 576 : 1152;
+        header.length = (half ? 72 : 144) * header.bitrate * 1000 / header.sampleRate + padding;
+    }
+    return true;
+}
+
+//pos处是一个有效的帧，并且紧跟着的是同一个流的下一帧（或者正好到数据末尾）
+static bool isFrameAt(const uchar * data, qint64 size, qint64 pos, FrameHeader & header)
+{
+    if (pos + 4 > size || !parseHeader(data + pos, header)) { return false; }
+
+    const qint64 next = pos + header.length;
+    if (next == size) { return true; }
+
+    FrameHeader following;
+    return next + 4 <= size && parseHeader(data + next, following) && following.sameStream(header);
+}
+
+//从pos开始最多找limit字节，返回第一个确认有效的帧的位置，找不到返回-1
+static qint64 findFrame(const uchar * data, qint64 size, qint64 pos, qint64 limit, FrameHeader & header)
+{
+    const qint64 end = qMin(size, pos + limit);
+    for (; pos < end; pos++)
+    {
+        const uchar * ff = static_cast<const uchar *>(memchr(data + pos, 0xFF, end - pos));
+        if (!ff) { return -1; }
+        pos = ff - data;
+        if (isFrameAt(data, size, pos, header)) { return pos; }
+    }
+    return -1;
+}
+
+//Layer III第一帧中信息头的位置：跟在帧头和边信息后面，边信息的长度由版本和声道数决定
+static int xingOffset(const FrameHeader & header)
+{
+    if (header.version == 1) { return 4 + (header.mono ? 17 : 32); }
+    return 4 + (header.mono ? 9 : 17);
+}
+
+/*
+ * 解析第一帧中的Xing/Info头
+ *  LAME给VBR文件写Xing，给固定码率文件写Info，info返回是不是后者
+ *  标志位依次表示有没有总帧数、总字节数、目录和质量，没有总帧数时不能用
+ *  目录第i项为i%时长处的位置占总字节数的比例（乘以256），原样保存；没有目录时toc为空
+ */
+static bool parseXing(const uchar * data, qint64 size, qint64 first, const FrameHeader & header,
+                      bool & info, quint32 & frames, QByteArray & toc)
+{
+    const uchar * p = data + first + xingOffset(header);
+    const uchar * end = data + qMin(size, first + header.length);
+    if (end - p < 12) { return false; }
+    info = memcmp(p, "Info", 4) == 0;
+    if (!info && memcmp(p, "Xing", 4) != 0) { return false; }
+
+    const quint32 flags = bigEndian32(p + 4);
+    p += 8;
+    if (!(flags & 0x1)) { return false; }
+
+    frames = bigEndian32(p);
+    p += 4;
+    if (flags & 0x2) { p += 4; }
+    if ((flags & 0x4) && end - p >= SeekIndex::TocSize)
+    {
+        toc = QByteArray(reinterpret_cast<const char *>(p), SeekIndex::TocSize);
+    }
+    return frames != 0;
+}
+
+/*
+ * 解析第一帧中的VBRI头，固定在帧头后32字节处
+ *  目录每项是framesPerEntry帧的数据长度（乘以scale），累加得到每组帧开头的偏移
+ */
+static bool parseVbri(const uchar * data, qint64 size, qint64 first, const FrameHeader & header,
+                      quint32 & frames, quint32 & framesPerEntry, qint64 & bytes, QVector<quint32> & offsets)
+{
+    const uchar * p = data + first + 4 + 32;
+    const uchar * end = data + size;
+    if (end - p < 26 || memcmp(p, "VBRI", 4) != 0) { return false; }
+
+    const quint32 total = bigEndian32(p + 10);
+    frames = bigEndian32(p + 14);
+    const int entries = (int)bigEndian16(p + 18);
+    const quint32 scale = bigEndian16(p + 20);
+    const int entrySize = (int)bigEndian16(p + 22);
+    framesPerEntry = bigEndian16(p + 24);
+    p += 26;
+    if (frames == 0 || entries == 0 || framesPerEntry == 0 || entrySize < 1 || entrySize > 4) { return false; }
+    if (end - p < (qint64)entries * entrySize) { return false; }
+
+    bytes = qBound<qint64>(0, (qint64)total - header.length, size - first - header.length);
+
+    //第i项是第i组帧的开头，最后一项的累加结果是数据末尾，不需要保存
+    offsets.resize(entries);
+    qint64 offset = 0;
+    for (int i = 0; i < entries; i++, p += entrySize)
+    {
+        offsets[i] = (quint32)qMin(offset, bytes);
+        quint32 value = 0;
+        for (int b = 0; b < entrySize; b++) { value = (value << 8) | p[b]; }
+        offset += (qint64)value * scale;
+    }
+    return true;
+}
+
+//在音频数据中均匀抽查几处的帧，码率都和第一帧相同就当作固定码率
+static bool looksConstant(const uchar * data, qint64 size, qint64 first, const FrameHeader & header)
+{
+    for (int i = 1; i <= kCbrProbes; i++)
+    {
+        const qint64 probe = first + (size - first) * i / (kCbrProbes + 1);
+        FrameHeader found;
+        if (findFrame(data, size, probe, kResyncBytes, found) < 0) { continue; }
+        if (!found.sameStream(header) || found.bitrate != header.bitrate) { return false; }
+    }
+    return true;
+}
+
+/*
+ * 逐帧扫描
+ *  按帧头给出的长度跳到下一帧，只读每帧的帧头；遇到损坏的数据向后重新同步，找不到就结束
+ *  第framesPerEntry的整数倍帧记一项，项数超过上限时只保留偶数项，间隔加倍
+ */
+static quint32 scanFrames(const uchar * data, qint64 size, qint64 first, const FrameHeader & header,
+                          quint32 & framesPerEntry, QVector<quint32> & offsets)
+{
+    framesPerEntry = (quint32)qMax(1, header.sampleRate / header.samplesPerFrame * kScanIntervalMs / 1000);
+    offsets.clear();
+
+    quint32 frames = 0;
+    qint64 pos = first;
+    FrameHeader frame;
+    while (pos + 4 <= size)
+    {
+        if (!parseHeader(data + pos, frame) || !frame.sameStream(header))
+        {
+            pos = findFrame(data, size, pos + 1, kResyncBytes, frame);
+            if (pos < 0 || !frame.sameStream(header)) { break; }
+        }
+        if (pos + frame.length > size) { break; }
+
+        if (frames % framesPerEntry == 0)
+        {
+            if (offsets.size() == SeekIndex::MaxEntries)
+            {
+                for (int i = 0; i < SeekIndex::MaxEntries / 2; i++) { offsets[i] = offsets[2 * i]; }
+                offsets.resize(SeekIndex::MaxEntries / 2);
+                framesPerEntry *= 2;
+            }
+            if (frames % framesPerEntry == 0) { offsets.append((quint32)(pos - first)); }
+        }
+
+        frames++;
+        pos += frame.length;
+    }
+    return frames;
+}
+
+SeekIndex::SeekIndex()
+    : m_source(None)
+    , m_sampleRate(0)
+    , m_samplesPerFrame(0)
+    , m_frames(0)
+    , m_base(0)
+    , m_bytes(0)
+    , m_framesPerEntry(0)
+{
+
+}
+
+SeekIndex::SeekIndex(Source source, int sampleRate, int samplesPerFrame, quint32 frames,
+                     qint64 base, qint64 bytes, const QByteArray & toc)
+    : m_source((quint8)source)
+    , m_sampleRate(sampleRate)
+    , m_samplesPerFrame(samplesPerFrame)
+    , m_frames(frames)
+    , m_base(base)
+    , m_bytes(bytes)
+    , m_framesPerEntry(0)
+{
+    //从歌曲库索引读入的数据不可信，不自洽时当作没有索引；只有Xing有目录，长度不对时丢掉
+    if (source < None || source > Scan || sampleRate <= 0 || samplesPerFrame <= 0 || frames == 0 || base < 0 || bytes <= 0)
+    {
+        m_source = None;
+    }
+    if (m_source == Xing && toc.size() == TocSize)
+    {
+        m_toc = toc;
+    }
+}
+
+/*
+ * 加上偏移表
+ *  偏移表可能来自磁盘缓存，逐项检查：不减小、不超出音频数据，不满足时不用
+ */
+SeekIndex SeekIndex::withTable(quint32 framesPerEntry, const QVector<quint32> & offsets) const
+{
+    if (!needsTable() || framesPerEntry == 0 || offsets.isEmpty())
+    {
+        return *this;
+    }
+    for (int i = 1; i < offsets.size(); i++)
+    {
+        if (offsets[i] < offsets[i - 1] || offsets[i] > m_bytes) { return *this; }
+    }
+
+    SeekIndex index = *this;
+    index.m_framesPerEntry = framesPerEntry;
+    index.m_offsets = offsets;
+    return index;
+}
+
+const char * SeekIndex::sourceName(Source source)
+{
+    switch (source)
+    {
+    case Xing: return "xing";
+    case Vbri: return "vbri";
+    case Cbr: return "cbr";
+    case Scan: return "scan";
+    default: return "none";
+    }
+}
+
+qint64 SeekIndex::duration() const
+{
+    if (!isValid()) { return 0; }
+    return (qint64)m_frames * m_samplesPerFrame * 1000 / m_sampleRate;
+}
+
+/*
+ * 换算跳转位置，都是常数时间
+ *  Cbr：直接算出目标帧的位置，往前退一个字节，解码器同步到的就是目标帧（帧长因为填充字节相差1）
+ *  有偏移表：目标帧之前最近的一项，返回这一项的时间，剩下不到一项的数据由调用者解码后丢掉
+ *  没有偏移表的Xing：目录相邻两项之间按比例插值，落点的时间只能当作请求的时间，误差在1%的时长以内
+ */
+SeekIndex::Point SeekIndex::locate(qint64 ms) const
+{
+    Point point = { -1, ms };
+    if (!isValid()) { return point; }
+
+    ms = qBound<qint64>(0, ms, duration());
+    const qint64 frame = qMin<qint64>(ms * m_sampleRate / ((qint64)m_samplesPerFrame * 1000), m_frames - 1);
+
+    if (m_source == Cbr)
+    {
+        point.offset = m_base + qMax<qint64>(0, frame * m_bytes / m_frames - 1);
+        point.ms = frame * m_samplesPerFrame * 1000 / m_sampleRate;
+        return point;
+    }
+
+    if (hasTable())
+    {
+        const int i = (int)qMin<qint64>(frame / m_framesPerEntry, m_offsets.size() - 1);
+        point.offset = m_base + m_offsets[i];
+        point.ms = (qint64)i * m_framesPerEntry * m_samplesPerFrame * 1000 / m_sampleRate;
+        return point;
+    }
+
+    if (!m_toc.isEmpty())
+    {
+        const uchar * toc = reinterpret_cast<const uchar *>(m_toc.constData());
+        const double percent = (double)ms * TocSize / duration();
+        const int i = qBound(0, (int)percent, TocSize - 1);
+        const double position = toc[i] * (double)m_bytes / 256;
+        const double next = i + 1 < TocSize ? toc[i + 1] * (double)m_bytes / 256 : (double)m_bytes;
+        point.offset = m_base + qBound<qint64>(0, (qint64)(position + (next - position) * (percent - i)), m_bytes - 1);
+    }
+    return point;
+}
+
+/*
+ * 建立索引
+ *  先找到第一个帧，它带着Xing/Info或VBRI头时音频从下一帧开始：
+ *      Xing的总帧数和目录来自信息头，table为true时偏移表从下一帧开始逐帧扫描，否则只访问第一帧
+ *      Info是固定码率文件，总帧数来自信息头，不用抽查；VBRI的偏移表来自信息头的目录
+ *  没有信息头时抽查几处的码率，都相同按固定码率计算，否则逐帧扫描数出总帧数
+ *  table为false时不保留偏移表
+ */
+SeekIndex SeekIndex::build(const char * data, qint64 size, qint64 fileOffset, bool table)
+{
+    const uchar * bytes = reinterpret_cast<const uchar *>(data);
+
+    FrameHeader header;
+    const qint64 first = findFrame(bytes, size, 0, kSyncSearchBytes, header);
+    if (first < 0) { return SeekIndex(); }
+
+    quint32 frames = 0;
+    quint32 framesPerEntry = 0;
+    qint64 audioBytes = 0;
+    QVector<quint32> offsets;
+    const qint64 audioStart = fileOffset + first + header.length;
+
+    bool info = false;
+    QByteArray toc;
+    if (header.layer == 3 && parseXing(bytes, size, first, header, info, frames, toc))
+    {
+        const qint64 audio = first + header.length;
+        if (info)
+        {
+            return SeekIndex(Cbr, header.sampleRate, header.samplesPerFrame, frames, audioStart, size - audio);
+        }
+
+        const SeekIndex index(Xing, header.sampleRate, header.samplesPerFrame, frames, audioStart, size - audio, toc);
+        if (!table) { return index; }
+        scanFrames(bytes, size, audio, header, framesPerEntry, offsets);
+        return index.withTable(framesPerEntry, offsets);
+    }
+    if (header.layer == 3 && parseVbri(bytes, size, first, header, frames, framesPerEntry, audioBytes, offsets))
+    {
+        const SeekIndex index(Vbri, header.sampleRate, header.samplesPerFrame, frames, audioStart, audioBytes);
+        return table ? index.withTable(framesPerEntry, offsets) : index;
+    }
+
+    audioBytes = size - first;
+    if (looksConstant(bytes, size, first, header))
+    {
+        //平均帧长 = 每帧采样数 / 8 * 码率 / 采样率，填充字节让实际帧长在它上下浮动
+        const double frameBytes = header.samplesPerFrame / 8.0 * header.bitrate * 1000 / header.sampleRate;
+        frames = (quint32)qMax<qint64>(1, std::llround(audioBytes / frameBytes));
+        return SeekIndex(Cbr, header.sampleRate, header.samplesPerFrame, frames, fileOffset + first, audioBytes);
+    }
+
+    frames = scanFrames(bytes, size, first, header, framesPerEntry, offsets);
+    const SeekIndex index(Scan, header.sampleRate, header.samplesPerFrame, frames, fileOffset + first, audioBytes);
+    return table ? index.withTable(framesPerEntry, offsets) : index;
+}
+
+/*
+ * 读取文件建立索引
+ *  和ContentHash一样跳过开头的ID3v2标签和末尾的ID3v1标签，音频数据整段内存映射
+ *  Xing、VBRI和固定码率的文件只访问第一帧和抽查的几处；没有信息头的VBR文件、以及table为true时的Xing逐帧扫描，
+ *      会读到整个文件
+ *  映射失败时读入内存
+ */
+SeekIndex SeekIndex::buildFile(const QString & path, bool table)
+{
+    QFile qfile(path);
+    if (!qfile.open(QIODevice::ReadOnly)) { return SeekIndex(); }
+
+    const qint64 fileSize = qfile.size();
+    qint64 begin = 0;
+    qint64 end = fileSize;
+
+    char header[10];
+    if (qfile.read(header, sizeof(header)) == (qint64)sizeof(header))
+    {
+        begin = qMin(Id3Reader::tagSize(header, sizeof(header)), fileSize);
+    }
+
+    char tail[3];
+    if (end - begin >= 128 && qfile.seek(fileSize - 128) && qfile.read(tail, 3) == 3 && memcmp(tail, "TAG", 3) == 0)
+    {
+        end -= 128;
+    }
+
+    const qint64 size = end - begin;
+    if (size <= 0) { return SeekIndex(); }
+
+    uchar * mapped = qfile.map(begin, size);
+    if (mapped)
+    {
+        SeekIndex index = build(reinterpret_cast<const char *>(mapped), size, begin, table);
+        qfile.unmap(mapped);
+        return index;
+    }
+
+    qfile.seek(begin);
+    const QByteArray buffer = qfile.read(size);
+    return build(buffer.constData(), buffer.size(), begin, table);
+}
@@ -0,0 +1,87 @@
+#ifndef SEEKINDEX_H
+#define SEEKINDEX_H
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+
+/*mp3跳转索引，导入时为每个文件建立一次，和歌曲信息一起保存在歌曲库索引中
+ *  把播放位置（毫秒）换算成文件中的字节位置，常数时间，和文件长度无关
+ *  索引的来源按优先级：
+ *      Xing    第一帧里的Xing头（LAME等编码器写入的VBR文件），总帧数和目录取自信息头
+ *      Cbr     第一帧里的Info头（LAME写给固定码率文件的），或者没有信息头、在文件中均匀抽查几处的帧头码率都相同，
+ *                  按固定码率直接计算
+ *      Vbri    第一帧里的VBRI头（Fraunhofer编码器写入），每项记录固定帧数的数据长度
+ *      Scan    以上都不是（没有信息头的VBR文件），逐个帧头跳转数出所有帧
+ *  导入时只保存来源、流参数和Xing的目录（100字节），歌曲管理类和歌曲库索引里没有偏移表
+ *  精确的偏移表：播放中第一次跳转时才建立（见SeekTableCache），每隔一段稀疏地记录帧的位置
+ *      Xing和Scan逐帧扫描，只读每帧开头的4字节，项数超过MaxEntries时间隔加倍、丢掉一半，占用的空间有上限；Vbri取自信息头
+ *      有偏移表时每一项都正好是一帧的开头，时间精确到帧；Cbr落在目标帧附近，解码器向后同步到下一个帧头，误差不超过一帧
+ *      还没有偏移表时Xing按目录插值，只有1%的精度；Vbri和Scan不能跳转
+ *  偏移都相对于第一个音频帧（跳过ID3v2标签和信息头所在的帧），不包括文件末尾的ID3v1标签
+ *  只支持MPEG-1/2/2.5的Layer I/II/III，自由格式码率的文件不建立索引（isValid为false），播放时照常线性跳转
+ *  值类型，目录和偏移表隐式共享，线程安全的只读访问
+ */
+class SeekIndex
+{
+public:
+    enum Source { None, Xing, Vbri, Cbr, Scan };
+    enum { MaxEntries = 1024, TocSize = 100 };
+
+    //跳转的落点：文件中的字节位置，以及这个位置对应的播放时间（毫秒）
+    struct Point
+    {
+        qint64 offset;
+        qint64 ms;
+    };
+
+    SeekIndex();
+    SeekIndex(Source source, int sampleRate, int samplesPerFrame, quint32 frames,
+              qint64 base, qint64 bytes, const QByteArray & toc = QByteArray());
+
+    //读取mp3文件建立索引，文件打不开或者找不到帧时返回无效的索引；table为true时同时建立精确的偏移表
+    static SeekIndex buildFile(const QString & path, bool table = false);
+
+    //从内存中的音频数据建立索引，data是文件中从fileOffset开始的音频数据（不包括ID3标签）
+    static SeekIndex build(const char * data, qint64 size, qint64 fileOffset, bool table = false);
+
+    bool isValid() const { return m_source != None; }
+    bool needsTable() const { return m_source == Xing || m_source == Vbri || m_source == Scan; }    //精确跳转需要偏移表
+    bool hasTable() const { return !m_offsets.isEmpty(); }
+    Source source() const { return Source(m_source); }
+    qint64 duration() const;            //总时长（毫秒）
+
+    //加上偏移表，framesPerEntry或offsets不自洽时返回原来的索引
+    SeekIndex withTable(quint32 framesPerEntry, const QVector<quint32> & offsets) const;
+
+    //位置ms所在的帧的开头（有偏移表时为不晚于ms的最近一项），调用者从offset开始解码，再丢掉ms - Point::ms的数据
+    //  不能跳转时offset为-1
+    Point locate(qint64 ms) const;
+
+    int sampleRate() const { return m_sampleRate; }
+    int samplesPerFrame() const { return m_samplesPerFrame; }
+    quint32 frames() const { return m_frames; }
+    qint64 base() const { return m_base; }          //第一个音频帧在文件中的位置
+    qint64 bytes() const { return m_bytes; }        //音频数据的字节数
+    const QByteArray & toc() const { return m_toc; }    //Xing的目录，第i项是i%时长处的位置占音频数据的比例（乘以256）
+    quint32 framesPerEntry() const { return m_framesPerEntry; }
+    const QVector<quint32> & offsets() const { return m_offsets; }
+
+    static const char * sourceName(Source source);  //用于日志
+
+private:
+    quint8 m_source;
+    int m_sampleRate;
+    int m_samplesPerFrame;
+    quint32 m_frames;
+    qint64 m_base;
+    qint64 m_bytes;
+    QByteArray m_toc;                   //Xing的目录，没有时为空
+    quint32 m_framesPerEntry;           //偏移表每项间隔的帧数
+    QVector<quint32> m_offsets;         //偏移表，各项相对于m_base的偏移；还没有建立时为空
+};
+
+Q_DECLARE_METATYPE(SeekIndex)
+
+#endif // SEEKINDEX_H
@@ -0,0 +1,147 @@
+#include "seektablecache.h"
+#include "song.h"
+#include "log.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+
+//磁盘缓存的总大小上限，超过时从最早写入的文件开始删除；一个偏移表最多4KB
+static const qint64 kMaxDiskBytes = 16 * 1024 * 1024;
+
+//缓存文件中路径之后的固定部分：来源、总帧数、第一个音频帧的位置、音频数据字节数、每项间隔的帧数、项数
+struct TableHeader
+{
+    quint32 source;
+    quint32 frames;
+    qint64 base;
+    qint64 bytes;
+    quint32 framesPerEntry;
+    quint32 count;
+};
+
+//缓存文件：路径的UTF-8长度（4字节）、路径、TableHeader、偏移表；参数和index不一致时不用
+static SeekIndex loadFromDisk(const QString & cachePath, const QString & path, const SeekIndex & index)
+{
+    QFile file(cachePath);
+    if (!file.open(QIODevice::ReadOnly)) { return index; }
+
+    const QByteArray data = file.readAll();
+    const QByteArray utf8 = path.toUtf8();
+    quint32 size = 0;
+    if (data.size() < 4) { return index; }
+    memcpy(&size, data.constData(), 4);
+    if (size != (quint32)utf8.size() || data.size() < 4 + utf8.size() + (int)sizeof(TableHeader)
+            || memcmp(data.constData() + 4, utf8.constData(), utf8.size()) != 0)
+    {
+        return index;
+    }
+
+    TableHeader header;
+    memcpy(&header, data.constData() + 4 + utf8.size(), sizeof(header));
+    const int tableOffset = 4 + utf8.size() + (int)sizeof(header);
+    if (header.source != (quint32)index.source() || header.frames != index.frames()
+            || header.base != index.base() || header.bytes != index.bytes()
+            || (qint64)header.count * sizeof(quint32) != data.size() - tableOffset)
+    {
+        return index;
+    }
+
+    QVector<quint32> offsets((int)header.count);
+    memcpy(offsets.data(), data.constData() + tableOffset, header.count * sizeof(quint32));
+    return index.withTable(header.framesPerEntry, offsets);
+}
+
+static void saveToDisk(const QString & cachePath, const QString & path, const SeekIndex & index)
+{
+    const QByteArray utf8 = path.toUtf8();
+    const quint32 size = (quint32)utf8.size();
+
+    TableHeader header;
+    memset(&header, 0, sizeof(header));
+    header.source = (quint32)index.source();
+    header.frames = index.frames();
+    header.base = index.base();
+    header.bytes = index.bytes();
+    header.framesPerEntry = index.framesPerEntry();
+    header.count = (quint32)index.offsets().size();
+
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly)) { return; }
+    file.write(reinterpret_cast<const char *>(&size), 4);
+    file.write(utf8);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(index.offsets().constData()), index.offsets().size() * sizeof(quint32));
+    if (!file.commit())
+    {
+        LOG_WARNING(Playback) << "跳转表缓存保存失败：" << cachePath;
+    }
+}
+
+//磁盘缓存超过kMaxDiskBytes时，从最早写入的文件开始删除，直到总大小降到上限以内
+static void trimDisk(const QString & dir)
+{
+    const QFileInfoList files = QDir(dir).entryInfoList(QStringList() << "*.skt", QDir::Files, QDir::Time);
+    qint64 total = 0;
+    int removed = 0;
+    for (const QFileInfo & info : files)
+    {
+        total += info.size();
+        if (total > kMaxDiskBytes && QFile::remove(info.filePath()))
+        {
+            removed++;
+        }
+    }
+
+    if (removed > 0)
+    {
+        LOG_DEBUG(Playback) << "跳转表缓存超过上限，删除：" << removed << "个文件";
+    }
+}
+
+/*
+ * 读取偏移表
+ *  Cbr不需要偏移表，已经带着偏移表的索引原样返回
+ *  扫描得到的索引和导入时的参数不一致（文件在导入之后被改过）时不用，按导入时的索引跳转，重新导入后会更新
+ */
+SeekIndex SeekTableCache::load(const QString & mp3Path, const SeekIndex & index)
+{
+    if (!index.needsTable() || index.hasTable()) { return index; }
+
+    const QString cachePath = diskPath(mp3Path);
+    SeekIndex cached = loadFromDisk(cachePath, mp3Path, index);
+    if (cached.hasTable()) { return cached; }
+
+    QElapsedTimer timer;
+    timer.start();
+    const SeekIndex built = SeekIndex::buildFile(mp3Path, true);
+    if (!built.hasTable() || built.source() != index.source() || built.frames() != index.frames()
+            || built.base() != index.base() || built.bytes() != index.bytes())
+    {
+        LOG_INFO(Playback) << "跳转表建立失败或者和导入时不一致：" << mp3Path;
+        return index;
+    }
+
+    LOG_DEBUG(Playback) << "建立跳转表：" << SeekIndex::sourceName(built.source()) << built.offsets().size() << "项，用时"
+                        << timer.elapsed() << "ms";
+    saveToDisk(cachePath, mp3Path, built);
+    trimDisk(QFileInfo(cachePath).absolutePath());
+    return index.withTable(built.framesPerEntry(), built.offsets());
+}
+
+QString SeekTableCache::diskPath(const QString & mp3Path)
+{
+    static const QString dir = []() {
+        QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/seektables";
+        QDir().mkpath(path);
+        return path;
+    }();
+
+    FileStamp stamp = FileStamp::of(QFileInfo(mp3Path));
+    return QString("%1/%2-%3-%4.skt").arg(dir)
+            .arg(qHash(mp3Path), 8, 16, QChar('0'))
+            .arg(stamp.fileTime, 0, 16)
+            .arg(stamp.fileSize, 0, 16);
+}
@@ -0,0 +1,25 @@
+#ifndef SEEKTABLECACHE_H
+#define SEEKTABLECACHE_H
+
+#include <QString>
+#include "seekindex.h"
+
+/*跳转偏移表的磁盘缓存
+ *  歌曲管理类和歌曲库索引只保存跳转索引的参数和Xing的目录，精确的偏移表在播放中第一次跳转时才需要（见SeekIndex）
+ *      建立偏移表要逐帧扫描整个文件，结果按文件存在磁盘上，以后再跳转这首歌只读一个几KB的文件
+ *      偏移表只在当前歌曲需要时读入，歌曲库保存时也不用重写
+ *  和波形缓存一样放在应用数据目录下（seektables），每首歌一个文件，文件名包含路径的哈希和文件戳，
+ *      文件变化后自然换一个文件名；文件内容中也保存完整路径和索引参数，读入时核对
+ *  总大小有上限，超过时删除最早写入的文件，被删掉的偏移表下次跳转时重新扫描
+ *  只在解码线程中调用
+ */
+class SeekTableCache
+{
+public:
+    //index加上mp3Path的偏移表：先读磁盘缓存，没有时读取文件逐帧扫描，写入缓存；失败时返回原来的索引
+    static SeekIndex load(const QString & mp3Path, const SeekIndex & index);
+
+    static QString diskPath(const QString & mp3Path);  //一首歌当前文件戳对应的缓存文件
+};
+
+#endif // SEEKTABLECACHE_H
@@ -0,0 +1,331 @@
+#include "song.h"
+#include <QDebug>
+#include <algorithm>
+
+Song::Song()
+    : m_lyricCount(0), m_fileTime(0), m_fileSize(0), m_lyricTime(0), m_contentHash(0)
+    , m_loudness(qQNaN()), m_truePeak(0)
+{
+
+}
+
+QDebug& operator<<(QDebug& debug, const Song& song)
+{
+    debug << song.m_url << ", "
+          << song.m_name << ", "
+          << song.m_artist << ", "
+          << song.m_album << ", "
+          << "歌词行数：" << song.m_lyricCount;
+    return debug;
+}
+
+FileStamp FileStamp::of(const QFileInfo & mp3Info)
+{
+    QFileInfo lrcInfo(mp3Info.filePath().replace(".mp3", ".lrc"));
+
+    FileStamp stamp;
+    stamp.fileTime = mp3Info.lastModified().toMSecsSinceEpoch();
+    stamp.fileSize = mp3Info.size();
+    stamp.lyricTime = lrcInfo.isFile() ? lrcInfo.lastModified().toMSecsSinceEpoch() : 0;
+    return stamp;
+}
+
+int StringPool::intern(const QString & text)
+{
+    auto it = m_ids.constFind(text);
+    if (it != m_ids.constEnd()) { return it.value(); }
+
+    int id = m_strings.size();
+    m_strings.append(text);
+    m_ids.insert(text, id);
+    return id;
+}
+
+void StringPool::clear()
+{
+    m_strings.clear();
+    m_ids.clear();
+    intern(QString());  //编号0为空字符串
+}
+
+void SongManager::clear()
+{
+    m_dirs.clear();
+    m_fileNames.clear();
+    m_names.clear();
+    m_artists.clear();
+    m_albums.clear();
+    m_lyricCounts.clear();
+    m_fileTimes.clear();
+    m_fileSizes.clear();
+    m_lyricTimes.clear();
+    m_contentHashes.clear();
+    m_loudness.clear();
+    m_truePeaks.clear();
+    m_seekIndexes.clear();
+    m_dirPool.clear();
+    m_artistPool.clear();
+    m_albumPool.clear();
+    m_index.clear();
+    m_contentIndex.clear();
+    m_lyricCache.clear();
+}
+
+//第id首歌的路径是否等于path：按最后一个'/'拆成目录和文件名分别比较，不拼接字符串
+bool SongManager::matches(SongId id, const QString& path) const
+{
+    int slash = path.lastIndexOf('/');
+    return path.midRef(slash + 1) == m_fileNames[id]
+            && path.leftRef(slash + 1) == m_dirPool.at(m_dirs[id]);
+}
+
+SongId SongManager::find(const QUrl& mp3Url) const
+{
+    return findPath(mp3Url.toString());
+}
+
+SongId SongManager::findPath(const QString& path) const
+{
+    const uint hash = pathHash(path);
+    auto it = m_index.constFind(hash);
+    while (it != m_index.constEnd() && it.key() == hash)
+    {
+        if (matches(it.value(), path)) { return it.value(); }
+        ++it;
+    }
+    return -1;
+}
+
+QUrl SongManager::url(SongId id) const
+{
+    return QUrl(m_dirPool.at(m_dirs[id]) + m_fileNames[id]);
+}
+
+Song SongManager::song(SongId id) const
+{
+    Song song(url(id), name(id), artist(id), album(id));
+    song.lyricCount(m_lyricCounts[id]);
+    song.fileTime(m_fileTimes[id]);
+    song.fileSize(m_fileSizes[id]);
+    song.lyricTime(m_lyricTimes[id]);
+    song.contentHash(m_contentHashes[id]);
+    song.loudness(m_loudness[id], m_truePeaks[id]);
+    song.seekIndex(m_seekIndexes[id]);
+    return song;
+}
+
+SongId SongManager::findContent(quint64 hash) const
+{
+    if (hash == 0) { return -1; }
+
+    auto it = m_contentIndex.constFind(hash);
+    return it != m_contentIndex.constEnd() ? it.value() : -1;
+}
+
+QVector<SongId> SongManager::duplicates(SongId id) const
+{
+    QVector<SongId> result;
+    quint64 hash = m_contentHashes[id];
+    if (hash == 0)
+    {
+        result.append(id);
+        return result;
+    }
+
+    result = m_contentIndex.values(hash).toVector();
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+//更新第id首歌的音频哈希，同时维护内容哈希索引
+void SongManager::setContentHash(SongId id, quint64 hash)
+{
+    quint64 old = m_contentHashes[id];
+    if (old == hash) { return; }
+
+    if (old != 0) { m_contentIndex.remove(old, id); }
+    if (hash != 0) { m_contentIndex.insert(hash, id); }
+    m_contentHashes[id] = hash;
+}
+
+//把歌曲对象的数据写入第id行（路径不变）
+void SongManager::assign(SongId id, const Song& song)
+{
+    m_names[id] = song.name();
+    m_artists[id] = m_artistPool.intern(song.artist());
+    m_albums[id] = m_albumPool.intern(song.album());
+    m_lyricCounts[id] = song.lyricCount();
+    m_fileTimes[id] = song.fileTime();
+    m_fileSizes[id] = song.fileSize();
+    m_lyricTimes[id] = song.lyricTime();
+    //重新解析时没有计算哈希（比如关闭了内容哈希），保留原来的值
+    if (song.contentHash() != 0) { setContentHash(id, song.contentHash()); }
+    m_loudness[id] = song.loudness();
+    m_truePeaks[id] = song.truePeak();
+    m_seekIndexes[id] = song.seekIndex();
+}
+
+void SongManager::setLoudness(SongId id, float loudness, float truePeak)
+{
+    m_loudness[id] = loudness;
+    m_truePeaks[id] = truePeak;
+}
+
+/*
+ * 添加歌曲
+ *  路径已存在时就地更新这一行（比如文件变化后重新解析），歌曲ID不变
+ *  否则在各列末尾追加一行，新ID为原来的歌曲数量
+ *  歌曲对象的数据复制完后释放
+ */
+SongId SongManager::addSong(Song* song)
+{
+    if (!song) { return -1; }
+
+    SongId id = find(song->url());
+    if (id < 0)
+    {
+        const QString path = song->url().toString();
+        int slash = path.lastIndexOf('/');
+
+        id = size();
+        m_dirs.append(m_dirPool.intern(path.left(slash + 1)));
+        m_fileNames.append(path.mid(slash + 1));
+        m_names.append(QString());
+        m_artists.append(0);
+        m_albums.append(0);
+        m_lyricCounts.append(0);
+        m_fileTimes.append(0);
+        m_fileSizes.append(0);
+        m_lyricTimes.append(0);
+        m_contentHashes.append(0);
+        m_loudness.append(qQNaN());
+        m_truePeaks.append(0);
+        m_seekIndexes.append(SeekIndex());
+        m_index.insert(pathHash(path), id);
+    }
+
+    assign(id, *song);
+    delete song;
+    return id;
+}
+
+//删除索引中ID在[first, first + count)中的项，后面的ID减去count
+template <typename Key>
+static void shiftIds(QMultiHash<Key, SongId> & index, SongId first, int count)
+{
+    for (auto it = index.begin(); it != index.end(); )
+    {
+        if (it.value() < first)
+        {
+            ++it;
+        }
+        else if (it.value() < first + count)
+        {
+            it = index.erase(it);
+        }
+        else
+        {
+            it.value() -= count;
+            ++it;
+        }
+    }
+}
+
+/*
+ * 删除一段连续ID的歌曲
+ *  先修正路径索引和内容哈希索引：删除这一段的ID，后面的ID减去count；只比较整数，不用重新计算路径哈希
+ *  再从各列中删除这一段，字符串池中的字符串保留，下次添加相同的字符串时复用
+ */
+void SongManager::removeSongs(SongId first, int count)
+{
+    if (first < 0 || count <= 0 || first + count > size()) { return; }
+
+    shiftIds(m_index, first, count);
+    shiftIds(m_contentIndex, first, count);
+
+    m_dirs.remove(first, count);
+    m_fileNames.remove(first, count);
+    m_names.remove(first, count);
+    m_artists.remove(first, count);
+    m_albums.remove(first, count);
+    m_lyricCounts.remove(first, count);
+    m_fileTimes.remove(first, count);
+    m_fileSizes.remove(first, count);
+    m_lyricTimes.remove(first, count);
+    m_contentHashes.remove(first, count);
+    m_loudness.remove(first, count);
+    m_truePeaks.remove(first, count);
+    m_seekIndexes.remove(first, count);
+}
+
+//先找出目录池中在该目录下的目录编号，再按编号扫描目录列，不用逐首拼接路径比较
+FileStamps SongManager::stamps(const QString& dir, bool recursive) const
+{
+    const QString prefix = dir.endsWith('/') ? dir : dir + '/';
+
+    QVector<bool> inDir(m_dirPool.size(), false);
+    for (int i = 0; i < m_dirPool.size(); i++)
+    {
+        const QString & path = m_dirPool.at(i);
+        inDir[i] = recursive ? path.startsWith(prefix) : path == prefix;
+    }
+
+    FileStamps result;
+    for (SongId id = 0; id < size(); id++)
+    {
+        if (!inDir[m_dirs[id]]) { continue; }
+
+        FileStamp stamp;
+        stamp.fileTime = m_fileTimes[id];
+        stamp.fileSize = m_fileSizes[id];
+        stamp.lyricTime = m_lyricTimes[id];
+        result.insert(m_dirPool.at(m_dirs[id]) + m_fileNames[id], stamp);
+    }
+    return result;
+}
+
+QStringList SongManager::directories() const
+{
+    QVector<bool> used(m_dirPool.size(), false);
+    for (int dir : m_dirs)
+    {
+        used[dir] = true;
+    }
+
+    QStringList result;
+    for (int i = 0; i < used.size(); i++)
+    {
+        if (!used[i]) { continue; }
+
+        QString path = m_dirPool.at(i);
+        path.chop(1);   //去掉末尾的'/'
+        result.append(path);
+    }
+    return result;
+}
+
+LyricsPtr SongManager::lyrics(const QUrl& url)
+{
+    static const LyricsPtr empty(new LyricTimeline);
+
+    SongId id = find(url);
+    if (id < 0 || m_lyricCounts[id] == 0)
+    {
+        return empty;
+    }
+
+    LyricsPtr lyrics = m_lyricCache.find(url);
+    if (!lyrics)
+    {
+        m_lyricCache.request(url);
+    }
+    return lyrics;
+}
+
+void SongManager::prefetchLyrics(const QUrl& url)
+{
+    SongId id = find(url);
+    if (id < 0 || m_lyricCounts[id] == 0) { return; }
+
+    m_lyricCache.request(url);
+}
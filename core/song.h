@@ -0,0 +1,258 @@
+#ifndef SONG_H
+#define SONG_H
+
+
+/*歌曲类，
+ * 封装媒体文件路径url、歌曲名name、歌手artist、专辑名album等歌曲信息，
+ * 歌词本身不常驻在歌曲对象中，只记录歌词行数，需要时通过SongManager::lyrics按需加载
+ */
+#include <QUrl>
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QSharedPointer>
+#include <QFileInfo>
+#include <QMetaType>
+#include <QtNumeric>
+#include "lyrictimeline.h"
+#include "lyriccache.h"
+#include "seekindex.h"
+
+class Song
+{
+private:
+    QUrl m_url;
+    QString m_name;
+    QString m_artist;
+    QString m_album;
+    int m_lyricCount;       //歌词行数，0表示没有歌词
+    qint64 m_fileTime;      //解析时媒体文件的修改时间（毫秒），和文件大小一起作为文件戳，判断文件是否变化
+    qint64 m_fileSize;      //解析时媒体文件的大小
+    qint64 m_lyricTime;     //解析时歌词文件的修改时间，没有歌词文件为0
+    quint64 m_contentHash;  //音频数据的哈希（见ContentHash），没有计算过为0
+    float m_loudness;       //综合响度（LUFS，见LoudnessMeter），还没有分析过为NaN
+    float m_truePeak;       //真峰值（线性值）
+    SeekIndex m_seekIndex;  //跳转索引，导入时建立
+public:
+    Song();
+    Song(const QUrl & url,
+         const QString & name,
+         const QString & artist,
+         const QString & album)
+        : m_url(url), m_name(name), m_artist(artist), m_album(album)
+        , m_lyricCount(0), m_fileTime(0), m_fileSize(0), m_lyricTime(0), m_contentHash(0)
+        , m_loudness(qQNaN()), m_truePeak(0)
+    {}
+
+    //get系列方法，可以根据常量方法的常量修饰符进行重载
+    //  针对读取方法，定义成常量方法，可供非常量对象和常量对象一起使用
+    const QUrl & url() const { return m_url; }
+    QUrl url() { return m_url; }
+    //set方法
+    void url(const QUrl & url) { m_url = url; }
+
+    const QString & name() const { return m_name; }
+    const QString & artist() const { return m_artist; }
+    const QString & album() const { return m_album; }
+    void name(const QString & name) { m_name = name; }
+    void artist(const QString & artist) { m_artist = artist; }
+    void album(const QString & album) { m_album = album; }
+
+    int lyricCount() const { return m_lyricCount; }
+    void lyricCount(int count) { m_lyricCount = count; }
+
+    qint64 fileTime() const { return m_fileTime; }
+    qint64 fileSize() const { return m_fileSize; }
+    qint64 lyricTime() const { return m_lyricTime; }
+    void fileTime(qint64 time) { m_fileTime = time; }
+    void fileSize(qint64 size) { m_fileSize = size; }
+    void lyricTime(qint64 time) { m_lyricTime = time; }
+
+    quint64 contentHash() const { return m_contentHash; }
+    void contentHash(quint64 hash) { m_contentHash = hash; }
+
+    bool hasLoudness() const { return !qIsNaN(m_loudness); }
+    float loudness() const { return m_loudness; }
+    float truePeak() const { return m_truePeak; }
+    void loudness(float loudness, float truePeak) { m_loudness = loudness; m_truePeak = truePeak; }
+
+    const SeekIndex & seekIndex() const { return m_seekIndex; }
+    void seekIndex(const SeekIndex & index) { m_seekIndex = index; }
+
+    //重载输出Song类对象的输出运算符函数，输出流类型使用QDebug&
+    //注意：头文件声明友元，源文件里定义函数
+    friend QDebug& operator<<(QDebug & debug, const Song & song);
+};
+
+/*文件戳，媒体文件的修改时间和大小加上歌词文件的修改时间（没有歌词文件为0）
+ *  和歌曲对象中记录的值比较，判断歌曲文件是否变化、是否需要重新解析
+ */
+struct FileStamp
+{
+    qint64 fileTime;
+    qint64 fileSize;
+    qint64 lyricTime;
+
+    bool operator==(const FileStamp & other) const
+    {
+        return fileTime == other.fileTime && fileSize == other.fileSize && lyricTime == other.lyricTime;
+    }
+    bool operator!=(const FileStamp & other) const { return !(*this == other); }
+
+    static FileStamp of(const QFileInfo & mp3Info);    //读取媒体文件和同名歌词文件当前的文件戳
+};
+
+/*一批歌曲的文件戳，<路径, 文件戳>，用于文件夹增量扫描*/
+typedef QHash<QString, FileStamp> FileStamps;
+Q_DECLARE_METATYPE(FileStamps)
+
+/*字符串池，相同的字符串只保存一份，用整数编号引用
+ *  编号0固定为空字符串
+ *  用于歌手、专辑、目录这类大量重复的字符串
+ */
+class StringPool
+{
+private:
+    QVector<QString> m_strings;     //编号 -> 字符串
+    QHash<QString, int> m_ids;      //字符串 -> 编号
+
+public:
+    StringPool() { clear(); }
+
+    int intern(const QString & text);
+    const QString & at(int id) const { return m_strings[id]; }
+    int size() const { return m_strings.size(); }
+    void clear();
+};
+
+/*歌曲ID，歌曲在歌曲管理类中的下标，按添加顺序从0开始连续编号，和播放列表的顺序一致*/
+typedef int SongId;
+
+/*歌曲对象管理类，管理运行时添加的所有歌曲
+ *  实现为单例类
+ *  按列存储（structure of arrays）：每个字段一个连续数组，第id个元素属于第id首歌
+ *      歌手、专辑、目录放在字符串池中，每首歌只存一个整数编号，相同的字符串只存一份
+ *      路径拆成目录编号 + 文件名，不重复保存目录部分
+ *  路径到ID的哈希索引只保存<路径哈希值, ID>，查找时再和目录、文件名比较确认，不另存一份完整路径
+ *  所有查询接口都不会插入数据，查不到返回-1或空值
+ *  添加歌曲接口，接收歌曲对象指针，数据复制到各列后释放该对象；路径已存在时就地更新
+ *  根据歌曲url，返回某首歌的歌词（按需加载，见LyricCache）
+ *  删除歌曲接口，删除一段连续ID的歌曲，后面歌曲的ID依次前移，和播放列表删除后的顺序一致
+ *  响度分析结果（回放增益用）和其他字段一样按列存储，文件变化后重新解析时清空，等待重新分析
+ *  跳转索引（见SeekIndex）也按列存储，跳转时按它把播放位置换算成文件位置；只有参数和Xing的目录，
+ *      没有偏移表，精确的偏移表由解码端在第一次跳转时读取或建立（见SeekTableCache）
+ *  内容哈希索引<音频哈希, ID>，音频数据相同的歌曲（同一首歌的不同副本）归为一组，没有哈希的歌曲不进索引
+ *  只在主线程访问
+ */
+class SongManager
+{
+private:
+    //各列数据，下标为歌曲ID
+    QVector<int> m_dirs;            //目录在m_dirPool中的编号，目录带末尾的'/'
+    QVector<QString> m_fileNames;   //文件名
+    QVector<QString> m_names;       //歌名
+    QVector<int> m_artists;         //歌手在m_artistPool中的编号
+    QVector<int> m_albums;          //专辑在m_albumPool中的编号
+    QVector<int> m_lyricCounts;
+    QVector<qint64> m_fileTimes;
+    QVector<qint64> m_fileSizes;
+    QVector<qint64> m_lyricTimes;
+    QVector<quint64> m_contentHashes;
+    QVector<float> m_loudness;      //综合响度，NaN表示还没有分析过
+    QVector<float> m_truePeaks;
+    QVector<SeekIndex> m_seekIndexes;
+
+    StringPool m_dirPool;
+    StringPool m_artistPool;
+    StringPool m_albumPool;
+
+    QMultiHash<uint, SongId> m_index;   //<路径的哈希值, 歌曲ID>
+    QMultiHash<quint64, SongId> m_contentIndex; //<音频哈希, 歌曲ID>
+
+    //歌词缓存，按需加载当前播放和预取的歌曲的歌词
+    LyricCache m_lyricCache;
+
+private:
+    SongManager() {}
+    SongManager(const SongManager& other) {}
+    ~SongManager() { clear(); }
+
+public:
+    static SongManager& getInstance()
+    {
+        static SongManager instance;
+        return instance;
+    }
+
+    //查询歌曲数量size
+    int size() const { return m_names.size(); }
+
+    //清空歌曲接口clear
+    void clear();
+
+    //根据歌曲url查找歌曲ID，没有这首歌返回-1
+    SongId find(const QUrl& mp3Url) const;
+
+    //按路径字符串（QUrl::toString的结果）查找歌曲ID，调用者已经有路径字符串时不用构造QUrl
+    SongId findPath(const QString& path) const;
+
+    //是否包含某首歌接口
+    bool contains(const QUrl& mp3Url) const { return find(mp3Url) >= 0; }
+
+    //按ID读取各个字段，调用者保证ID有效
+    QUrl url(SongId id) const;
+    const QString& name(SongId id) const { return m_names[id]; }
+    const QString& artist(SongId id) const { return m_artistPool.at(m_artists[id]); }
+    const QString& album(SongId id) const { return m_albumPool.at(m_albums[id]); }
+    int lyricCount(SongId id) const { return m_lyricCounts[id]; }
+    qint64 fileTime(SongId id) const { return m_fileTimes[id]; }
+    qint64 fileSize(SongId id) const { return m_fileSizes[id]; }
+    qint64 lyricTime(SongId id) const { return m_lyricTimes[id]; }
+    quint64 contentHash(SongId id) const { return m_contentHashes[id]; }
+    bool hasLoudness(SongId id) const { return !qIsNaN(m_loudness[id]); }
+    float loudness(SongId id) const { return m_loudness[id]; }
+    float truePeak(SongId id) const { return m_truePeaks[id]; }
+    const SeekIndex & seekIndex(SongId id) const { return m_seekIndexes[id]; }
+
+    //记录第id首歌的响度分析结果
+    void setLoudness(SongId id, float loudness, float truePeak);
+
+    //音频哈希为hash的任意一首歌的ID，没有返回-1；hash为0时总是返回-1
+    SongId findContent(quint64 hash) const;
+
+    //和第id首歌音频数据相同的所有歌曲（包括它自己），按ID从小到大排列
+    QVector<SongId> duplicates(SongId id) const;
+
+    //按ID构造一个歌曲对象（值），用于需要完整歌曲信息的地方
+    Song song(SongId id) const;
+
+    //根据歌曲url，返回某首歌的歌词
+    //  没有这首歌或者没有歌词时返回空的歌词时间轴
+    //  歌词还没加载时返回空指针，同时在后台开始加载，加载完成后歌词缓存发出loaded信号
+    LyricsPtr lyrics(const QUrl& url);
+
+    //预取某首歌的歌词（比如下一首），不等待结果
+    void prefetchLyrics(const QUrl& url);
+
+    LyricCache& lyricCache() { return m_lyricCache; }
+
+    //添加歌曲接口，接收歌曲对象指针并负责释放，返回歌曲ID
+    SongId addSong(Song* song);
+
+    //删除歌曲接口，删除ID为[first, first + count)的歌曲
+    void removeSongs(SongId first, int count);
+
+    //某个目录下所有歌曲的文件戳，recursive为true时包括所有子目录
+    FileStamps stamps(const QString& dir, bool recursive) const;
+
+    //所有歌曲所在的目录
+    QStringList directories() const;
+
+private:
+    static uint pathHash(const QString& path) { return qHash(path); }
+    bool matches(SongId id, const QString& path) const;
+    void assign(SongId id, const Song& song);
+    void setContentHash(SongId id, quint64 hash);
+};
+
+#endif // SONG_H
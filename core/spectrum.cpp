@@ -0,0 +1,74 @@
+#include "spectrum.h"
+#include <cmath>
+
+static const double kPi = 3.14159265358979323846;
+
+Spectrum::Spectrum(int fftSize, int bands, float minHz, float maxHz)
+    : m_fft(fftSize)
+    , m_bands(bands)
+    , m_minHz(minHz)
+    , m_maxHz(maxHz)
+    , m_sampleRate(0)
+{
+    // 汉宁窗的相干增益是0.5，满幅正弦波的|X| = N/4
+    m_scale = 16.0f / ((float)fftSize * fftSize);
+
+    m_window.resize(fftSize);
+    for (int i = 0; i < fftSize; i++)
+    {
+        m_window[i] = (float)(0.5 - 0.5 * std::cos(2.0 * kPi * i / fftSize));
+    }
+    m_windowed.resize(fftSize);
+    m_power.resize(fftSize / 2 + 1);
+    m_edges.resize(bands + 1);
+
+    setSampleRate(44100);
+}
+
+void Spectrum::setSampleRate(int sampleRate)
+{
+    if (sampleRate <= 0 || sampleRate == m_sampleRate) { return; }
+    m_sampleRate = sampleRate;
+
+    const int n = fftSize();
+    const int lastBin = n / 2;
+    const float maxHz = qMin(m_maxHz, sampleRate / 2.0f);
+    const double ratio = std::log((double)maxHz / m_minHz);
+
+    int previous = 0;
+    for (int b = 0; b <= m_bands; b++)
+    {
+        double hz = m_minHz * std::exp(ratio * b / m_bands);
+        int bin = (int)std::floor(hz * n / sampleRate + 0.5);
+        if (b > 0) { bin = qMax(bin, previous + 1); }
+        bin = qBound(1, bin, lastBin + 1);
+        m_edges[b] = bin;
+        previous = bin;
+    }
+}
+
+void Spectrum::process(const float * samples, float * out)
+{
+    const int n = fftSize();
+    const float * window = m_window.constData();
+    float * windowed = m_windowed.data();
+    for (int i = 0; i < n; i++)
+    {
+        windowed[i] = samples[i] * window[i];
+    }
+
+    m_fft.power(windowed, m_power.data());
+
+    const float * power = m_power.constData();
+    for (int b = 0; b < m_bands; b++)
+    {
+        float peak = 0.0f;
+        for (int k = m_edges[b]; k < m_edges[b + 1]; k++)
+        {
+            peak = qMax(peak, power[k]);
+        }
+
+        float db = 10.0f * std::log10(peak * m_scale + 1e-12f);
+        out[b] = qBound(0.0f, (db + FloorDb) / FloorDb, 1.0f);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <QVector>
+#include "realfft.h"
+
+/*频谱分析：对一段单声道采样加汉宁窗、做实数FFT，再按对数频率分成若干个频带
+ *  频带在minHz~maxHz之间按对数等分，每个频带取其中最大的功率；低频的频带比一个FFT频点还窄时至少占一个频点
+ *  结果换算成分贝，满幅正弦波为0dB，-FloorDb以下为0，输出0~1
+ *  构造和setSampleRate时分配和计算所有表，process不分配内存
+ */
+class Spectrum
+{
+public:
+    enum { FloorDb = 72 };
+
+    Spectrum(int fftSize, int bands, float minHz = 40.0f, float maxHz = 16000.0f);
+
+    int fftSize() const { return m_fft.size(); }
+    int bands() const { return m_bands; }
+    int sampleRate() const { return m_sampleRate; }
+    void setSampleRate(int sampleRate);     //重新计算每个频带对应的频点
+
+    //samples是fftSize个按时间顺序的采样，out至少有bands个元素
+    void process(const float * samples, float * out);
+
+private:
+    RealFft m_fft;
+    int m_bands;
+    float m_minHz;
+    float m_maxHz;
+    int m_sampleRate;
+    float m_scale;              //功率归一化系数，满幅正弦波对应1
+    QVector<float> m_window;
+    QVector<float> m_windowed;
+    QVector<float> m_power;
+    QVector<int> m_edges;       //第b个频带是频点[m_edges[b], m_edges[b+1])
+};
+
+#endif // SPECTRUM_H
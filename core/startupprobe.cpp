@@ -0,0 +1,117 @@
+#include "startupprobe.h"
+#include "log.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <time.h>
+#include <unistd.h>
+#endif
+
+//预留的阶段数，启动过程的阶段不会超过这么多，记录时不用扩容
+static const int kReservedPhases = 32;
+
+/*
+ * 进程创建到现在经过的毫秒数，取不到时返回0
+ *  /proc/self/stat第22个字段是进程创建的时间（开机以来的时钟滴答数），和CLOCK_BOOTTIME比较
+ *  第2个字段是括号括起来的进程名，里面可能有空格，从最后一个')'之后开始数
+ */
+static qint64 processAgeMs()
+{
+#ifdef Q_OS_LINUX
+    FILE * file = fopen("/proc/self/stat", "r");
+    if (!file) { return 0; }
+
+    char buffer[1024];
+    size_t size = fread(buffer, 1, sizeof(buffer) - 1, file);
+    fclose(file);
+    buffer[size] = '\0';
+
+    const char * p = strrchr(buffer, ')');
+    if (!p) { return 0; }
+
+    unsigned long long startTicks = 0;
+    int field = 2;
+    while (*p && field < 22)
+    {
+        if (*p == ' ')
+        {
+            field++;
+            if (field == 22) { startTicks = strtoull(p + 1, nullptr, 10); }
+        }
+        p++;
+    }
+
+    const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+    timespec now;
+    if (startTicks == 0 || ticksPerSecond <= 0 || clock_gettime(CLOCK_BOOTTIME, &now) != 0) { return 0; }
+
+    const qint64 nowMs = (qint64)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    const qint64 startMs = (qint64)(startTicks * 1000 / ticksPerSecond);
+    return qMax<qint64>(0, nowMs - startMs);
+#else
+    return 0;
+#endif
+}
+
+StartupProbe::StartupProbe()
+    : m_beforeMain(0)
+    , m_finished(false)
+{
+    m_phases.reserve(kReservedPhases);
+}
+
+StartupProbe & StartupProbe::getInstance()
+{
+    static StartupProbe instance;
+    return instance;
+}
+
+void StartupProbe::start()
+{
+    m_clock.start();
+    m_beforeMain = processAgeMs();
+    mark("main");
+}
+
+qint64 StartupProbe::elapsed() const
+{
+    return m_clock.isValid() ? m_beforeMain + m_clock.elapsed() : 0;
+}
+
+void StartupProbe::mark(const char * phase)
+{
+    Phase record = { phase, elapsed() };
+    m_phases.append(record);
+
+    if (m_finished)
+    {
+        LOG_INFO(General) << "启动阶段：" << phase << record.ms << "毫秒";
+    }
+}
+
+/*
+ * 输出启动报告
+ *  每个阶段一行：完成时间和距上一个阶段的耗时，最后一行是第一帧的时间
+ */
+void StartupProbe::finish()
+{
+    if (m_finished) { return; }
+
+    mark("first frame");
+    m_finished = true;
+
+    qint64 previous = 0;
+    for (const Phase & phase : m_phases)
+    {
+        LOG_INFO(General) << "启动阶段：" << phase.name << phase.ms << "毫秒，耗时" << phase.ms - previous << "毫秒";
+        previous = phase.ms;
+    }
+
+    const qint64 firstFrame = m_phases.last().ms;
+    if (firstFrame > BudgetMs)
+    {
+        LOG_WARNING(General) << "第一帧用了" << firstFrame << "毫秒，超过启动预算" << (int)BudgetMs << "毫秒";
+    }
+}
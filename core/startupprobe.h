@@ -0,0 +1,46 @@
+#ifndef STARTUPPROBE_H
+#define STARTUPPROBE_H
+
+#include <QElapsedTimer>
+#include <QVector>
+
+/*启动计时，记录启动过程中各个阶段完成的时间点
+ *  时间从进程创建算起：Linux上用/proc/self/stat中的进程启动时间补上进入main之前的动态链接和静态初始化，
+ *      其他平台从调用start（main的第一行）算起
+ *  mark记录一个阶段结束的时间，第一帧画出来之后调用finish，把之前的所有阶段和各自的耗时一次写到日志，
+ *      第一帧晚于预算BudgetMs时记一条警告；之后的mark（推迟到第一帧之后的初始化）逐条写到日志
+ *  阶段名是字符串常量，只保存指针，记录时不分配内存
+ *  只在主线程调用
+ */
+class StartupProbe
+{
+public:
+    enum { BudgetMs = 200 };
+
+private:
+    StartupProbe();
+    StartupProbe(const StartupProbe & other);
+
+public:
+    static StartupProbe & getInstance();
+
+    void start();                       //在main的第一行调用
+    void mark(const char * phase);      //记录一个阶段结束
+    void finish();                      //第一帧已经画出来，输出启动报告
+    qint64 elapsed() const;             //距进程创建的毫秒数
+    bool isFinished() const { return m_finished; }
+
+private:
+    struct Phase
+    {
+        const char * name;
+        qint64 ms;
+    };
+
+    QElapsedTimer m_clock;
+    qint64 m_beforeMain;                //进程创建到调用start经过的毫秒数
+    QVector<Phase> m_phases;
+    bool m_finished;
+};
+
+#endif // STARTUPPROBE_H
@@ -0,0 +1,111 @@
+#include "trackprefetcher.h"
+#include "log.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRunnable>
+#include <QThread>
+
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#endif
+
+//记住最近预读过的歌曲数，前后各一首再加上来回切歌留下的几首
+static const int kRecentTracks = 8;
+
+//每次读的块大小
+static const qint64 kChunkBytes = 64 * 1024;
+
+//后台预读一首歌的文件头部
+class ReadAheadTask : public QRunnable
+{
+public:
+    ReadAheadTask(TrackPrefetcher * prefetcher, const QUrl & mp3Url) : m_prefetcher(prefetcher), m_url(mp3Url) {}
+
+    void run() override
+    {
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+
+        // 排队期间同一首歌可能已经被前面的请求读过
+        if (!m_prefetcher->begin(m_url)) { return; }
+
+        QElapsedTimer timer;
+        timer.start();
+        qint64 bytes = TrackPrefetcher::readAhead(m_url.path(), m_prefetcher->m_readAheadBytes);
+        LOG_TRACE(Playback) << "预读：" << m_url.fileName() << bytes << "字节，" << timer.elapsed() << "毫秒";
+    }
+
+private:
+    TrackPrefetcher * m_prefetcher;
+    QUrl m_url;
+};
+
+TrackPrefetcher::TrackPrefetcher(qint64 readAheadBytes, QObject *parent)
+    : QObject(parent)
+    , m_readAheadBytes(readAheadBytes)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+TrackPrefetcher::~TrackPrefetcher()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void TrackPrefetcher::prefetch(const QUrl & mp3Url)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_recent.contains(mp3Url)) { return; }
+    }
+
+    m_pool.start(new ReadAheadTask(this, mp3Url));
+}
+
+void TrackPrefetcher::clearQueue()
+{
+    m_pool.clear();
+}
+
+bool TrackPrefetcher::begin(const QUrl & mp3Url)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_recent.contains(mp3Url)) { return false; }
+
+    m_recent.append(mp3Url);
+    if (m_recent.size() > kRecentTracks)
+    {
+        m_recent.removeFirst();
+    }
+    return true;
+}
+
+/*
+ * 预读文件开头
+ *  读到的数据直接丢弃，目的只是让这些页留在系统的页缓存中
+ *  不用缓冲的方式打开，避免QFile再复制一份
+ */
+qint64 TrackPrefetcher::readAhead(const QString & path, qint64 bytes)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+    {
+        LOG_DEBUG(Playback) << "预读时打不开文件：" << path;
+        return 0;
+    }
+
+#if defined(Q_OS_LINUX)
+    // 先让内核在后台开始读，下面的顺序读可以和内核的预读重叠
+    posix_fadvise(file.handle(), 0, bytes, POSIX_FADV_WILLNEED);
+#endif
+
+    QByteArray buffer(int(kChunkBytes), Qt::Uninitialized);
+    qint64 total = 0;
+    while (total < bytes)
+    {
+        qint64 n = file.read(buffer.data(), qMin(kChunkBytes, bytes - total));
+        if (n <= 0) { break; }
+        total += n;
+    }
+    return total;
+}
@@ -0,0 +1,40 @@
+#ifndef TRACKPREFETCHER_H
+#define TRACKPREFETCHER_H
+
+#include <QObject>
+#include <QList>
+#include <QMutex>
+#include <QThreadPool>
+#include <QUrl>
+
+/*歌曲预读器，切歌之前把前后相邻歌曲的文件头部读进系统的页缓存
+ *  QMediaPlayer打开一首冷文件时要等磁盘或者网络存储，头部已经在页缓存中时打开和开始解码几乎不用等
+ *  Linux下先用posix_fadvise(WILLNEED)让内核异步预读，再顺序读一遍，网络挂载上fadvise不一定生效
+ *  最近预读过的几首歌记在m_recent中，来回切歌时不重复读
+ *  后台只有一个线程，预读请求排队执行，不占用导入、歌词和波形的线程
+ *  连续快速切歌时用clearQueue丢掉还没开始的旧请求，只预读最新的相邻歌曲
+ *  线程安全：prefetch/clearQueue可以在任意线程调用
+ */
+class TrackPrefetcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TrackPrefetcher(qint64 readAheadBytes = 512 * 1024, QObject *parent = nullptr);
+    ~TrackPrefetcher();
+
+    void prefetch(const QUrl & mp3Url);     //异步预读，最近预读过时忽略
+    void clearQueue();                      //丢掉还没开始的预读请求
+
+    static qint64 readAhead(const QString & path, qint64 bytes);   //把文件开头的bytes字节读进页缓存，返回实际读到的字节数
+
+private:
+    friend class ReadAheadTask;
+    bool begin(const QUrl & mp3Url);        //预读线程开始读之前登记，最近已经读过时返回false
+
+    mutable QMutex m_mutex;         //保护m_recent
+    QList<QUrl> m_recent;           //最近预读过的歌曲，最新的在最后
+    qint64 m_readAheadBytes;
+    QThreadPool m_pool;
+};
+
+#endif // TRACKPREFETCHER_H
@@ -0,0 +1,55 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+/*无锁三缓冲，一个线程不停地产生新的一帧，另一个线程随时取最新的一帧
+ *  写者写后缓冲，写完publish和中间缓冲交换；读者update时如果中间缓冲有新的一帧，和前缓冲交换
+ *  两边各自只碰自己手上的缓冲区，交换中间缓冲只用一次原子exchange，谁也不会等谁
+ *  读者跟不上时中间的帧被直接覆盖，读者总是拿到最新的一帧
+ *  T在构造时分配好（比如定长数组），交换的只是下标，不复制也不分配内存
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : m_back(0), m_front(2) { m_middle.store(1, std::memory_order_relaxed); }
+
+    //三个缓冲区都设为value，只在两边开始使用之前调用（publish只在后缓冲和中间缓冲之间轮换，碰不到前缓冲）
+    void fill(const T & value)
+    {
+        for (int i = 0; i < 3; i++) { m_buffers[i] = value; }
+    }
+
+    //写者
+    T & back() { return m_buffers[m_back]; }
+    void publish()
+    {
+        int old = m_middle.exchange(m_back | Fresh, std::memory_order_acq_rel);
+        m_back = old & IndexMask;
+    }
+
+    //读者：有新的一帧时换到前面并返回true
+    bool update()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & Fresh)) { return false; }
+
+        int old = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = old & IndexMask;
+        return true;
+    }
+    const T & front() const { return m_buffers[m_front]; }
+
+private:
+    TripleBuffer(const TripleBuffer & other);
+    TripleBuffer & operator=(const TripleBuffer & other);
+
+    enum { IndexMask = 3, Fresh = 4 };
+
+    T m_buffers[3];
+    std::atomic<int> m_middle;      //中间缓冲的下标，加上是否有新帧的标记
+    int m_back;
+    int m_front;
+};
+
+#endif // TRIPLEBUFFER_H
@@ -0,0 +1,201 @@
+#include "waveform.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOOPY_WAVEFORM_SSE2
+#endif
+
+static const char kMagic[4] = { 'L', 'P', 'W', 'F' };
+static const quint32 kVersion = 1;
+
+Waveform::Waveform()
+    : m_channels(0)
+    , m_bucketFilled(0)
+    , m_bucketMin(0)
+    , m_bucketMax(0)
+{
+    m_levels.resize(1);
+}
+
+const char * Waveform::implementation()
+{
+#ifdef LOOPY_WAVEFORM_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+void Waveform::reduce(const float * samples, int count, float & min, float & max)
+{
+    int i = 0;
+#ifdef LOOPY_WAVEFORM_SSE2
+    if (count >= 4)
+    {
+        __m128 lo = _mm_loadu_ps(samples);
+        __m128 hi = lo;
+        for (i = 4; i + 4 <= count; i += 4)
+        {
+            __m128 v = _mm_loadu_ps(samples + i);
+            lo = _mm_min_ps(lo, v);
+            hi = _mm_max_ps(hi, v);
+        }
+
+        float lanes[4];
+        _mm_storeu_ps(lanes, lo);
+        min = qMin(min, qMin(qMin(lanes[0], lanes[1]), qMin(lanes[2], lanes[3])));
+        _mm_storeu_ps(lanes, hi);
+        max = qMax(max, qMax(qMax(lanes[0], lanes[1]), qMax(lanes[2], lanes[3])));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        min = qMin(min, samples[i]);
+        max = qMax(max, samples[i]);
+    }
+}
+
+static inline qint8 quantize(float value)
+{
+    int q = (int)(value * 127.0f + (value < 0 ? -0.5f : 0.5f));
+    return (qint8)qBound(-127, q, 127);
+}
+
+void Waveform::appendBucket(float min, float max)
+{
+    Peak peak = { quantize(min), quantize(max) };
+    m_levels[0].append(peak);
+}
+
+//按桶边界切开，每个桶的所有声道采样一次归约
+void Waveform::addFrames(const float * samples, int frames, int channels)
+{
+    if (m_channels == 0) { m_channels = qMax(1, channels); }
+
+    while (frames > 0)
+    {
+        int n = qMin(frames, (int)FramesPerBucket - m_bucketFilled);
+        if (m_bucketFilled == 0)
+        {
+            m_bucketMin = samples[0];
+            m_bucketMax = samples[0];
+        }
+        reduce(samples, n * m_channels, m_bucketMin, m_bucketMax);
+
+        samples += n * m_channels;
+        frames -= n;
+        m_bucketFilled += n;
+        if (m_bucketFilled == FramesPerBucket)
+        {
+            appendBucket(m_bucketMin, m_bucketMax);
+            m_bucketFilled = 0;
+        }
+    }
+}
+
+void Waveform::finish()
+{
+    if (m_bucketFilled > 0)
+    {
+        appendBucket(m_bucketMin, m_bucketMax);
+        m_bucketFilled = 0;
+    }
+    buildLevels();
+}
+
+//从第0层开始每次两两合并，奇数个时最后一个单独成桶
+void Waveform::buildLevels()
+{
+    m_levels.resize(1);
+    while (m_levels.last().size() > 1)
+    {
+        const QVector<Peak> & lower = m_levels.last();
+        QVector<Peak> upper((lower.size() + 1) / 2);
+        for (int i = 0; i < upper.size(); i++)
+        {
+            const Peak & a = lower[2 * i];
+            const Peak & b = lower[qMin(2 * i + 1, lower.size() - 1)];
+            upper[i].min = qMin(a.min, b.min);
+            upper[i].max = qMax(a.max, b.max);
+        }
+        m_levels.append(upper);
+    }
+}
+
+int Waveform::bytes() const
+{
+    int bytes = (int)sizeof(Waveform);
+    for (const QVector<Peak> & level : m_levels)
+    {
+        bytes += level.size() * (int)sizeof(Peak) + 24;
+    }
+    return bytes;
+}
+
+/*
+ * 缩放到width个像素
+ *  选桶数不少于width的最粗一层（没有时用第0层），第x个像素覆盖[x * n / width, (x + 1) * n / width)的桶
+ *  桶数少于像素数时相邻的像素取同一个桶
+ */
+void Waveform::render(int width, QVector<Peak> & out) const
+{
+    out.resize(qMax(0, width));
+    if (width <= 0 || isEmpty()) { out.fill(Peak{ 0, 0 }); return; }
+
+    int index = 0;
+    while (index + 1 < m_levels.size() && m_levels[index + 1].size() >= width)
+    {
+        index++;
+    }
+    const QVector<Peak> & level = m_levels[index];
+    const qint64 n = level.size();
+
+    for (int x = 0; x < width; x++)
+    {
+        int begin = (int)(x * n / width);
+        int end = qMax(begin + 1, (int)((x + 1) * n / width));
+
+        Peak peak = level[begin];
+        for (int i = begin + 1; i < end; i++)
+        {
+            peak.min = qMin(peak.min, level[i].min);
+            peak.max = qMax(peak.max, level[i].max);
+        }
+        out[x] = peak;
+    }
+}
+
+//魔数、版本号、桶大小、桶数，然后是第0层的<最小值, 最大值>
+QByteArray Waveform::save() const
+{
+    const QVector<Peak> & base = m_levels[0];
+    const quint32 header[3] = { kVersion, (quint32)FramesPerBucket, (quint32)base.size() };
+
+    QByteArray data;
+    data.reserve((int)(sizeof(kMagic) + sizeof(header)) + base.size() * (int)sizeof(Peak));
+    data.append(kMagic, sizeof(kMagic));
+    data.append(reinterpret_cast<const char *>(header), sizeof(header));
+    data.append(reinterpret_cast<const char *>(base.constData()), base.size() * (int)sizeof(Peak));
+    return data;
+}
+
+bool Waveform::load(const QByteArray & data)
+{
+    quint32 header[3];
+    const int headerSize = (int)(sizeof(kMagic) + sizeof(header));
+    if (data.size() < headerSize || memcmp(data.constData(), kMagic, sizeof(kMagic)) != 0) { return false; }
+
+    memcpy(header, data.constData() + sizeof(kMagic), sizeof(header));
+    if (header[0] != kVersion || header[1] != (quint32)FramesPerBucket
+            || (qint64)header[2] * (qint64)sizeof(Peak) != data.size() - headerSize)
+    {
+        return false;
+    }
+
+    m_levels.resize(1);
+    m_levels[0].resize((int)header[2]);
+    memcpy(m_levels[0].data(), data.constData() + headerSize, header[2] * sizeof(Peak));
+    buildLevels();
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QSharedPointer>
+#include <QVector>
+
+/*波形概览，进度条下方显示的整首歌的振幅轮廓
+ *  第0层：每FramesPerBucket帧一个桶，记录桶内所有声道采样的最小值和最大值（量化到-127~127）
+ *      求最小/最大值用SIMD归约，交错存储的多声道采样不用拆开，整个桶一起归约
+ *  金字塔（mipmap）：第k+1层的每个桶合并第k层相邻的两个桶，一直到只剩一个桶
+ *  绘制时选桶数不少于像素宽度的最粗一层，每个像素最多合并两三个桶，任意宽度都是O(宽度)
+ *  只保存第0层（约每秒43个桶），读入后重新生成上面各层
+ */
+class Waveform
+{
+public:
+    enum { FramesPerBucket = 1024 };
+
+    struct Peak
+    {
+        qint8 min;
+        qint8 max;
+    };
+
+    Waveform();
+
+    //送入一段交错存储的float采样，frames为帧数；声道数在第一次调用后不能再变
+    void addFrames(const float * samples, int frames, int channels);
+    void finish();          //最后不满一个桶的采样也记一个桶，并生成金字塔
+
+    bool isEmpty() const { return m_levels.isEmpty() || m_levels[0].isEmpty(); }
+    int levelCount() const { return m_levels.size(); }
+    const QVector<Peak> & level(int index) const { return m_levels[index]; }
+    int bytes() const;      //占用的字节数，用作缓存开销
+
+    //把整首歌的波形缩放到width个像素，每个像素一个<最小值, 最大值>
+    void render(int width, QVector<Peak> & out) const;
+
+    QByteArray save() const;                    //第0层的二进制数据
+    bool load(const QByteArray & data);         //从save的结果恢复，格式不对返回false
+
+    //归约count个float的最小值和最大值，SSE2可用时每次处理4个
+    static void reduce(const float * samples, int count, float & min, float & max);
+    static const char * implementation();
+
+private:
+    void appendBucket(float min, float max);
+    void buildLevels();
+
+private:
+    QVector<QVector<Peak>> m_levels;    //m_levels[0]为第0层
+    int m_channels;
+    int m_bucketFilled;                 //当前桶已有的帧数
+    float m_bucketMin;
+    float m_bucketMax;
+};
+
+typedef QSharedPointer<const Waveform> WaveformPtr;
+Q_DECLARE_METATYPE(WaveformPtr)
+
+#endif // WAVEFORM_H
@@ -0,0 +1,775 @@
+#include "worker.h"
+#include <QDebug>
+#include "log.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDirIterator>
+#include <climits>
+#include "lrcparser.h"
+#include "id3reader.h"
+#include "contenthash.h"
+#include "seekindex.h"
+#include "libraryindex.h"
+
+//同时打开的文件数默认上限
+static const int kDefaultMaxOpenFiles = 64;
+//批量投递的默认批大小和最大延迟（毫秒）
+static const int kDefaultBatchSize = 256;
+static const int kDefaultBatchLatencyMs = 50;
+//文件夹扫描时每遍历到这么多个需要解析的文件就提交一次
+static const int kScanChunkSize = 64;
+//发件箱积压到这么多条消息时，提交结果的解析线程等待投递的线程腾出空间
+static const int kOutboxLimit = 64;
+
+Worker::Worker(QObject *parent)
+    : QObject(parent)
+    , m_openFiles(kDefaultMaxOpenFiles)
+    , m_maxOpenFiles(kDefaultMaxOpenFiles)
+    , m_hashContent(false)
+    , m_nextSeq(0)
+    , m_emitSeq(0)
+    , m_delivering(false)
+    , m_batchSize(kDefaultBatchSize)
+    , m_batchLatencyMs(kDefaultBatchLatencyMs)
+    , m_done(0)
+    , m_total(0)
+    , m_scans(0)
+{
+    m_lastFlush.start();
+
+    m_flushTimer = new QTimer(this);
+    connect(m_flushTimer, &QTimer::timeout, this, &Worker::handle_flushTimer_timeout);
+}
+
+Worker::~Worker()
+{
+    //先停掉解析线程，再释放还没来得及投递的歌曲
+    m_pool.shutdown();
+    for (const PendingResult & result : m_pending)
+    {
+        delete result.song;
+    }
+    m_pending.clear();
+    qDeleteAll(m_batch);
+    m_batch.clear();
+    for (const Message & message : m_outbox)
+    {
+        qDeleteAll(message.songs());
+    }
+    m_outbox.clear();
+}
+
+//设置批量投递的批大小和最大延迟，批大小为1时每解析完一首就投递一次
+void Worker::setDelivery(int batchSize, int batchLatencyMs)
+{
+    QMutexLocker locker(&m_orderMutex);
+    m_batchSize = qMax(1, batchSize);
+    m_batchLatencyMs = qMax(0, batchLatencyMs);
+}
+
+//设置导入时是否计算音频内容哈希，对之后开始解析的歌曲生效
+void Worker::setContentHashing(bool enabled)
+{
+    m_hashContent.store(enabled);
+    if (enabled)
+    {
+        LOG_INFO(Import) << "导入时计算音频内容哈希，实现：" << ContentHash::implementation();
+    }
+}
+
+//设置同时打开的文件数上限，应在没有导入任务时调用
+void Worker::setMaxOpenFiles(int count)
+{
+    if (count < 1) { count = 1; }
+
+    if (count > m_maxOpenFiles)
+    {
+        m_openFiles.release(count - m_maxOpenFiles);
+    }
+    else if (count < m_maxOpenFiles)
+    {
+        m_openFiles.acquire(m_maxOpenFiles - count);
+    }
+    m_maxOpenFiles = count;
+}
+
+//消息队列的容量（消息条数），每条Result消息最多携带一批歌曲
+static const int kMessageQueueCapacity = 1024;
+
+MessageQueue::MessageQueue()
+    : m_queue(kMessageQueueCapacity)
+    , m_policy(Block)
+    , m_signalled(false)
+    , m_popWaiters(0)
+    , m_pushWaiters(0)
+{
+
+}
+
+//析构时释放队列中还没被取走的消息持有的歌曲对象
+MessageQueue::~MessageQueue()
+{
+    Message message;
+    while (m_queue.try_pop(message))
+    {
+        qDeleteAll(message.songs());
+    }
+}
+
+MessageQueue & MessageQueue::getInstance()
+{
+    static MessageQueue instance;
+    return instance;
+}
+
+/*
+ * 唤醒等待的消费者/生产者
+ *  只有存在等待者时才加锁，没有等待者时只是一次原子读
+ *  等待者先增加计数再重试一次无锁操作，然后持有m_waitMutex进入wait，
+ *  这里加锁后再唤醒，保证唤醒不会发生在对方检查和睡眠之间而丢失
+ *  两边都是先写后读（这里先入队/出队再读计数，等待者先加计数再重试），中间各有一道全序栅栏，
+ *      否则写可能还在存储缓冲区里，双方都读到旧值：这里以为没有等待者，等待者以为还是满/空，唤醒就丢了
+ */
+void MessageQueue::wakePoppers()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_popWaiters.load() > 0)
+    {
+        QMutexLocker locker(&m_waitMutex);
+        m_notEmpty.wakeAll();
+    }
+}
+
+void MessageQueue::wakePushers()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_pushWaiters.load() > 0)
+    {
+        QMutexLocker locker(&m_waitMutex);
+        m_notFull.wakeAll();
+    }
+}
+
+//非阻塞入队接口，队列满返回false
+bool MessageQueue::try_push(const Message & message)
+{
+    if (!m_queue.try_push(message)) { return false; }
+
+    wakePoppers();
+    return true;
+}
+
+//非阻塞出队接口，队列空返回false
+bool MessageQueue::try_pop(Message & message)
+{
+    if (!m_queue.try_pop(message)) { return false; }
+
+    wakePushers();
+    return true;
+}
+
+/*
+ * 按背压策略入队
+ *  先走无锁快速路径，队列满时：
+ *      Reject策略直接返回false
+ *      Block策略在m_notFull上睡眠，被唤醒（消费者取走了消息，或者策略被改为Reject）后重试
+ */
+bool MessageQueue::push(const Message & message)
+{
+    if (try_push(message)) { return true; }
+
+    QMutexLocker locker(&m_waitMutex);
+    m_pushWaiters.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool ok = false;
+    forever
+    {
+        if (m_queue.try_push(message)) { ok = true; break; }
+        if (overflowPolicy() == Reject) { break; }
+        m_notFull.wait(&m_waitMutex);
+    }
+    m_pushWaiters.fetch_sub(1);
+    locker.unlock();
+
+    if (ok) { wakePoppers(); }
+    return ok;
+}
+
+//阻塞出队，最多等待timeoutMs毫秒，超时返回false
+bool MessageQueue::pop(Message & message, int timeoutMs)
+{
+    if (try_pop(message)) { return true; }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QMutexLocker locker(&m_waitMutex);
+    m_popWaiters.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool ok = false;
+    forever
+    {
+        if (m_queue.try_pop(message)) { ok = true; break; }
+
+        qint64 remaining = timeoutMs - timer.elapsed();
+        if (remaining <= 0) { break; }
+        m_notEmpty.wait(&m_waitMutex, (unsigned long)remaining);
+    }
+    m_popWaiters.fetch_sub(1);
+    locker.unlock();
+
+    if (ok) { wakePushers(); }
+    return ok;
+}
+
+//一次最多取出n条消息追加到messages，返回取出的数量
+int MessageQueue::pop_bulk(QList<Message> & messages, int n)
+{
+    int count = 0;
+    Message message;
+    while (count < n && m_queue.try_pop(message))
+    {
+        messages.append(message);
+        count++;
+    }
+
+    if (count > 0) { wakePushers(); }
+    return count;
+}
+
+/*
+ * 取出所有消息接口
+ *  先清除已通知标记再取，之后入队的消息会重新通知，不会遗漏
+ *  清除标记用exchange，和生产者armNotify的exchange同步，保证取的时候能看到生产者通知前入队的消息
+ */
+QList<Message> MessageQueue::popAll()
+{
+    m_signalled.exchange(false);
+
+    QList<Message> messages;
+    pop_bulk(messages, INT_MAX);
+    return messages;
+}
+
+//入队后调用，如果消费者已经被通知过、还没来取，就不用再通知，返回false
+bool MessageQueue::armNotify()
+{
+    return !m_signalled.exchange(true);
+}
+
+//设置背压策略，唤醒阻塞的生产者重新检查（改为Reject时让它们返回）
+void MessageQueue::setOverflowPolicy(OverflowPolicy policy)
+{
+    m_policy.store(policy);
+
+    QMutexLocker locker(&m_waitMutex);
+    m_notFull.wakeAll();
+}
+
+//判断是否为空，并发修改时只是近似值
+bool MessageQueue::empty()
+{
+    return m_queue.size_approx() == 0;
+}
+
+//获取大小，并发修改时只是近似值
+int MessageQueue::size()
+{
+    return (int)m_queue.size_approx();
+}
+
+//解析单首歌曲，在Worker线程中直接解析，同样占用一个序号，保证和批量请求之间的顺序
+void Worker::getASong(const QUrl &mp3Url)
+{
+    quint64 seq = 0;
+    {
+        QMutexLocker locker(&m_orderMutex);
+        seq = m_nextSeq++;
+        m_total++;
+    }
+    complete(seq, mp3Url, parseSong(mp3Url));
+}
+
+/*
+ * 批量解析歌曲
+ *  每个文件分配一个递增的序号，然后打包成任务提交给解析线程池
+ *  各个解析线程完成后调用complete，由complete按序号顺序入队
+ */
+void Worker::getSongs(const QList<QUrl> &mp3Urls)
+{
+    QVector<ImportPool::Task> tasks;
+    tasks.reserve(mp3Urls.size());
+
+    QMutexLocker locker(&m_orderMutex);
+    for (const QUrl & url : mp3Urls)
+    {
+        quint64 seq = m_nextSeq++;
+        tasks.append([this, url, seq]() {
+            complete(seq, url, parseSong(url));
+        });
+    }
+    m_total += mp3Urls.size();
+    locker.unlock();
+
+    m_pool.submit(tasks);
+    startFlushTimer();
+}
+
+/*
+ * 从歌曲库索引恢复上次的歌曲
+ *  每首歌按索引中的顺序分配序号，和普通导入共用重排和批量投递，歌曲列表顺序和上次一致
+ *  文件戳（媒体文件的修改时间和大小、歌词文件的修改时间）没变的歌曲直接用索引中的数据构造
+ *      打开了内容哈希而索引中还没有哈希的歌曲也重新解析
+ *      跳转索引不能再用的歌曲（版本6的Xing）其他字段照用，在解析线程池中只重新建立跳转索引
+ *  变化了的歌曲交给解析线程池重新解析，已经不存在的歌曲丢弃（投递一条Error消息）
+ *  不能直接打开的旧版本索引取出其中的歌曲路径，按原来的顺序全部重新解析，索引文件留着，解析完成后由主线程按新版本覆盖
+ *  索引文件存在但是读不了（损坏、不认识的格式）时改名为.bak保留下来，
+ *      主线程之后保存歌曲库时不会用空的（或者只有新导入歌曲的）歌曲库覆盖掉它
+ *  没有索引、索引是空的或者读不了时没有歌曲要恢复，也投递一条本轮结束的进度，主线程据此结束恢复状态
+ */
+void Worker::restoreLibrary(const QString & indexPath)
+{
+    LibraryIndex index;
+    if (!index.open(indexPath))
+    {
+        if (!QFile::exists(indexPath))
+        {
+            LOG_INFO(Import) << "没有歌曲库索引：" << indexPath;
+            finishIdle();
+            return;
+        }
+
+        QStringList legacyUrls;
+        if (LibraryIndex::readLegacyUrls(indexPath, legacyUrls))
+        {
+            LOG_INFO(Import) << "歌曲库索引是旧版本，重新解析上次的歌曲：" << legacyUrls.size() << "首";
+            QList<QUrl> urls;
+            urls.reserve(legacyUrls.size());
+            for (const QString & url : legacyUrls)
+            {
+                urls.append(QUrl(url));
+            }
+            if (urls.isEmpty())
+            {
+                finishIdle();
+            }
+            else
+            {
+                getSongs(urls);
+            }
+            return;
+        }
+
+        const QString backup = indexPath + ".bak";
+        QFile::remove(backup);
+        if (QFile::rename(indexPath, backup))
+        {
+            LOG_WARNING(Import) << "歌曲库索引无法读取，已保留为：" << backup;
+        }
+        else
+        {
+            LOG_WARNING(Import) << "歌曲库索引无法读取，也无法改名保留：" << indexPath;
+        }
+        finishIdle();
+        return;
+    }
+
+    const int count = index.size();
+    if (count == 0)
+    {
+        finishIdle();
+        return;
+    }
+    quint64 firstSeq = 0;
+    {
+        QMutexLocker locker(&m_orderMutex);
+        firstSeq = m_nextSeq;
+        m_nextSeq += count;
+        m_total += count;
+    }
+
+    QVector<ImportPool::Task> tasks;
+    const bool needHash = m_hashContent.load();
+    int reused = 0;
+    int reindexed = 0;
+    for (int i = 0; i < count; i++)
+    {
+        quint64 seq = firstSeq + i;
+        QUrl url(index.url(i));
+
+        QFileInfo info(url.path());
+        if (!info.isFile())
+        {
+            complete(seq, url, nullptr);
+            continue;
+        }
+
+        QFileInfo lrcInfo(url.path().replace(".mp3", ".lrc"));
+        qint64 lyricTime = lrcInfo.isFile() ? lrcInfo.lastModified().toMSecsSinceEpoch() : 0;
+
+        if (info.lastModified().toMSecsSinceEpoch() == index.fileTime(i)
+                && info.size() == index.fileSize(i)
+                && lyricTime == index.lyricTime(i)
+                && (!needHash || index.contentHash(i) != 0))
+        {
+            Song * song = index.song(i);
+            if (index.seekIndexStale(i))
+            {
+                // 旧版本索引中不能再用的跳转索引：其他字段照用，只重新建立跳转索引（只读第一帧）
+                tasks.append([this, url, seq, song]() {
+                    m_openFiles.acquire();
+                    song->seekIndex(SeekIndex::buildFile(url.path()));
+                    m_openFiles.release();
+                    complete(seq, url, song);
+                });
+                reindexed++;
+                continue;
+            }
+            complete(seq, url, song);
+            reused++;
+            continue;
+        }
+
+        tasks.append([this, url, seq]() {
+            complete(seq, url, parseSong(url));
+        });
+    }
+
+    LOG_INFO(Import) << "从歌曲库索引恢复歌曲：" << reused << "首，重新建立跳转索引：" << reindexed << "首，重新解析："
+                     << tasks.size() - reindexed << "首";
+    m_pool.submit(tasks);
+    startFlushTimer();
+}
+
+/*
+ * 扫描文件夹
+ *  用QDirIterator逐个遍历，不先列出整个目录树；需要解析的文件每攒够kScanChunkSize个就提交给解析线程池，
+ *  遍历慢的网络目录上，前面的文件在遍历后面目录的同时已经开始解析
+ *  已知文件的文件戳没变就跳过，变了重新解析（主线程收到后就地更新）
+ *  遍历结束后known中没有遇到的文件就是已经删除的歌曲
+ */
+void Worker::scanFolder(const QString & dir, const FileStamps & known, bool recursive)
+{
+    {
+        QMutexLocker locker(&m_orderMutex);
+        m_scans++;
+    }
+
+    FileStamps missing = known;
+    QList<QUrl> chunk;
+    int found = 0;
+    int parsed = 0;
+
+    QDirIterator it(dir, QStringList() << "*.mp3", QDir::Files,
+                    recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext())
+    {
+        const QString path = it.next();
+        found++;
+
+        auto stamp = missing.find(path);
+        if (stamp != missing.end())
+        {
+            bool unchanged = stamp.value() == FileStamp::of(it.fileInfo());
+            missing.erase(stamp);
+            if (unchanged) { continue; }
+        }
+
+        chunk.append(QUrl(path));
+        parsed++;
+        if (chunk.size() >= kScanChunkSize)
+        {
+            getSongs(chunk);
+            chunk.clear();
+        }
+    }
+
+    if (!chunk.isEmpty())
+    {
+        getSongs(chunk);
+    }
+
+    LOG_INFO(Import) << "扫描文件夹：" << dir << "，共" << found << "首，解析：" << parsed
+                     << "首，删除：" << missing.size() << "首";
+
+    //遍历结束，如果解析已经全部完成，由这里投递本轮的最终进度
+    QMutexLocker locker(&m_orderMutex);
+    if (!missing.isEmpty())
+    {
+        m_outbox.append(Message::removed(missing.keys()));
+    }
+    m_scans--;
+    if (m_emitSeq == m_nextSeq)
+    {
+        flush();
+    }
+    deliver(locker);
+}
+
+/*
+ * 按序号提交解析结果（重排缓冲区）
+ *  如果正好是下一个应该投递的序号，就放入当前批次，并继续检查后面已经完成的结果能否连续放入
+ *  否则先暂存到m_pending，等前面的结果完成后再一起放入
+ *  解析失败的结果为nullptr，同样占用序号，投递一条Error消息
+ *  批次攒够、等待超时、或者所有请求都已完成时投递
+ */
+void Worker::complete(quint64 seq, const QUrl & url, Song * song)
+{
+    QMutexLocker locker(&m_orderMutex);
+
+    if (seq != m_emitSeq)
+    {
+        PendingResult result = { url, song };
+        m_pending.insert(seq, result);
+        return;
+    }
+
+    PendingResult result = { url, song };
+    forever
+    {
+        m_emitSeq++;
+        m_done++;
+        if (result.song)
+        {
+            m_batch.append(result.song);
+        }
+        else
+        {
+            m_outbox.append(Message::error(result.url.path()));
+        }
+
+        auto it = m_pending.find(m_emitSeq);
+        if (it == m_pending.end()) { break; }
+
+        result = it.value();
+        m_pending.erase(it);
+    }
+
+    if (m_batch.size() >= m_batchSize
+            || m_emitSeq == m_nextSeq
+            || m_lastFlush.elapsed() >= m_batchLatencyMs)
+    {
+        flush();
+    }
+    deliver(locker);
+}
+
+//把攒好的一批歌曲作为一条Result消息放进发件箱，同时附上本轮进度，调用时已持有m_orderMutex
+void Worker::flush()
+{
+    if (!m_batch.isEmpty())
+    {
+        m_outbox.append(Message::result(m_batch));
+        m_batch.clear();
+    }
+    m_outbox.append(Message::progress(m_done, m_total, m_scans > 0));
+    m_lastFlush.restart();
+
+    //本轮请求全部完成（也没有还在遍历的文件夹），进度清零
+    if (m_emitSeq == m_nextSeq && m_scans == 0)
+    {
+        m_done = 0;
+        m_total = 0;
+    }
+}
+
+//没有正在解析的歌曲时投递一次进度，本轮导入随之结束；还有歌曲在解析时由它们完成时投递
+void Worker::finishIdle()
+{
+    QMutexLocker locker(&m_orderMutex);
+    if (m_emitSeq == m_nextSeq && m_scans == 0)
+    {
+        flush();
+        deliver(locker);
+    }
+}
+
+/*
+ * 启动投递定时器，间隔为最大延迟，已经在运行时不重新计时
+ *  定时器属于Worker所在的线程，只能在这个线程里启动和停止，由getSongs等槽函数调用
+ */
+void Worker::startFlushTimer()
+{
+    if (m_flushTimer->isActive()) { return; }
+
+    int interval = 0;
+    {
+        QMutexLocker locker(&m_orderMutex);
+        interval = qMax(1, m_batchLatencyMs);
+    }
+    m_flushTimer->start(interval);
+}
+
+/*
+ * 投递定时器
+ *  解析线程只在完成一首歌时检查延迟，后面的歌曲迟迟没有完成时，由这里把超时的一批投递出去
+ *  本轮导入全部完成（也没有还在遍历的文件夹）后停止定时器
+ */
+void Worker::handle_flushTimer_timeout()
+{
+    QMutexLocker locker(&m_orderMutex);
+    if (!m_batch.isEmpty() && m_lastFlush.elapsed() >= m_batchLatencyMs)
+    {
+        flush();
+        deliver(locker);
+    }
+
+    if (m_emitSeq == m_nextSeq && m_scans == 0)
+    {
+        m_flushTimer->stop();
+    }
+}
+
+/*
+ * 把发件箱中的消息按顺序入队，调用时已持有m_orderMutex，返回时仍然持有
+ *  没有别的线程在投递时由当前线程负责：每次取走发件箱中的全部消息，放开锁逐条入队，
+ *      再加锁检查期间有没有新放进来的，直到发件箱为空
+ *  已经有线程在投递时直接返回，留给它一起入队；发件箱积压超过kOutboxLimit条时先等它腾出空间，
+ *      投递的线程阻塞在满队列上时，其他解析线程也随之降速
+ */
+void Worker::deliver(QMutexLocker & locker)
+{
+    if (m_delivering)
+    {
+        while (m_delivering && m_outbox.size() >= kOutboxLimit)
+        {
+            m_outboxDrained.wait(&m_orderMutex);
+        }
+        return;
+    }
+
+    m_delivering = true;
+    while (!m_outbox.isEmpty())
+    {
+        QList<Message> messages;
+        messages.swap(m_outbox);
+
+        locker.unlock();
+        for (const Message & message : messages)
+        {
+            post(message);
+        }
+        locker.relock();
+
+        m_outboxDrained.wakeAll();
+    }
+    m_delivering = false;
+}
+
+/*
+ * 入队一条消息
+ *  默认背压策略下队列满时会阻塞在这里，解析线程随之降速，直到主线程取走消息
+ *  被拒绝（Reject策略，比如程序退出时）的消息由这里释放
+ */
+void Worker::post(const Message & message)
+{
+    MessageQueue & queue = MessageQueue::getInstance();
+    if (!queue.push(message))
+    {
+        LOG_WARNING(Queue) << "消息队列已满，丢弃消息，类型：" << message.type();
+        qDeleteAll(message.songs());
+        return;
+    }
+
+    if (queue.armNotify())
+    {
+        emit messagesReady();
+    }
+}
+
+/*
+ * 解析一首歌曲，返回动态分配的歌曲对象，文件不可用时返回nullptr
+ *  在解析线程池的多个线程中并发调用，只访问局部数据，不访问Worker的成员（信号量除外）
+ */
+Song * Worker::parseSong(const QUrl &mp3Url)
+{
+    // 解析歌词
+    LOG_TRACE(Import) << "读取歌曲文件: " << mp3Url;
+
+    QFileInfo info(mp3Url.path());
+
+    if (!info.isFile())
+    {
+        LOG_WARNING(Import) << "不可用的mp3文件路径：" << mp3Url;
+        return nullptr;
+    }
+
+    // 读取ID3标签，只读标签区域，不读音频数据；没有歌名标签时用文件名
+    m_openFiles.acquire();  //限制同时打开的文件数
+    Id3Reader::Result tags;
+    if (!Id3Reader::readFile(info.filePath(), tags))
+    {
+        LOG_WARNING(Import) << "读取标签失败：" << mp3Url;
+    }
+    // 计算音频内容哈希，跳过标签，只映射音频数据
+    quint64 hash = 0;
+    if (m_hashContent.load() && !ContentHash::hashFile(info.filePath(), hash))
+    {
+        LOG_WARNING(Import) << "计算内容哈希失败：" << mp3Url;
+    }
+    // 建立跳转索引，有信息头的文件只读第一帧；不保留偏移表，第一次跳转时再建立
+    SeekIndex seekIndex = SeekIndex::buildFile(info.filePath());
+    m_openFiles.release();
+    LOG_TRACE(Import) << "跳转索引：" << SeekIndex::sourceName(seekIndex.source()) << seekIndex.duration() << "毫秒";
+
+    LOG_TRACE(Import) << "构造一个歌曲对象";
+    Song * song = new Song(mp3Url, tags.title.isEmpty() ? info.baseName() : tags.title, tags.artist, tags.album);
+    song->fileTime(info.lastModified().toMSecsSinceEpoch());
+    song->fileSize(info.size());
+    song->contentHash(hash);
+    song->seekIndex(seekIndex);
+
+    LOG_TRACE(Import) << "将路径后缀.mp3替换为.lrc, 然后判断是否存在歌词文件";
+    QString lrcFile = mp3Url.path().replace(".mp3", ".lrc");
+
+    // 歌词文件不存在，直接把歌曲对象放入消息队列，然后通知主线程ui（歌曲列表和歌词列表）里面可以显示
+    QFileInfo lrcInfo(lrcFile);
+    bool ret = lrcInfo.isFile();
+    if (!ret)
+    {
+        LOG_TRACE(Import) << "歌词文件不存在: " << lrcFile;
+        return song;
+    }
+    song->lyricTime(lrcInfo.lastModified().toMSecsSinceEpoch());
+
+    // 歌词文件存在，只解析歌手、专辑和歌词行数，歌词文本在播放时按需加载
+    m_openFiles.acquire();
+    LrcParser::Result lrc;
+    ret = LrcParser::parseFile(lrcFile, lrc, LrcParser::MetadataOnly);
+    m_openFiles.release();
+
+    // 歌词文件存在但是没有权限打开该文件
+    if (!ret)
+    {
+        LOG_WARNING(Lyrics) << "打开文件失败: " << lrcFile;
+        return song;
+    }
+
+    //以ID3标签为准，歌词文件中的[ar:] [al:]只补充标签里没有的字段；[ti:]标签只解析不覆盖
+    if (song->artist().isEmpty()) { song->artist(lrc.artist); }
+    if (song->album().isEmpty()) { song->album(lrc.album); }
+    song->lyricCount(lrc.lineCount);
+
+    return song;
+}
+
+
+/*
+ * 解析歌词函数，参数接收歌曲路径，
+ *      根据歌曲url读取歌词文件，
+ *      返回解析出的歌词时间轴
+ *  具体的解析规则见LrcParser，形如: [00:28.28]一生要走多远的路程
+ *  导入时只解析歌曲信息，歌词文本由歌词缓存在需要时调用这里加载，可在任意线程调用
+ */
+LyricTimeline Worker::readLyrics(const QUrl & mp3Url)
+{
+    QString lrcFile = mp3Url.path().replace(".mp3", ".lrc");
+
+    LrcParser::Result lrc;
+    if (!LrcParser::parseFile(lrcFile, lrc))
+    {
+        LOG_WARNING(Lyrics) << "歌词文件打开失败: " << lrcFile;
+    }
+
+    return lrc.lyrics;
+}
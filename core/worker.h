@@ -0,0 +1,229 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include <QSemaphore>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QWaitCondition>
+#include <QTimer>
+#include <atomic>
+#include "song.h"
+#include "importpool.h"
+#include "mpmcqueue.h"
+
+/*消息类，工作线程和主线程之间通过消息队列传递的数据
+ *  封装消息类型和具体的消息体
+ *      Result      一批按添加顺序排列的歌曲对象指针，所有权随消息转移给取走消息的一方
+ *      Progress    本轮导入的进度，done已完成数量 / total总数，scanning表示还有文件夹在遍历，总数还会增加
+ *      Error       解析失败的文件路径或原因text
+ *      Removed     文件夹扫描时发现已经删除的歌曲路径paths
+ */
+class Message
+{
+public:
+    enum Type { Result, Progress, Error, Removed };
+
+    Message() : m_type(Result), m_done(0), m_total(0), m_scanning(false) {}
+
+    static Message result(const QVector<Song*> & songs)
+    {
+        Message message;
+        message.m_type = Result;
+        message.m_songs = songs;
+        return message;
+    }
+
+    static Message progress(int done, int total, bool scanning = false)
+    {
+        Message message;
+        message.m_type = Progress;
+        message.m_done = done;
+        message.m_total = total;
+        message.m_scanning = scanning;
+        return message;
+    }
+
+    static Message error(const QString & text)
+    {
+        Message message;
+        message.m_type = Error;
+        message.m_text = text;
+        return message;
+    }
+
+    static Message removed(const QStringList & paths)
+    {
+        Message message;
+        message.m_type = Removed;
+        message.m_paths = paths;
+        return message;
+    }
+
+    Type type() const { return m_type; }
+    const QVector<Song*> & songs() const { return m_songs; }
+    const QString & text() const { return m_text; }
+    const QStringList & paths() const { return m_paths; }
+    int done() const { return m_done; }
+    int total() const { return m_total; }
+    bool scanning() const { return m_scanning; }
+
+private:
+    Type m_type;
+    QVector<Song*> m_songs;
+    QString m_text;
+    QStringList m_paths;
+    int m_done;
+    int m_total;
+    bool m_scanning;
+};
+
+
+/*工作类，负责歌曲解析
+ *  自身运行在一个单独的QThread中，作为调度者接收主线程的添加歌曲请求
+ *  具体的解析工作分发到解析线程池ImportPool中并发执行
+ *  解析结果按请求的先后顺序（序号）依次存入消息队列，保证歌曲列表顺序稳定，和添加顺序一致
+ *  同时打开的文件数量由信号量m_openFiles限制，避免大批量导入时耗尽文件句柄（尤其是NAS挂载目录）
+ *  投递：持有m_orderMutex时只把消息按顺序放进发件箱m_outbox，由一个线程放开锁之后再入队，
+ *      入队在队列满时会阻塞，不能拿着锁阻塞，否则其他解析线程连提交结果都进不来
+ *      同一时间只有一个线程在投递，保证消息按发件箱的顺序入队；发件箱积压太多时其他解析线程等待，背压照常生效
+ *  批量投递：按顺序完成的歌曲先攒成一批，攒够m_batchSize首或距上次投递超过m_batchLatencyMs毫秒，
+ *      或者当前没有正在解析的歌曲时，作为一条Result消息入队，并附带一条Progress消息
+ *      导入进行中由定时器m_flushTimer定期检查，后面的歌曲解析得慢（或者卡在某个文件上）时，
+ *      已经攒好的一批不会等到下一首完成才投递
+ *      消息队列由空变为非空时才发出一次messagesReady信号，主线程一次取走所有消息
+ *      批量大小设为1即退化为逐首投递
+ *  文件夹扫描：边遍历目录边按块提交解析任务，解析和目录遍历同时进行，不用等整个目录树列完
+ *      和已知的文件戳比较，只解析新增和变化了的文件，遍历结束后剩下的已知文件作为一条Removed消息投递
+ *      扫描进行中时即使已经解析完也不算本轮完成，进度消息带上scanning标记
+ *  内容哈希（可选，默认关闭）：解析时顺便计算音频数据的哈希（见ContentHash），由主线程据此识别重复的歌曲
+ *  跳转索引：解析时为每个文件建立（见SeekIndex），只有参数和Xing的目录，和歌曲信息一起保存
+ */
+class Worker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Worker(QObject *parent = nullptr);
+    ~Worker();
+
+signals:
+    void messagesReady();       //消息队列中有新消息的信号（合并通知，一次通知可能对应多条消息）
+
+public:
+    static LyricTimeline readLyrics(const QUrl & mp3Url);  //加载一首歌的全部歌词
+    Song * parseSong(const QUrl & mp3Url);  //解析一首歌曲，线程安全，在解析线程池中并发调用
+    void setMaxOpenFiles(int count);        //设置同时打开的文件数上限
+    void setDelivery(int batchSize, int batchLatencyMs);  //设置批量投递的批大小和最大延迟
+    void setContentHashing(bool enabled);   //设置导入时是否计算音频内容哈希
+
+public slots:
+    void getASong(const QUrl & mp3Url);         //解析歌曲，参数接收歌曲路径
+    void getSongs(const QList<QUrl> & mp3Urls); //批量解析歌曲，分发到解析线程池
+    void restoreLibrary(const QString & indexPath); //从歌曲库索引恢复歌曲，只重新解析变化了的文件
+    //扫描文件夹，known为该文件夹下已有歌曲的文件戳，只解析新增和变化了的文件，recursive为true时包括子目录
+    void scanFolder(const QString & dir, const FileStamps & known, bool recursive);
+
+private slots:
+    void handle_flushTimer_timeout();           //定时检查，攒着的一批超过最大延迟就投递
+
+private:
+    //提交序号为seq的解析结果（解析失败为nullptr），按序号顺序攒批
+    void complete(quint64 seq, const QUrl & url, Song * song);
+    void flush();                               //把攒好的一批结果和进度放进发件箱，调用时已持有m_orderMutex
+    void deliver(QMutexLocker & locker);        //把发件箱中的消息入队，调用时已持有m_orderMutex，入队期间放开
+    void post(const Message & message);         //入队一条消息，需要时发出通知信号，调用时不能持有m_orderMutex
+    void startFlushTimer();                     //开始一轮导入时启动投递定时器，在Worker所在线程调用
+    void finishIdle();                          //没有正在解析的歌曲时投递本轮的最终进度
+
+private:
+    ImportPool m_pool;              //解析线程池
+    QSemaphore m_openFiles;         //同时打开文件数的信号量
+    int m_maxOpenFiles;
+    std::atomic<bool> m_hashContent;    //是否计算音频内容哈希，解析线程读取
+
+    struct PendingResult
+    {
+        QUrl url;
+        Song * song;
+    };
+
+    QMutex m_orderMutex;            //保护下面的重排和攒批相关的成员
+    quint64 m_nextSeq;              //下一个分配的请求序号
+    quint64 m_emitSeq;              //下一个应该投递的序号
+    QHash<quint64, PendingResult> m_pending;//提前完成、等待前面序号的结果
+    QVector<Song*> m_batch;         //已按顺序完成、等待投递的歌曲
+    QList<Message> m_outbox;        //按顺序等待入队的消息
+    bool m_delivering;              //已经有线程在把发件箱中的消息入队
+    QWaitCondition m_outboxDrained; //发件箱腾出了空间
+    QElapsedTimer m_lastFlush;      //距上次投递的时间
+    QTimer * m_flushTimer;          //投递定时器，Worker的子对象，随Worker移到工作线程
+    int m_batchSize;
+    int m_batchLatencyMs;
+    int m_done;                     //本轮导入已完成的数量（包括失败的）
+    int m_total;                    //本轮导入请求的总数，全部完成后清零
+    int m_scans;                    //正在遍历目录的扫描数量，不为0时本轮导入还没有结束
+};
+
+
+/*消息队列单例类，用于存储消息（Message），共享给多个线程访问读写
+ *  内部是一个有界无锁多生产者多消费者环形队列MpmcQueue，多个解析线程同时入队时不会互相阻塞
+ *  try_push/try_pop 非阻塞的入队/出队接口，队列满/空时直接返回false
+ *  push 按背压策略入队：
+ *      Block   队列满时阻塞生产者，直到消费者取走消息腾出空间（默认，限制内存占用并让解析线程降速）
+ *      Reject  队列满时直接返回false，由生产者处理被拒绝的消息
+ *      注意：主线程是消费者，不要在主线程里以Block策略入队
+ *  pop 阻塞出队，最多等待timeoutMs毫秒
+ *  pop_bulk 一次最多取出n条消息，popAll 取出所有消息并清除已通知标记
+ *  无锁快速路径失败时才进入慢速路径，在互斥量和条件变量上睡眠等待
+ *      只有存在等待者时，对方才会去加锁唤醒，没有等待者时入队/出队完全不加锁
+ *  合并通知：armNotify在消费者被通知之后、来取之前只返回一次true，避免每条消息都发一次信号
+ *  析构时释放队列中还没被取走的消息持有的歌曲对象
+*/
+class MessageQueue
+{
+public:
+    enum OverflowPolicy { Block, Reject };
+
+private:
+    MessageQueue();
+    MessageQueue(const MessageQueue & other);
+    ~MessageQueue();
+
+public:
+    static MessageQueue & getInstance();
+
+private:
+    MpmcQueue<Message> m_queue;         //存储消息的无锁环形队列
+    std::atomic<int> m_policy;          //背压策略
+    std::atomic<bool> m_signalled;      //已经通知过消费者、消费者还没来取，期间入队不再重复通知
+
+    //慢速路径：没有数据/没有空间时在条件变量上睡眠
+    QMutex m_waitMutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    std::atomic<int> m_popWaiters;      //等待数据的消费者数量
+    std::atomic<int> m_pushWaiters;     //等待空间的生产者数量
+
+    void wakePoppers();
+    void wakePushers();
+
+public:
+    bool try_push(const Message & message);             //非阻塞入队
+    bool try_pop(Message & message);                    //非阻塞出队
+    bool push(const Message & message);                 //按背压策略入队，返回是否入队成功
+    bool pop(Message & message, int timeoutMs);         //阻塞出队，超时返回false
+    int pop_bulk(QList<Message> & messages, int n);     //一次最多取出n条消息，返回取出的数量
+    QList<Message> popAll();                            //取出所有消息
+    bool armNotify();                                   //入队后调用，返回true表示需要通知消费者
+    void setOverflowPolicy(OverflowPolicy policy);      //设置背压策略，会唤醒阻塞的生产者重新检查
+    OverflowPolicy overflowPolicy() const { return OverflowPolicy(m_policy.load()); }
+    bool empty();                                       //判断是否为空（近似值）
+    int size();                                         //获取大小（近似值）
+    int capacity() const { return (int)m_queue.capacity(); }
+};
+
+#endif // WORKER_H
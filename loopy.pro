@@ -0,0 +1,17 @@
+# Top-level project: the core library, the player, the headless indexer and the benchmarks.
+#   qmake loopy.pro && make
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    core \
+    app \
+    loopyindex \
+    benchmarks
+
+app.file = mediaplayer.pro
+app.depends = core
+
+loopyindex.subdir = tools/loopyindex
+loopyindex.depends = core
+
+benchmarks.depends = core
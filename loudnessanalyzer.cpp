@@ -0,0 +1,171 @@
+#include "loudnessanalyzer.h"
+#include "log.h"
+
+LoudnessAnalyzer::LoudnessAnalyzer(QObject *parent)
+    : QObject(parent)
+    , m_decoder(nullptr)
+    , m_cancelled(false)
+{
+
+}
+
+LoudnessAnalyzer::~LoudnessAnalyzer()
+{
+    if (m_decoder)
+    {
+        m_decoder->stop();
+    }
+}
+
+//先设置标志，正在处理的解码缓冲区马上停下；再排队到分析线程里清空队列，和之后的analyze保持先后顺序
+void LoudnessAnalyzer::cancel()
+{
+    m_cancelled.store(true);
+    QMetaObject::invokeMethod(this, "handle_cancel", Qt::QueuedConnection);
+}
+
+void LoudnessAnalyzer::handle_cancel()
+{
+    if (m_decoder)
+    {
+        m_decoder->stop();
+    }
+    if (!m_queue.isEmpty() || !m_current.isEmpty())
+    {
+        LOG_INFO(Analysis) << "取消响度分析，丢弃：" << m_queue.size() + (m_current.isEmpty() ? 0 : 1) << "首";
+    }
+    m_queue.clear();
+    m_current.clear();
+    m_meter.reset();
+    m_cancelled.store(false);
+}
+
+void LoudnessAnalyzer::analyze(const QList<QUrl> & mp3Urls)
+{
+    m_queue += mp3Urls;
+    if (m_current.isEmpty())
+    {
+        startNext();
+    }
+}
+
+void LoudnessAnalyzer::startNext()
+{
+    if (m_queue.isEmpty())
+    {
+        m_current.clear();
+        emit idle();
+        return;
+    }
+
+    //解码器在分析线程中第一次使用时创建，它的信号都在这个线程中处理
+    if (!m_decoder)
+    {
+        m_decoder = new QAudioDecoder(this);
+        connect(m_decoder, &QAudioDecoder::bufferReady, this, &LoudnessAnalyzer::handle_decoder_bufferReady);
+        connect(m_decoder, &QAudioDecoder::finished, this, &LoudnessAnalyzer::handle_decoder_finished);
+        connect(m_decoder, static_cast<void (QAudioDecoder::*)(QAudioDecoder::Error)>(&QAudioDecoder::error),
+                this, &LoudnessAnalyzer::handle_decoder_error);
+    }
+
+    m_current = m_queue.takeFirst();
+    m_meter.reset();
+    LOG_TRACE(Analysis) << "开始分析响度：" << m_current;
+
+    m_decoder->setSourceFilename(m_current.path());
+    m_decoder->start();
+}
+
+//先清空当前歌曲再停止解码器，停止过程中即使再收到解码器的信号也会被忽略
+void LoudnessAnalyzer::finishCurrent(float loudness, float truePeak)
+{
+    QUrl url = m_current;
+    m_current.clear();
+    m_meter.reset();
+    m_decoder->stop();
+
+    emit analyzed(url, loudness, truePeak);
+    startNext();
+}
+
+void LoudnessAnalyzer::handle_decoder_bufferReady()
+{
+    QAudioBuffer buffer = m_decoder->read();
+    if (m_cancelled.load() || m_current.isEmpty() || !buffer.isValid()) { return; }
+
+    const float * samples = toFloat(buffer, m_samples);
+    if (!samples || buffer.format().channelCount() > LoudnessMeter::MaxChannels)
+    {
+        LOG_WARNING(Analysis) << "不支持的采样格式，跳过：" << m_current;
+        finishCurrent(LoudnessMeter::Silence, 0);
+        return;
+    }
+
+    if (!m_meter)
+    {
+        m_meter.reset(new LoudnessMeter(buffer.format().sampleRate(), buffer.format().channelCount()));
+    }
+    m_meter->addFrames(samples, buffer.frameCount());
+}
+
+//取消后、handle_cancel执行前解码完成的结果不完整（期间的缓冲区都被丢掉了），不投递，留给handle_cancel清理
+void LoudnessAnalyzer::handle_decoder_finished()
+{
+    if (m_cancelled.load() || m_current.isEmpty()) { return; }
+
+    float loudness = m_meter ? (float)m_meter->integratedLoudness() : (float)LoudnessMeter::Silence;
+    float truePeak = m_meter ? (float)m_meter->truePeak() : 0.0f;
+    LOG_DEBUG(Analysis) << "响度：" << loudness << "LUFS，真峰值：" << truePeak << m_current;
+    finishCurrent(loudness, truePeak);
+}
+
+void LoudnessAnalyzer::handle_decoder_error(QAudioDecoder::Error error)
+{
+    if (m_cancelled.load() || m_current.isEmpty()) { return; }
+
+    LOG_WARNING(Analysis) << "解码失败：" << m_current << error << m_decoder->errorString();
+    finishCurrent(LoudnessMeter::Silence, 0);
+}
+
+/*
+ * 把解码缓冲区转换成交错存储的float
+ *  32位float直接返回缓冲区本身；16位、32位有符号整数和8位无符号整数按满幅缩放到-1~1
+ */
+const float * LoudnessAnalyzer::toFloat(const QAudioBuffer & buffer, QVector<float> & scratch)
+{
+    const QAudioFormat format = buffer.format();
+    if (format.byteOrder() != QAudioFormat::Endian(QSysInfo::ByteOrder)) { return nullptr; }
+
+    const int count = buffer.sampleCount();
+    if (format.sampleType() == QAudioFormat::Float && format.sampleSize() == 32)
+    {
+        return buffer.constData<float>();
+    }
+
+    if (scratch.size() < count)
+    {
+        scratch.resize(count);
+    }
+    float * out = scratch.data();
+
+    if (format.sampleType() == QAudioFormat::SignedInt && format.sampleSize() == 16)
+    {
+        const qint16 * in = buffer.constData<qint16>();
+        for (int i = 0; i < count; i++) { out[i] = in[i] * (1.0f / 32768.0f); }
+        return out;
+    }
+    if (format.sampleType() == QAudioFormat::SignedInt && format.sampleSize() == 32)
+    {
+        const qint32 * in = buffer.constData<qint32>();
+        for (int i = 0; i < count; i++) { out[i] = (float)(in[i] * (1.0 / 2147483648.0)); }
+        return out;
+    }
+    if (format.sampleType() == QAudioFormat::UnSignedInt && format.sampleSize() == 8)
+    {
+        const quint8 * in = buffer.constData<quint8>();
+        for (int i = 0; i < count; i++) { out[i] = (in[i] - 128) * (1.0f / 128.0f); }
+        return out;
+    }
+
+    return nullptr;
+}
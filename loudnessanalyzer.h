@@ -0,0 +1,60 @@
+#ifndef LOUDNESSANALYZER_H
+#define LOUDNESSANALYZER_H
+
+#include <QObject>
+#include <QAudioBuffer>
+#include <QAudioDecoder>
+#include <QList>
+#include <QScopedPointer>
+#include <QUrl>
+#include <QVector>
+#include <atomic>
+#include "loudness.h"
+
+/*响度分析类，在后台逐首解码歌曲并测量响度和真峰值（见LoudnessMeter），用于回放增益
+ *  和Worker一样是一个移到单独QThread中的对象，主线程通过信号槽投递请求、接收结果
+ *      线程以最低优先级运行，一次只解码一首歌，不和播放争抢CPU
+ *  解码使用QAudioDecoder，在本线程中创建，解码出的每段PCM直接送入测量器
+ *      32位float格式直接使用解码缓冲区，整数格式转换到复用的m_samples中
+ *  cancel可以在任意线程调用：正在解码的歌曲立即停止，队列中的请求全部丢弃
+ *  解码失败的歌曲也发出analyzed信号，响度为LoudnessMeter::Silence、峰值为0，避免反复重试
+ */
+class LoudnessAnalyzer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LoudnessAnalyzer(QObject *parent = nullptr);
+    ~LoudnessAnalyzer();
+
+    void cancel();      //取消正在进行和排队的分析，线程安全
+
+    //把解码缓冲区转换成交错存储的float，需要转换时写入scratch（按需增长、复用），不支持的格式返回nullptr
+    static const float * toFloat(const QAudioBuffer & buffer, QVector<float> & scratch);
+
+signals:
+    void analyzed(const QUrl & mp3Url, float loudness, float truePeak);   //一首歌分析完成
+    void idle();        //队列中的歌曲全部分析完
+
+public slots:
+    void analyze(const QList<QUrl> & mp3Urls);  //把歌曲加入分析队列
+
+private slots:
+    void handle_decoder_bufferReady();
+    void handle_decoder_finished();
+    void handle_decoder_error(QAudioDecoder::Error error);
+    void handle_cancel();
+
+private:
+    void startNext();
+    void finishCurrent(float loudness, float truePeak);
+
+private:
+    QAudioDecoder * m_decoder;
+    QList<QUrl> m_queue;                //等待分析的歌曲
+    QUrl m_current;                     //正在分析的歌曲，空闲时为空
+    QScopedPointer<LoudnessMeter> m_meter;  //第一段PCM到达、知道采样率和声道数后创建
+    QVector<float> m_samples;           //整数格式转换用的缓冲区，复用
+    std::atomic<bool> m_cancelled;
+};
+
+#endif // LOUDNESSANALYZER_H
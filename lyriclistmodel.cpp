@@ -0,0 +1,51 @@
+#include "lyriclistmodel.h"
+
+LyricListModel::LyricListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+
+}
+
+int LyricListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) { return 0; }
+    if (m_lyrics && !m_lyrics->isEmpty()) { return m_lyrics->size(); }
+    return m_placeholder.isEmpty() ? 0 : 1;
+}
+
+QVariant LyricListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) { return QVariant(); }
+
+    if (role == Qt::TextAlignmentRole)
+    {
+        return int(Qt::AlignCenter);    //设置每行文本居中显示
+    }
+
+    if (role == Qt::DisplayRole)
+    {
+        if (m_lyrics && !m_lyrics->isEmpty())
+        {
+            return index.row() < m_lyrics->size() ? m_lyrics->text(index.row()) : QVariant();
+        }
+        return m_placeholder;
+    }
+
+    return QVariant();
+}
+
+void LyricListModel::setLyrics(const LyricsPtr & lyrics)
+{
+    beginResetModel();
+    m_lyrics = lyrics;
+    m_placeholder = "无歌词";
+    endResetModel();
+}
+
+void LyricListModel::setPlaceholder(const QString & text)
+{
+    beginResetModel();
+    m_lyrics.reset();
+    m_placeholder = text;
+    endResetModel();
+}
@@ -0,0 +1,30 @@
+#ifndef LYRICLISTMODEL_H
+#define LYRICLISTMODEL_H
+
+#include <QAbstractListModel>
+#include "lyriccache.h"
+
+/*歌词列表模型，取代QListWidget中每行歌词一个QListWidgetItem
+ *  直接以当前歌曲的歌词时间轴作为数据源，换歌时只替换共享指针并重置模型
+ *  没有歌词或者歌词还在加载时，显示一行提示文本
+ *  所有行文本居中显示
+ */
+class LyricListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit LyricListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void setLyrics(const LyricsPtr & lyrics);       //显示一首歌的歌词，为空时显示"无歌词"
+    void setPlaceholder(const QString & text);      //清空歌词，只显示一行提示
+    const LyricsPtr & lyrics() const { return m_lyrics; }
+
+private:
+    LyricsPtr m_lyrics;
+    QString m_placeholder;
+};
+
+#endif // LYRICLISTMODEL_H
@@ -1,11 +1,27 @@
 #include "widget.h"
+#include "log.h"
+#include "startupprobe.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    //启动计时，进入main之前的时间由进程创建时间补上；第一帧画出来之后输出各阶段的耗时
+    StartupProbe & probe = StartupProbe::getInstance();
+    probe.start();
+
     QApplication a(argc, argv);
+    probe.mark("QApplication");
+
+    //启动日志后台输出线程，LOOPY_LOG_FILE为空时输出到标准错误
+    Logger::getInstance().start(QString::fromLocal8Bit(qgetenv("LOOPY_LOG_FILE")));
+
     Widget w;
+    probe.mark("Widget");
     w.show();
-    return a.exec();
+    probe.mark("show");
+    int ret = a.exec();
+
+    Logger::getInstance().stop();
+    return ret;
 }
@@ -15,16 +15,42 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Songs, parsing, the library index and logging live in the GUI-free core library (core/core.pro).
+# Build everything from loopy.pro so the library is built before this target.
+include(core/core.pri)
+
 SOURCES += \
+    loudnessanalyzer.cpp \
+    lyriclistmodel.cpp \
     main.cpp \
-    song.cpp \
-    widget.cpp \
-    worker.cpp
+    nativeaudioengine.cpp \
+    pcmdecoder.cpp \
+    pcmoutput.cpp \
+    playbackengine.cpp \
+    songfiltermodel.cpp \
+    songlistmodel.cpp \
+    spectrumanalyzer.cpp \
+    spectrumview.cpp \
+    uischeduler.cpp \
+    waveformcache.cpp \
+    waveformview.cpp \
+    widget.cpp
 
 HEADERS += \
-    song.h \
-    widget.h \
-    worker.h
+    loudnessanalyzer.h \
+    lyriclistmodel.h \
+    nativeaudioengine.h \
+    pcmdecoder.h \
+    pcmoutput.h \
+    playbackengine.h \
+    songfiltermodel.h \
+    songlistmodel.h \
+    spectrumanalyzer.h \
+    spectrumview.h \
+    uischeduler.h \
+    waveformcache.h \
+    waveformview.h \
+    widget.h
 
 FORMS += \
     widget.ui
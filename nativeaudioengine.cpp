@@ -0,0 +1,421 @@
+#include "nativeaudioengine.h"
+#include "pcmdecoder.h"
+#include "pcmoutput.h"
+#include "log.h"
+#include "song.h"
+#include <QTimer>
+#include <limits>
+
+//环形缓冲区能存放的时长，解码线程偶尔被耽搁时由它顶上
+static const int kRingMs = 2000;
+
+//播放时换算播放位置的间隔
+static const int kPositionIntervalMs = 40;
+
+static const quint64 kNoEnd = std::numeric_limits<quint64>::max();
+
+/*
+ * 选择输出格式
+ *  采样率用设备的首选值，双声道；优先32位float，设备不支持时用16位整数
+ *  两种都不支持时返回nullptr，由调用者改用QMediaPlayer
+ */
+NativeAudioEngine * NativeAudioEngine::create(QObject *parent)
+{
+    QAudioDeviceInfo device = QAudioDeviceInfo::defaultOutputDevice();
+    if (device.isNull()) { return nullptr; }
+
+    QAudioFormat format = device.preferredFormat();
+    format.setCodec("audio/pcm");
+    format.setChannelCount(2);
+    format.setByteOrder(QAudioFormat::Endian(QSysInfo::ByteOrder));
+    format.setSampleType(QAudioFormat::Float);
+    format.setSampleSize(32);
+    if (!device.isFormatSupported(format))
+    {
+        format.setSampleType(QAudioFormat::SignedInt);
+        format.setSampleSize(16);
+        if (!device.isFormatSupported(format)) { return nullptr; }
+    }
+
+    return new NativeAudioEngine(device, format, parent);
+}
+
+NativeAudioEngine::NativeAudioEngine(const QAudioDeviceInfo & device, const QAudioFormat & format, QObject *parent)
+    : PlaybackEngine(parent)
+    , m_format(format)
+    , m_ring(new PcmRingBuffer(format.sampleRate() * kRingMs / 1000, format.channelCount()))
+    , m_pdecodethread(new QThread)
+    , m_poutputthread(new QThread)
+    , m_ptimer(new QTimer(this))
+    , m_pplaylist(nullptr)
+    , m_state(QMediaPlayer::StoppedState)
+    , m_volume(100)
+    , m_position(0)
+    , m_duration(0)
+    , m_serial(0)
+    , m_endFrame(kNoEnd)
+    , m_advancing(false)
+{
+    qRegisterMetaType<quint64>("quint64");     //跨线程排队信号的参数类型需要注册
+    qRegisterMetaType<SeekIndex>("SeekIndex");
+    qRegisterMetaType<AudioTap *>("AudioTap*");
+
+    // 解码器输出和设备相同的采样率和声道数，16位整数是各个平台的解码器都支持的格式
+    QAudioFormat decodeFormat = format;
+    decodeFormat.setSampleType(QAudioFormat::SignedInt);
+    decodeFormat.setSampleSize(16);
+
+    m_pdecoder = new PcmDecoder(m_ring.data(), decodeFormat);
+    m_pdecoder->moveToThread(m_pdecodethread);
+    connect(this, &NativeAudioEngine::loadTrack, m_pdecoder, &PcmDecoder::load);
+    connect(this, &NativeAudioEngine::finishStream, m_pdecoder, &PcmDecoder::finish);
+    connect(this, &NativeAudioEngine::haltDecoder, m_pdecoder, &PcmDecoder::halt);
+    connect(m_pdecoder, &PcmDecoder::trackStarted, this, &NativeAudioEngine::handle_decoder_trackStarted);
+    connect(m_pdecoder, &PcmDecoder::durationChanged, this, &NativeAudioEngine::handle_decoder_durationChanged);
+    connect(m_pdecoder, &PcmDecoder::trackDecoded, this, &NativeAudioEngine::handle_decoder_trackDecoded);
+    connect(m_pdecoder, &PcmDecoder::streamEnded, this, &NativeAudioEngine::handle_decoder_streamEnded);
+
+    m_poutput = new PcmOutput(m_ring.data(), device, format);
+    m_poutput->moveToThread(m_poutputthread);
+    connect(this, &NativeAudioEngine::startOutput, m_poutput, &PcmOutput::start);
+    connect(this, &NativeAudioEngine::pauseOutput, m_poutput, &PcmOutput::pause);
+    connect(this, &NativeAudioEngine::stopOutput, m_poutput, &PcmOutput::stop);
+    connect(this, &NativeAudioEngine::changeOutputTap, m_poutput, &PcmOutput::setTap, Qt::BlockingQueuedConnection);
+
+    connect(m_ptimer, &QTimer::timeout, this, &NativeAudioEngine::handle_timer_timeout);
+    m_ptimer->setInterval(kPositionIntervalMs);
+
+    m_pdecodethread->start(QThread::HighPriority);
+    m_poutputthread->start(QThread::TimeCriticalPriority);
+}
+
+//解码端和输出端在各自的线程中释放（它们的解码器、音频设备和定时器都属于那个线程），deleteLater排在quit之前，线程退出前处理
+NativeAudioEngine::~NativeAudioEngine()
+{
+    m_pdecoder->deleteLater();
+    m_poutput->deleteLater();
+    m_pdecodethread->quit();
+    m_poutputthread->quit();
+    m_pdecodethread->wait();
+    m_poutputthread->wait();
+    delete m_pdecodethread;
+    delete m_poutputthread;
+}
+
+void NativeAudioEngine::setPlaylist(QMediaPlaylist * playlist)
+{
+    if (m_pplaylist)
+    {
+        disconnect(m_pplaylist, nullptr, this, nullptr);
+    }
+    m_pplaylist = playlist;
+    connect(m_pplaylist, &QMediaPlaylist::currentIndexChanged, this, &NativeAudioEngine::handle_playlist_currentIndexChanged);
+    connect(m_pplaylist, &QMediaPlaylist::currentMediaChanged, this, &PlaybackEngine::currentMediaChanged);
+}
+
+/*
+ * 在输出线程中换掉音频旁路，阻塞到换完为止
+ *  音频回调也在输出线程中，返回时不会还有回调在用旧的旁路，调用者马上释放它也是安全的
+ */
+void NativeAudioEngine::setAudioTap(AudioTap * tap)
+{
+    emit changeOutputTap(tap);
+}
+
+void NativeAudioEngine::setCrossfade(int ms)
+{
+    QMetaObject::invokeMethod(m_pdecoder, "setCrossfade", Qt::QueuedConnection, Q_ARG(int, qMax(0, ms)));
+    LOG_INFO(Playback) << "音频引擎：交叉淡化" << ms << "毫秒";
+}
+
+int NativeAudioEngine::latency() const
+{
+    return (int)((qint64)m_poutput->latencyFrames() * 1000 / m_format.sampleRate());
+}
+
+quint64 NativeAudioEngine::underruns() const
+{
+    return m_poutput->underruns();
+}
+
+void NativeAudioEngine::play()
+{
+    if (!m_pplaylist || m_pplaylist->isEmpty() || m_state == QMediaPlayer::PlayingState) { return; }
+
+    if (m_state == QMediaPlayer::StoppedState || m_tracks.isEmpty())
+    {
+        // 和QMediaPlayer一样，播放列表还没有当前歌曲时从第一首开始
+        if (m_pplaylist->currentIndex() < 0)
+        {
+            m_advancing = true;
+            m_pplaylist->setCurrentIndex(0);
+            m_advancing = false;
+        }
+        load(m_pplaylist->currentIndex(), 0, true);
+    }
+
+    setState(QMediaPlayer::PlayingState);
+    applyGain();
+    emit startOutput();
+    m_ptimer->start();
+}
+
+void NativeAudioEngine::pause()
+{
+    if (m_state != QMediaPlayer::PlayingState) { return; }
+
+    setState(QMediaPlayer::PausedState);
+    emit pauseOutput();
+    m_ptimer->stop();
+}
+
+void NativeAudioEngine::stop()
+{
+    if (m_state == QMediaPlayer::StoppedState) { return; }
+
+    m_ptimer->stop();
+    m_tracks.clear();
+    m_endFrame = kNoEnd;
+    emit haltDecoder();
+    emit stopOutput();
+
+    setState(QMediaPlayer::StoppedState);
+    m_position = 0;
+    emit positionChanged(0);
+}
+
+void NativeAudioEngine::setPosition(qint64 position)
+{
+    if (m_tracks.isEmpty()) { return; }
+
+    load(m_tracks.first().index, qMax<qint64>(0, position), true);
+}
+
+void NativeAudioEngine::setVolume(int volume)
+{
+    m_volume = qBound(0, volume, 100);
+    applyGain();
+}
+
+//暂停和停止时输出端自己淡出到0，这里只在播放时设置目标增益
+void NativeAudioEngine::applyGain()
+{
+    if (m_state == QMediaPlayer::PlayingState)
+    {
+        m_poutput->setGain(m_volume / 100.0f);
+    }
+}
+
+void NativeAudioEngine::setState(QMediaPlayer::State state)
+{
+    if (state == m_state) { return; }
+
+    m_state = state;
+    emit stateChanged(state);
+}
+
+/*
+ * 把播放列表的一首歌交给解码端
+ *  flush：丢弃之前的所有歌曲，输出端重新预缓冲，播放位置立即显示为新的位置
+ *  否则接在最后一首后面，播放到它时才成为当前歌曲
+ */
+void NativeAudioEngine::load(int index, qint64 startMs, bool flush)
+{
+    Track track;
+    track.serial = ++m_serial;
+    track.index = index;
+    track.url = m_pplaylist->media(index).canonicalUrl();
+    track.started = false;
+    track.firstFrame = 0;
+    track.startMs = startMs;
+
+    // 跳转索引只在主线程的歌曲管理类中，随加载命令一起交给解码端
+    SongManager & songs = SongManager::getInstance();
+    const SongId id = songs.find(track.url);
+    const SeekIndex seekIndex = id >= 0 ? songs.seekIndex(id) : SeekIndex();
+    track.indexed = seekIndex.isValid();
+    track.duration = seekIndex.duration();
+
+    if (flush)
+    {
+        // 同一首歌里跳转时时长不变，换歌时用索引的时长，没有索引时等解码端报告新的时长
+        if (!track.indexed && !m_tracks.isEmpty() && m_tracks.first().url == track.url)
+        {
+            track.duration = m_tracks.first().duration;
+        }
+        if (track.duration != m_duration)
+        {
+            m_duration = track.duration;
+            emit durationChanged(m_duration);
+        }
+
+        m_tracks.clear();
+        m_endFrame = kNoEnd;
+        m_poutput->reprime();
+        m_position = startMs;
+        emit positionChanged(startMs);
+    }
+    m_tracks.append(track);
+
+    emit loadTrack(track.serial, track.url, startMs, flush, seekIndex);
+}
+
+NativeAudioEngine::Track * NativeAudioEngine::track(quint64 serial)
+{
+    for (int i = 0; i < m_tracks.size(); i++)
+    {
+        if (m_tracks[i].serial == serial) { return &m_tracks[i]; }
+    }
+    return nullptr;
+}
+
+/*
+ * 解码完一首后接哪一首
+ *  解码的正是播放列表的当前歌曲时直接问播放列表（包括随机模式）
+ *  否则是很短的歌曲，解码已经领先播放不止一首，按播放模式顺序推算
+ */
+int NativeAudioEngine::nextIndexAfter(int index) const
+{
+    if (index == m_pplaylist->currentIndex())
+    {
+        return m_pplaylist->nextIndex();
+    }
+
+    const int count = m_pplaylist->mediaCount();
+    switch (m_pplaylist->playbackMode())
+    {
+    case QMediaPlaylist::CurrentItemOnce:
+        return -1;
+    case QMediaPlaylist::CurrentItemInLoop:
+        return index;
+    case QMediaPlaylist::Sequential:
+        return index + 1 < count ? index + 1 : -1;
+    default:
+        return count > 0 ? (index + 1) % count : -1;
+    }
+}
+
+void NativeAudioEngine::handle_playlist_currentIndexChanged(int index)
+{
+    if (m_advancing) { return; }
+
+    if (index < 0)
+    {
+        stop();
+        return;
+    }
+
+    // 播放列表增删歌曲只是挪了下标，正在播放的还是同一首
+    const QUrl url = m_pplaylist->media(index).canonicalUrl();
+    if (!m_tracks.isEmpty() && m_tracks.first().url == url)
+    {
+        m_tracks.first().index = index;
+        return;
+    }
+
+    // 停止时只记住当前歌曲，play时再开始解码
+    if (m_state != QMediaPlayer::StoppedState)
+    {
+        load(index, 0, true);
+    }
+}
+
+void NativeAudioEngine::handle_decoder_trackStarted(quint64 serial, quint64 firstFrame, qint64 startMs)
+{
+    Track * t = track(serial);
+    if (!t) { return; }     //跳转或切歌之前的过期信号
+
+    t->started = true;
+    t->firstFrame = firstFrame;
+    t->startMs = startMs;
+}
+
+void NativeAudioEngine::handle_decoder_durationChanged(quint64 serial, qint64 duration)
+{
+    Track * t = track(serial);
+    if (!t || t->indexed) { return; }   //索引按帧数算出的时长更准，从片段开始解码时解码器报告的时长也不对
+
+    t->duration = duration;
+    if (t == &m_tracks.first() && duration != m_duration)
+    {
+        m_duration = duration;
+        emit durationChanged(duration);
+    }
+}
+
+void NativeAudioEngine::handle_decoder_trackDecoded(quint64 serial)
+{
+    Track * t = track(serial);
+    if (!t || t != &m_tracks.last()) { return; }
+
+    int next = nextIndexAfter(t->index);
+    if (next >= 0)
+    {
+        load(next, 0, false);
+    }
+    else
+    {
+        emit finishStream(serial);
+    }
+}
+
+void NativeAudioEngine::handle_decoder_streamEnded(quint64 serial, quint64 endFrame)
+{
+    if (!track(serial)) { return; }
+
+    m_endFrame = endFrame;
+    m_poutput->setDraining(true);
+}
+
+/*
+ * 换算播放位置
+ *  按输出端播放到的帧找到正在播放的歌曲（第一帧编号不大于它的最后一首），前面的歌曲都已经播完
+ *  播放到下一首时更新播放列表的当前下标，界面随之切歌
+ */
+void NativeAudioEngine::handle_timer_timeout()
+{
+    const quint64 played = m_poutput->playedFrame();
+    if (played >= m_endFrame)
+    {
+        LOG_DEBUG(Playback) << "播放列表播放完毕";
+        stop();
+        return;
+    }
+
+    int current = -1;
+    for (int i = 0; i < m_tracks.size(); i++)
+    {
+        if (m_tracks[i].started && m_tracks[i].firstFrame <= played) { current = i; }
+    }
+    if (current < 0) { return; }    //刚跳转，输出端还在播放之前的数据
+
+    bool advanced = current > 0;
+    for (int i = 0; i < current; i++)
+    {
+        m_tracks.removeFirst();
+    }
+
+    const Track & t = m_tracks.first();
+    if (advanced)
+    {
+        LOG_DEBUG(Playback) << "播放到下一首：" << t.url.fileName() << "，输出延迟" << latency() << "毫秒，累计欠载" << underruns() << "次";
+        if (m_pplaylist->currentIndex() != t.index)
+        {
+            m_advancing = true;
+            m_pplaylist->setCurrentIndex(t.index);
+            m_advancing = false;
+        }
+        if (t.duration != m_duration)
+        {
+            m_duration = t.duration;
+            emit durationChanged(m_duration);
+        }
+    }
+
+    const qint64 position = t.startMs + (qint64)(played - t.firstFrame) * 1000 / m_format.sampleRate();
+    if (position != m_position)
+    {
+        m_position = position;
+        emit positionChanged(position);
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef NATIVEAUDIOENGINE_H
+#define NATIVEAUDIOENGINE_H
+
+#include <QAudioDeviceInfo>
+#include <QAudioFormat>
+#include <QList>
+#include <QScopedPointer>
+#include <QThread>
+#include <QUrl>
+#include "playbackengine.h"
+#include "pcmringbuffer.h"
+#include "seekindex.h"
+
+class PcmDecoder;
+class PcmOutput;
+class QTimer;
+
+/*自己解码和输出的播放引擎（LOOPY_ENGINE=native），不经过QMediaPlayer
+ *  解码线程（PcmDecoder）→ 无锁SPSC环形缓冲区（PcmRingBuffer）→ 输出线程（PcmOutput，QAudioOutput拉模式）
+ *  引擎本身在主线程，只通过排队信号给两个线程下命令，从原子变量读取播放到的帧，界面操作不会阻塞音频
+ *  曲目边界：每首歌（包括每次跳转）有一个序号，解码端报告它的第一帧在环形缓冲区中的编号，
+ *      定时器按输出端实际播放到的帧找到正在播放的是哪一首，换算出播放位置，播放到下一首时更新播放列表的当前下标
+ *  无缝播放：一首歌解码完成时就让解码端接上播放列表的下一首，中间没有空隙；设置了交叉淡化时两首重叠等功率混合
+ *  用户切歌、跳转时丢弃环形缓冲区中还没播放的数据，从新的位置重新预缓冲
+ *  歌曲库中有跳转索引的歌曲，时长取自索引，跳转时解码端按索引直接从目标位置附近开始解码
+ */
+class NativeAudioEngine : public PlaybackEngine
+{
+    Q_OBJECT
+public:
+    ~NativeAudioEngine();
+
+    //选择默认输出设备和格式，没有可用的设备或者格式时返回nullptr
+    static NativeAudioEngine * create(QObject *parent = nullptr);
+
+    void setPlaylist(QMediaPlaylist * playlist) override;
+    QMediaPlayer::State state() const override { return m_state; }
+    qint64 position() const override { return m_position; }
+    qint64 duration() const override { return m_duration; }
+    int volume() const override { return m_volume; }
+    void setAudioTap(AudioTap * tap) override;     //输出线程在音频回调中把乘上音量之前的PCM交给它
+
+    void setCrossfade(int ms);      //交叉淡化的毫秒数，0表示无缝衔接
+    int latency() const;            //测量到的输出延迟（毫秒）
+    quint64 underruns() const;      //累计欠载次数
+
+public slots:
+    void play() override;
+    void pause() override;
+    void stop() override;
+    void setPosition(qint64 position) override;
+    void setVolume(int volume) override;
+
+signals:
+    //给解码线程和输出线程的命令，排队执行
+    void loadTrack(quint64 serial, const QUrl & url, qint64 startMs, bool flush, const SeekIndex & index);
+    void finishStream(quint64 serial);
+    void haltDecoder();
+    void startOutput();
+    void pauseOutput();
+    void stopOutput();
+    void changeOutputTap(AudioTap * tap);   //阻塞到输出线程执行完
+
+private slots:
+    void handle_playlist_currentIndexChanged(int index);
+    void handle_decoder_trackStarted(quint64 serial, quint64 firstFrame, qint64 startMs);
+    void handle_decoder_durationChanged(quint64 serial, qint64 duration);
+    void handle_decoder_trackDecoded(quint64 serial);
+    void handle_decoder_streamEnded(quint64 serial, quint64 endFrame);
+    void handle_timer_timeout();
+
+private:
+    NativeAudioEngine(const QAudioDeviceInfo & device, const QAudioFormat & format, QObject *parent);
+
+    struct Track
+    {
+        quint64 serial;
+        int index;              //播放列表下标
+        QUrl url;
+        bool started;           //解码端已经报告了第一帧的编号
+        quint64 firstFrame;
+        qint64 startMs;         //第一帧在歌曲中的位置，跳转时不为0
+        qint64 duration;
+        bool indexed;           //有跳转索引，时长以索引为准
+    };
+
+    void load(int index, qint64 startMs, bool flush);
+    Track * track(quint64 serial);
+    int nextIndexAfter(int index) const;
+    void setState(QMediaPlayer::State state);
+    void applyGain();
+
+    QAudioFormat m_format;
+    QScopedPointer<PcmRingBuffer> m_ring;
+    QThread * m_pdecodethread;
+    PcmDecoder * m_pdecoder;
+    QThread * m_poutputthread;
+    PcmOutput * m_poutput;
+    QTimer * m_ptimer;                  //播放时定时换算播放位置
+
+    QMediaPlaylist * m_pplaylist;
+    QMediaPlayer::State m_state;
+    int m_volume;
+    qint64 m_position;
+    qint64 m_duration;
+
+    QList<Track> m_tracks;              //已经交给解码端的歌曲，按播放顺序，第一首是正在播放的
+    quint64 m_serial;                   //最近分配的序号
+    quint64 m_endFrame;                 //流结束的帧编号，播放到这里就停止；没有结束时为最大值
+    bool m_advancing;                   //引擎自己在改播放列表的当前下标
+};
+
+#endif // NATIVEAUDIOENGINE_H
@@ -0,0 +1,401 @@
+#include "pcmdecoder.h"
+#include "audiomix.h"
+#include "loudnessanalyzer.h"
+#include "log.h"
+#include "seektablecache.h"
+#include <QAudioBuffer>
+#include <QFile>
+#include <QTimer>
+#include <cmath>
+#include <cstring>
+
+//搬运数据的间隔，远小于环形缓冲区能播放的时长
+static const int kPumpIntervalMs = 5;
+
+//m_pending中除了交叉淡化留着的尾巴，最多再积压这么长的数据
+static const int kBacklogMs = 500;
+
+//已经写出的数据超过这么多采样并且超过一半时，才把m_pending前面腾出来
+static const int kCompactSamples = 64 * 1024;
+
+static const float kHalfPi = 1.57079632679489662f;
+
+/*文件从某个帧开始到末尾的部分，作为一个从0开始的设备交给解码器
+ *  解码器看到的就是一个从这一帧开始的mp3流，自己同步到帧头
+ *  第一帧用到的位储备在前面的帧里，解码器可能丢掉或者静音这一帧，误差不超过一帧
+ */
+class FileSlice : public QIODevice
+{
+public:
+    FileSlice(const QString & path, qint64 offset, QObject * parent)
+        : QIODevice(parent), m_file(path), m_offset(offset)
+    {}
+
+    bool open(OpenMode mode) override
+    {
+        if (!m_file.open(QIODevice::ReadOnly)) { return false; }
+        return QIODevice::open(mode);
+    }
+
+    void close() override
+    {
+        QIODevice::close();
+        m_file.close();
+    }
+
+    qint64 size() const override { return qMax<qint64>(0, m_file.size() - m_offset); }
+
+protected:
+    qint64 readData(char * data, qint64 maxSize) override
+    {
+        if (!m_file.seek(m_offset + pos())) { return -1; }
+        return m_file.read(data, maxSize);
+    }
+
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    QFile m_file;
+    qint64 m_offset;
+};
+
+PcmDecoder::PcmDecoder(PcmRingBuffer * ring, const QAudioFormat & format, QObject *parent)
+    : QObject(parent)
+    , m_ring(ring)
+    , m_format(format)
+    , m_channels(format.channelCount())
+    , m_holdbackFrames(0)
+    , m_maxBacklog(format.sampleRate() * kBacklogMs / 1000 * format.channelCount())
+    , m_decoder(nullptr)
+    , m_source(nullptr)
+    , m_timer(nullptr)
+    , m_serial(0)
+    , m_skipFrames(0)
+    , m_sourceDone(true)
+    , m_trackDone(true)
+    , m_finishing(false)
+    , m_streamEnded(true)
+    , m_pendingPos(0)
+    , m_fadeAt(-1)
+    , m_fadeDone(0)
+    , m_fadeLength(0)
+{
+
+}
+
+PcmDecoder::~PcmDecoder()
+{
+    if (m_decoder)
+    {
+        m_decoder->stop();
+    }
+}
+
+void PcmDecoder::setCrossfade(int ms)
+{
+    m_holdbackFrames = (int)qMax<qint64>(0, (qint64)m_format.sampleRate() * ms / 1000);
+    m_maxBacklog = (m_holdbackFrames + m_format.sampleRate() * kBacklogMs / 1000) * m_channels;
+}
+
+void PcmDecoder::load(quint64 serial, const QUrl & url, qint64 startMs, bool flush, const SeekIndex & index)
+{
+    //定时器在解码线程中第一次使用时创建，它的信号在这个线程中处理
+    if (!m_timer)
+    {
+        m_timer = new QTimer(this);
+        connect(m_timer, &QTimer::timeout, this, &PcmDecoder::pump);
+    }
+
+    //每首歌换一个新的解码器，上一首的解码器断开连接后延迟释放，它还没处理完的finished/error不会落到这一首上
+    //上一首的文件片段交给旧解码器，随它一起释放，解码器不会引用已经释放的片段
+    if (m_decoder)
+    {
+        m_decoder->disconnect(this);
+        m_decoder->stop();
+        if (m_source)
+        {
+            m_source->setParent(m_decoder);
+            m_source = nullptr;
+        }
+        m_decoder->deleteLater();
+    }
+    m_decoder = new QAudioDecoder(this);
+    m_decoder->setAudioFormat(m_format);
+    connect(m_decoder, &QAudioDecoder::bufferReady, this, &PcmDecoder::pump);
+    connect(m_decoder, &QAudioDecoder::durationChanged, this, &PcmDecoder::handle_decoder_durationChanged);
+    connect(m_decoder, &QAudioDecoder::finished, this, &PcmDecoder::handle_decoder_finished);
+    connect(m_decoder, static_cast<void (QAudioDecoder::*)(QAudioDecoder::Error)>(&QAudioDecoder::error),
+            this, &PcmDecoder::handle_decoder_error);
+
+    quint64 firstFrame = 0;
+    if (flush)
+    {
+        // 丢弃积压的数据，输出端跳过环形缓冲区中已有的帧，新数据从当前的写位置开始
+        m_pending.remove(0, m_pending.size());
+        m_pendingPos = 0;
+        m_fadeAt = -1;
+        firstFrame = m_ring->written();
+        m_ring->discardUntil(firstFrame);
+    }
+    else
+    {
+        // 上一首留着的尾巴和这一首的开头交叉淡化，这一首从尾巴的第一帧开始算
+        const int tail = qMin(m_holdbackFrames * m_channels, m_pending.size() - m_pendingPos);
+        m_fadeLength = tail / m_channels;
+        m_fadeDone = 0;
+        m_fadeAt = m_fadeLength > 0 ? m_pending.size() - tail : -1;
+        firstFrame = m_ring->written() + (m_pending.size() - tail - m_pendingPos) / m_channels;
+    }
+
+    // 有跳转索引时从目标位置之前最近的帧开始解码，只丢弃这一帧到目标位置之间的数据
+    qint64 skipMs = startMs;
+    QIODevice * source = nullptr;
+    if (startMs > 0 && index.isValid())
+    {
+        // 偏移表每首歌只读取或建立一次，失败时也不再重试，按导入时的索引跳转；重新导入过（参数变了）时再读一次
+        if (index.needsTable() && (url != m_tableUrl || index.frames() != m_tableIndex.frames() || index.bytes() != m_tableIndex.bytes()))
+        {
+            m_tableIndex = SeekTableCache::load(url.path(), index);
+            m_tableUrl = url;
+        }
+
+        const SeekIndex::Point point = (index.needsTable() ? m_tableIndex : index).locate(startMs);
+        FileSlice * slice = point.offset >= 0 ? new FileSlice(url.path(), point.offset, this) : nullptr;
+        if (slice && slice->open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        {
+            source = slice;
+            skipMs = qMax<qint64>(0, startMs - point.ms);
+        }
+        else
+        {
+            delete slice;
+        }
+    }
+
+    m_serial = serial;
+    m_url = url;
+    m_skipFrames = skipMs * m_format.sampleRate() / 1000;
+    m_sourceDone = false;
+    m_trackDone = false;
+    m_finishing = false;
+    m_streamEnded = false;
+    LOG_DEBUG(Playback) << "开始解码：" << url.fileName() << "位置" << startMs << "毫秒" << (flush ? "" : "，接在上一首后面")
+                        << (source ? "，按跳转索引定位" : "");
+
+    emit trackStarted(serial, firstFrame, startMs);
+
+    if (source)
+    {
+        m_decoder->setSourceDevice(source);
+    }
+    else
+    {
+        m_decoder->setSourceFilename(url.path());
+    }
+    m_source = source;
+    m_decoder->start();
+    m_timer->start(kPumpIntervalMs);
+}
+
+void PcmDecoder::finish(quint64 serial)
+{
+    if (serial != m_serial) { return; }
+
+    m_finishing = true;
+    pump();
+}
+
+void PcmDecoder::halt()
+{
+    if (m_decoder)
+    {
+        m_decoder->stop();
+        m_timer->stop();
+    }
+    m_pending.remove(0, m_pending.size());
+    m_pendingPos = 0;
+    m_fadeAt = -1;
+    m_ring->discardUntil(m_ring->written());
+
+    m_sourceDone = true;
+    m_trackDone = true;
+    m_streamEnded = true;
+}
+
+/*
+ * 搬运数据
+ *  先把能写的写进环形缓冲区，积压不多时再从解码器取，取完再写一次
+ *  解码器结束并且取空后，这首歌解码完成；finish之后尾巴也写完，整个流结束
+ */
+void PcmDecoder::pump()
+{
+    if (m_streamEnded) { return; }
+
+    writeOut();
+    while (m_pending.size() - m_pendingPos < m_maxBacklog && m_decoder->bufferAvailable())
+    {
+        consume(m_decoder->read());
+    }
+    writeOut();
+
+    if (m_sourceDone && !m_trackDone && !m_decoder->bufferAvailable())
+    {
+        m_trackDone = true;
+        fadeOutRest();
+        LOG_TRACE(Playback) << "解码完成：" << m_url.fileName();
+        emit trackDecoded(m_serial);
+    }
+
+    if (m_finishing && m_pendingPos == m_pending.size())
+    {
+        m_streamEnded = true;
+        m_timer->stop();
+        emit streamEnded(m_serial, m_ring->written());
+    }
+}
+
+//交叉淡化的尾巴要等混合完，其余的数据要留够下一次淡化的尾巴
+int PcmDecoder::writeLimit() const
+{
+    int limit = m_pending.size();
+    if (!m_finishing)
+    {
+        limit -= m_holdbackFrames * m_channels;
+    }
+    if (m_fadeAt >= 0)
+    {
+        limit = qMin(limit, m_fadeAt);
+    }
+    return qMax(limit, m_pendingPos);
+}
+
+void PcmDecoder::writeOut()
+{
+    const int frames = (writeLimit() - m_pendingPos) / m_channels;
+    if (frames > 0)
+    {
+        m_pendingPos += m_ring->write(m_pending.constData() + m_pendingPos, frames) * m_channels;
+    }
+    compact();
+}
+
+void PcmDecoder::compact()
+{
+    if (m_pendingPos < kCompactSamples || m_pendingPos * 2 < m_pending.size()) { return; }
+
+    m_pending.remove(0, m_pendingPos);
+    if (m_fadeAt >= 0)
+    {
+        m_fadeAt -= m_pendingPos;
+    }
+    m_pendingPos = 0;
+}
+
+void PcmDecoder::consume(const QAudioBuffer & buffer)
+{
+    if (!buffer.isValid()) { return; }
+
+    const QAudioFormat format = buffer.format();
+    const float * samples = LoudnessAnalyzer::toFloat(buffer, m_scratch);
+    if (!samples || format.sampleRate() != m_format.sampleRate()
+            || (format.channelCount() != m_channels && format.channelCount() != 1))
+    {
+        LOG_WARNING(Playback) << "解码器没有按要求的格式输出，跳过：" << m_url << format;
+        m_decoder->stop();
+        m_sourceDone = true;
+        return;
+    }
+
+    int frames = buffer.frameCount();
+    if (format.channelCount() != m_channels)
+    {
+        // 单声道复制到每个声道
+        if (m_upmix.size() < frames * m_channels)
+        {
+            m_upmix.resize(frames * m_channels);
+        }
+        float * out = m_upmix.data();
+        for (int i = 0; i < frames; i++)
+        {
+            for (int c = 0; c < m_channels; c++) { out[i * m_channels + c] = samples[i]; }
+        }
+        samples = out;
+    }
+
+    // 跳转：按解码出来的帧数丢弃目标位置之前的数据
+    if (m_skipFrames > 0)
+    {
+        if (m_skipFrames >= frames)
+        {
+            m_skipFrames -= frames;
+            return;
+        }
+        samples += m_skipFrames * m_channels;
+        frames -= (int)m_skipFrames;
+        m_skipFrames = 0;
+    }
+
+    append(samples, frames);
+}
+
+void PcmDecoder::append(const float * samples, int frames)
+{
+    if (m_fadeAt >= 0)
+    {
+        const int n = qMin(frames, m_fadeLength - m_fadeDone);
+        AudioMix::crossfade(m_pending.data() + m_fadeAt, samples, n, m_channels, m_fadeDone, m_fadeLength);
+        m_fadeAt += n * m_channels;
+        m_fadeDone += n;
+        samples += n * m_channels;
+        frames -= n;
+        if (m_fadeDone >= m_fadeLength)
+        {
+            m_fadeAt = -1;
+        }
+    }
+
+    if (frames > 0)
+    {
+        const int old = m_pending.size();
+        m_pending.resize(old + frames * m_channels);
+        memcpy(m_pending.data() + old, samples, sizeof(float) * frames * m_channels);
+    }
+}
+
+//新的一首比淡化时间还短，剩下的尾巴按淡出曲线降到0，不会在下一首结束时突然断掉
+void PcmDecoder::fadeOutRest()
+{
+    if (m_fadeAt < 0) { return; }
+
+    const float gain = std::cos(float(m_fadeDone) / m_fadeLength * kHalfPi);
+    AudioMix::ramp(m_pending.data() + m_fadeAt, m_fadeLength - m_fadeDone, m_channels, gain, 0.0f);
+    m_fadeAt = -1;
+}
+
+//解码器的信号只处理当前解码器发出的，已经排队的旧解码器的信号在断开连接之后也可能送到
+void PcmDecoder::handle_decoder_durationChanged(qint64 duration)
+{
+    if (sender() != m_decoder) { return; }
+
+    if (duration > 0)
+    {
+        emit durationChanged(m_serial, duration);
+    }
+}
+
+void PcmDecoder::handle_decoder_finished()
+{
+    if (sender() != m_decoder) { return; }
+
+    m_sourceDone = true;
+    pump();
+}
+
+void PcmDecoder::handle_decoder_error(QAudioDecoder::Error error)
+{
+    if (sender() != m_decoder) { return; }
+
+    LOG_WARNING(Playback) << "解码失败：" << m_url << error << m_decoder->errorString();
+    m_sourceDone = true;
+    pump();
+}
@@ -0,0 +1,91 @@
+#ifndef PCMDECODER_H
+#define PCMDECODER_H
+
+#include <QObject>
+#include <QAudioDecoder>
+#include <QAudioFormat>
+#include <QUrl>
+#include <QVector>
+#include "pcmringbuffer.h"
+#include "seekindex.h"
+
+class QIODevice;
+class QTimer;
+
+/*音频引擎的解码端，和LoudnessAnalyzer一样是一个移到单独QThread中的对象
+ *  用QAudioDecoder把歌曲解码成输出设备的采样率和声道数，转换成float后写入环形缓冲区
+ *  背压：解码出来还没写进环形缓冲区的数据放在m_pending中，积压超过上限时不再从解码器取数据，
+ *      解码器自己也就停下来；定时器和bufferReady信号都会调用pump继续搬运
+ *  每首歌由引擎分配一个序号，解码端发出的信号都带上序号，引擎据此丢弃跳转和切歌之前的过期信号
+ *      每次load都换一个新的QAudioDecoder，上一个解码器迟到的finished/error不会把新歌曲当成已经解码完
+ *  load的两种方式：
+ *      flush       立即换歌或跳转：丢弃积压的数据，让输出端跳过环形缓冲区中已有的帧
+ *      接在后面     当前歌曲解码完成（trackDecoded）后，引擎把下一首接在后面，无缝播放
+ *  交叉淡化：每首歌最后crossfade毫秒的数据一直留在m_pending中不写出，
+ *      接上下一首时，下一首开头的数据和这段尾巴等功率混合后再写出；没有下一首时finish把尾巴原样写出
+ *  跳转：QAudioDecoder不能跳转，有跳转索引时按索引找到目标位置之前最近的帧，把文件从这一帧开始的部分交给解码器，
+ *      只需丢弃不到一项索引间隔的数据，耗时和跳转的位置、文件长度无关；没有索引时从头解码并丢弃目标位置之前的数据
+ *      需要偏移表的索引在这首歌第一次跳转时读取或建立偏移表（见SeekTableCache），只保留当前歌曲的一份
+ */
+class PcmDecoder : public QObject
+{
+    Q_OBJECT
+public:
+    PcmDecoder(PcmRingBuffer * ring, const QAudioFormat & format, QObject *parent = nullptr);
+    ~PcmDecoder();
+
+signals:
+    void trackStarted(quint64 serial, quint64 firstFrame, qint64 startMs);  //这首歌的第一帧在环形缓冲区中的编号
+    void durationChanged(quint64 serial, qint64 duration);
+    void trackDecoded(quint64 serial);                  //这首歌解码完成，引擎决定接下一首还是结束
+    void streamEnded(quint64 serial, quint64 endFrame); //没有下一首，所有数据都已写进环形缓冲区
+
+public slots:
+    void setCrossfade(int ms);
+    void load(quint64 serial, const QUrl & url, qint64 startMs, bool flush, const SeekIndex & index);
+    void finish(quint64 serial);    //没有下一首了，写出留着的尾巴
+    void halt();                    //停止解码，丢弃所有数据
+
+private slots:
+    void pump();
+    void handle_decoder_durationChanged(qint64 duration);
+    void handle_decoder_finished();
+    void handle_decoder_error(QAudioDecoder::Error error);
+
+private:
+    void consume(const QAudioBuffer & buffer);
+    void writeOut();
+    void append(const float * samples, int frames);
+    void fadeOutRest();
+    int writeLimit() const;
+    void compact();
+
+    PcmRingBuffer * m_ring;
+    QAudioFormat m_format;          //解码器输出的格式：输出设备的采样率和声道数，16位整数
+    int m_channels;
+    int m_holdbackFrames;           //交叉淡化的帧数，0表示无缝衔接
+    int m_maxBacklog;               //m_pending中最多积压的采样数
+
+    QAudioDecoder * m_decoder;      //当前歌曲的解码器，每次load时在解码线程中重新创建
+    QIODevice * m_source;           //从跳转位置开始的文件片段，从头解码时为nullptr
+    QTimer * m_timer;
+    quint64 m_serial;               //正在解码的歌曲序号
+    QUrl m_url;
+    QUrl m_tableUrl;                //m_tableIndex属于哪首歌
+    SeekIndex m_tableIndex;         //这首歌带偏移表的跳转索引，第一次跳转时建立
+    qint64 m_skipFrames;            //跳转时还要丢弃的帧数
+    bool m_sourceDone;              //解码器已经结束（完成或者出错）
+    bool m_trackDone;               //已经发出trackDecoded
+    bool m_finishing;               //finish之后，尾巴也要写出
+    bool m_streamEnded;             //已经发出streamEnded
+
+    QVector<float> m_pending;       //解码出来还没写进环形缓冲区的采样
+    int m_pendingPos;               //m_pending中已经写出的采样数
+    int m_fadeAt;                   //交叉淡化时下一帧要混入的位置（采样下标），不在淡化时为-1
+    int m_fadeDone;                 //已经混合的帧数
+    int m_fadeLength;               //整个淡化过程的帧数
+    QVector<float> m_scratch;       //解码缓冲区转换成float用的缓冲区，复用
+    QVector<float> m_upmix;         //单声道复制成双声道用的缓冲区，复用
+};
+
+#endif // PCMDECODER_H
@@ -0,0 +1,223 @@
+#include "pcmoutput.h"
+#include "audiomix.h"
+#include "log.h"
+#include "playbackengine.h"
+#include <QAudioOutput>
+#include <QIODevice>
+#include <QTimer>
+#include <cstring>
+
+//设备缓冲区的长度，也就是输出延迟的上限
+static const int kBufferMs = 60;
+
+//开始播放、跳转和欠载之后，至少攒够这么多数据再开始读
+static const int kPrerollMs = 100;
+
+//音量变化和暂停、恢复时的渐变时长
+static const int kRampMs = 20;
+
+//测量播放位置和延迟的间隔
+static const int kMeasureIntervalMs = 10;
+
+//QAudioOutput拉取数据的设备，读取直接交给PcmOutput::render
+class PcmOutputDevice : public QIODevice
+{
+public:
+    explicit PcmOutputDevice(PcmOutput * output) : QIODevice(output), m_output(output) {}
+
+    bool isSequential() const override { return true; }
+
+    //缓冲区读空时补静音，任何时候都能读出数据
+    qint64 bytesAvailable() const override { return 1 << 20; }
+
+protected:
+    qint64 readData(char * data, qint64 maxSize) override { return m_output->render(data, maxSize); }
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    PcmOutput * m_output;
+};
+
+PcmOutput::PcmOutput(PcmRingBuffer * ring, const QAudioDeviceInfo & device, const QAudioFormat & format, QObject *parent)
+    : QObject(parent)
+    , m_ring(ring)
+    , m_deviceInfo(device)
+    , m_format(format)
+    , m_channels(format.channelCount())
+    , m_bytesPerFrame(format.bytesPerFrame())
+    , m_prerollFrames(format.sampleRate() * kPrerollMs / 1000)
+    , m_rampStep(1.0f / (format.sampleRate() * kRampMs / 1000))
+    , m_output(nullptr)
+    , m_device(nullptr)
+    , m_timer(nullptr)
+    , m_pausePending(false)
+    , m_silenced(false)
+    , m_reportedUnderruns(0)
+    , m_gain(0.0f)
+    , m_primed(false)
+    , m_userGain(1.0f)
+    , m_reprime(false)
+    , m_draining(false)
+    , m_playedFrame(0)
+    , m_latencyFrames(0)
+    , m_underruns(0)
+    , m_tap(nullptr)
+{
+
+}
+
+PcmOutput::~PcmOutput()
+{
+    if (m_output)
+    {
+        m_output->stop();
+    }
+}
+
+void PcmOutput::reprime()
+{
+    m_draining.store(false);
+    m_reprime.store(true);
+}
+
+void PcmOutput::setDraining(bool draining)
+{
+    m_draining.store(draining);
+}
+
+void PcmOutput::start()
+{
+    m_pausePending = false;
+    m_silenced = false;
+
+    //设备和定时器在输出线程中第一次使用时创建，拉取数据的回调也就在这个线程中
+    if (!m_output)
+    {
+        m_output = new QAudioOutput(m_deviceInfo, m_format, this);
+        m_output->setBufferSize(m_bytesPerFrame * (m_format.sampleRate() * kBufferMs / 1000));
+        m_device = new PcmOutputDevice(this);
+        m_device->open(QIODevice::ReadOnly);
+
+        m_timer = new QTimer(this);
+        m_timer->setTimerType(Qt::PreciseTimer);
+        connect(m_timer, &QTimer::timeout, this, &PcmOutput::handle_timer_timeout);
+        m_timer->start(kMeasureIntervalMs);
+
+        m_output->start(m_device);
+        LOG_INFO(Playback) << "音频输出：" << m_deviceInfo.deviceName() << m_format.sampleRate() << "Hz"
+                           << m_channels << "声道，设备缓冲区" << m_output->bufferSize() << "字节，混音实现：" << AudioMix::implementation();
+        return;
+    }
+
+    if (m_output->state() == QAudio::SuspendedState)
+    {
+        m_output->resume();
+    }
+    else if (m_output->state() == QAudio::StoppedState)
+    {
+        m_output->start(m_device);
+    }
+}
+
+void PcmOutput::pause()
+{
+    m_silenced = true;
+    m_pausePending = true;
+}
+
+void PcmOutput::stop()
+{
+    m_pausePending = false;
+    m_silenced = true;
+    if (m_output && m_output->state() != QAudio::StoppedState)
+    {
+        m_output->suspend();
+    }
+    m_gain = 0.0f;
+}
+
+void PcmOutput::handle_timer_timeout()
+{
+    if (!m_output) { return; }
+
+    const int buffered = qMax(0, (m_output->bufferSize() - m_output->bytesFree()) / m_bytesPerFrame);
+    const quint64 read = m_ring->readPosition();
+    m_latencyFrames.store(buffered, std::memory_order_relaxed);
+    m_playedFrame.store(read > (quint64)buffered ? read - buffered : 0, std::memory_order_release);
+
+    const quint64 underruns = m_underruns.load(std::memory_order_relaxed);
+    if (underruns != m_reportedUnderruns)
+    {
+        LOG_WARNING(Playback) << "音频输出欠载，累计" << underruns << "次，输出延迟" << buffered * 1000 / m_format.sampleRate() << "毫秒";
+        m_reportedUnderruns = underruns;
+    }
+
+    //淡出完成后才挂起，挂起时设备缓冲区中剩下的只有静音
+    if (m_pausePending && m_gain == 0.0f)
+    {
+        m_pausePending = false;
+        m_output->suspend();
+    }
+}
+
+/*
+ * 音频回调
+ *  读出的帧不够时补静音，预缓冲期间整段都是静音
+ *  增益从当前值向目标值渐变，这一次回调走不完的留到下一次
+ */
+qint64 PcmOutput::render(char * data, qint64 maxBytes)
+{
+    const int frames = (int)(maxBytes / m_bytesPerFrame);
+    if (frames <= 0) { return 0; }
+
+    const int samples = frames * m_channels;
+    if (m_scratch.size() < samples)
+    {
+        m_scratch.resize(samples);
+    }
+    float * buffer = m_scratch.data();
+
+    if (m_reprime.exchange(false))
+    {
+        m_primed = false;
+    }
+    const bool draining = m_draining.load();
+    if (!m_primed && (draining || m_ring->readable() >= qMin(m_prerollFrames, m_ring->capacity() / 2)))
+    {
+        m_primed = true;
+    }
+
+    int n = 0;
+    if (m_primed)
+    {
+        n = m_ring->read(buffer, frames);
+        if (n < frames && !draining)
+        {
+            m_underruns.fetch_add(1, std::memory_order_relaxed);
+            m_primed = false;
+        }
+    }
+    memset(buffer + n * m_channels, 0, sizeof(float) * (samples - n * m_channels));
+
+    AudioTap * tap = m_tap.load(std::memory_order_relaxed);
+    if (tap && n > 0)
+    {
+        tap->feed(buffer, n, m_channels, m_format.sampleRate());
+    }
+
+    const float target = m_silenced ? 0.0f : m_userGain.load(std::memory_order_relaxed);
+    const float maxChange = m_rampStep * frames;
+    const float next = target > m_gain ? qMin(target, m_gain + maxChange) : qMax(target, m_gain - maxChange);
+    AudioMix::ramp(buffer, frames, m_channels, m_gain, next);
+    m_gain = next;
+
+    if (m_format.sampleType() == QAudioFormat::Float)
+    {
+        memcpy(data, buffer, sizeof(float) * samples);
+    }
+    else
+    {
+        AudioMix::toInt16(buffer, reinterpret_cast<qint16 *>(data), samples);
+    }
+    return (qint64)frames * m_bytesPerFrame;
+}
@@ -0,0 +1,85 @@
+#ifndef PCMOUTPUT_H
+#define PCMOUTPUT_H
+
+#include <QObject>
+#include <QAudioDeviceInfo>
+#include <QAudioFormat>
+#include <QVector>
+#include <atomic>
+#include "pcmringbuffer.h"
+
+class AudioTap;
+class QAudioOutput;
+class QTimer;
+class PcmOutputDevice;
+
+/*音频引擎的输出端，移到单独的最高优先级线程中，不受界面线程卡顿的影响
+ *  QAudioOutput以拉模式工作，音频回调从环形缓冲区读取PCM，乘上音量增益后按输出格式写给设备
+ *      回调中只做复制、增益和格式转换，不加锁、不分配内存（缓冲区只在第一次或者变大时分配）
+ *  音量和暂停用渐变，增益每次最多变化到kRampMs毫秒才能走完全程的程度，避免爆音
+ *      暂停时先淡出到0再挂起设备，恢复时从0淡入
+ *      音量（含回放增益）和暂停分开保存：setGain只改音量，暂停和停止只在输出线程中标记静音，
+ *      回调的目标增益是两者合起来的结果，任意线程调节音量都不会打断淡出，恢复时也一定回到当前音量
+ *  预缓冲：开始播放、跳转和欠载之后，缓冲区攒够kPrerollMs毫秒再开始读，期间输出静音
+ *  欠载：预缓冲完成后缓冲区里的数据不够一次回调，而且还没到流的末尾，计一次欠载并重新预缓冲
+ *  播放位置和输出延迟由定时器测量：
+ *      延迟 = 设备缓冲区中还没播放的帧数，播放到的帧 = 从环形缓冲区读走的帧数 - 延迟
+ *      结果放在原子变量中，引擎在主线程读取
+ */
+class PcmOutput : public QObject
+{
+    Q_OBJECT
+public:
+    PcmOutput(PcmRingBuffer * ring, const QAudioDeviceInfo & device, const QAudioFormat & format, QObject *parent = nullptr);
+    ~PcmOutput();
+
+    //以下函数可以在任意线程调用
+    quint64 playedFrame() const { return m_playedFrame.load(std::memory_order_acquire); }
+    int latencyFrames() const { return m_latencyFrames.load(std::memory_order_relaxed); }
+    quint64 underruns() const { return m_underruns.load(std::memory_order_relaxed); }
+    void setGain(float gain) { m_userGain.store(gain, std::memory_order_relaxed); }    //音量和回放增益
+    void reprime();                     //跳转或切歌后重新预缓冲
+    void setDraining(bool draining);    //流已经结束，缓冲区读空不算欠载
+
+public slots:
+    void start();       //开始或者恢复输出
+    void pause();       //淡出后挂起设备
+    void stop();        //立即挂起设备，增益归零
+    //音频回调把乘上增益之前的PCM交给它；在输出线程中调用，和音频回调不会同时进行，返回后旧的旁路不再被使用
+    void setTap(AudioTap * tap) { m_tap.store(tap); }
+
+private slots:
+    void handle_timer_timeout();
+
+private:
+    friend class PcmOutputDevice;
+    qint64 render(char * data, qint64 maxBytes);    //音频回调，在输出线程中调用
+
+    PcmRingBuffer * m_ring;
+    QAudioDeviceInfo m_deviceInfo;
+    QAudioFormat m_format;
+    int m_channels;
+    int m_bytesPerFrame;
+    int m_prerollFrames;
+    float m_rampStep;                   //每帧增益最多变化多少
+
+    QAudioOutput * m_output;            //在输出线程中第一次start时创建
+    PcmOutputDevice * m_device;
+    QTimer * m_timer;
+    bool m_pausePending;                //等淡出完成后挂起
+    bool m_silenced;                    //暂停或停止，目标增益为0；和回调在同一个线程，不需要原子变量
+    quint64 m_reportedUnderruns;        //已经写过日志的欠载次数
+
+    QVector<float> m_scratch;           //回调中读出和处理采样的缓冲区，复用
+    float m_gain;                       //回调中当前的增益
+    bool m_primed;
+    std::atomic<float> m_userGain;      //音量，不在静音时就是回调的目标增益
+    std::atomic<bool> m_reprime;
+    std::atomic<bool> m_draining;
+    std::atomic<quint64> m_playedFrame;
+    std::atomic<int> m_latencyFrames;
+    std::atomic<quint64> m_underruns;
+    std::atomic<AudioTap *> m_tap;
+};
+
+#endif // PCMOUTPUT_H
@@ -0,0 +1,108 @@
+#include "playbackengine.h"
+#include "nativeaudioengine.h"
+#include "loudnessanalyzer.h"
+#include "log.h"
+
+PlaybackEngine * PlaybackEngine::create(QObject *parent)
+{
+    if (qgetenv("LOOPY_ENGINE").toLower() == "native")
+    {
+        NativeAudioEngine * engine = NativeAudioEngine::create(parent);
+        if (engine)
+        {
+            bool ok = false;
+            int crossfade = qEnvironmentVariableIntValue("LOOPY_CROSSFADE", &ok);
+            engine->setCrossfade(ok ? crossfade : 0);
+            return engine;
+        }
+        LOG_WARNING(Playback) << "没有可用的音频输出设备或格式，改用QMediaPlayer";
+    }
+
+    return new MediaPlayerEngine(parent);
+}
+
+MediaPlayerEngine::MediaPlayerEngine(QObject *parent)
+    : PlaybackEngine(parent)
+    , m_player(new QMediaPlayer(this))
+    , m_probe(nullptr)
+    , m_tap(nullptr)
+{
+    connect(m_player, &QMediaPlayer::stateChanged, this, &PlaybackEngine::stateChanged);
+    connect(m_player, &QMediaPlayer::positionChanged, this, &PlaybackEngine::positionChanged);
+    connect(m_player, &QMediaPlayer::durationChanged, this, &PlaybackEngine::durationChanged);
+    connect(m_player, &QMediaPlayer::currentMediaChanged, this, &PlaybackEngine::currentMediaChanged);
+}
+
+void MediaPlayerEngine::setPlaylist(QMediaPlaylist * playlist)
+{
+    m_player->setPlaylist(playlist);
+}
+
+QMediaPlayer::State MediaPlayerEngine::state() const
+{
+    return m_player->state();
+}
+
+qint64 MediaPlayerEngine::position() const
+{
+    return m_player->position();
+}
+
+qint64 MediaPlayerEngine::duration() const
+{
+    return m_player->duration();
+}
+
+int MediaPlayerEngine::volume() const
+{
+    return m_player->volume();
+}
+
+void MediaPlayerEngine::setAudioTap(AudioTap * tap)
+{
+    m_tap = tap;
+    if (!m_tap || m_probe) { return; }
+
+    m_probe = new QAudioProbe(this);
+    connect(m_probe, &QAudioProbe::audioBufferProbed, this, &MediaPlayerEngine::handle_probe_audioBufferProbed);
+    if (!m_probe->setSource(m_player))
+    {
+        LOG_WARNING(Playback) << "当前的多媒体后端不支持QAudioProbe，没有音频旁路数据";
+    }
+}
+
+void MediaPlayerEngine::handle_probe_audioBufferProbed(const QAudioBuffer & buffer)
+{
+    if (!m_tap || !buffer.isValid()) { return; }
+
+    const float * samples = LoudnessAnalyzer::toFloat(buffer, m_tapSamples);
+    if (samples)
+    {
+        m_tap->feed(samples, buffer.frameCount(), buffer.format().channelCount(), buffer.format().sampleRate());
+    }
+}
+
+void MediaPlayerEngine::play()
+{
+    m_player->play();
+}
+
+void MediaPlayerEngine::pause()
+{
+    m_player->pause();
+}
+
+void MediaPlayerEngine::stop()
+{
+    m_player->stop();
+}
+
+void MediaPlayerEngine::setPosition(qint64 position)
+{
+    m_player->setPosition(position);
+}
+
+void MediaPlayerEngine::setVolume(int volume)
+{
+    m_player->setVolume(volume);
+}
@@ -0,0 +1,90 @@
+#ifndef PLAYBACKENGINE_H
+#define PLAYBACKENGINE_H
+
+#include <QObject>
+#include <QAudioBuffer>
+#include <QAudioProbe>
+#include <QMediaContent>
+#include <QMediaPlayer>
+#include <QMediaPlaylist>
+#include <QVector>
+
+/*音频旁路接口，播放引擎把正在播放的PCM交给它（比如频谱分析）
+ *  feed在播放引擎的某个固定线程中调用（QAudioProbe是主线程，自己的音频引擎是输出线程），
+ *      实现不能阻塞、不能分配内存，来不及处理时直接丢弃
+ */
+class AudioTap
+{
+public:
+    virtual ~AudioTap() {}
+    virtual void feed(const float * samples, int frames, int channels, int sampleRate) = 0;    //交错存储的float采样
+};
+
+/*播放引擎接口，界面只通过它控制播放，不关心背后是QMediaPlayer还是自己的音频引擎
+ *  播放、暂停、停止、跳转、音量和QMediaPlayer的同名函数含义相同，状态也沿用QMediaPlayer::State
+ *  切歌由QMediaPlaylist决定：引擎跟随播放列表的当前歌曲，自己播放到下一首时再更新播放列表的当前下标
+ *  create按环境变量LOOPY_ENGINE选择实现：
+ *      native      NativeAudioEngine，自己解码和输出，支持无缝播放和交叉淡化（LOOPY_CROSSFADE，毫秒）
+ *      其他或未设置  MediaPlayerEngine，交给QMediaPlayer
+ */
+class PlaybackEngine : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PlaybackEngine(QObject *parent = nullptr) : QObject(parent) {}
+
+    virtual void setPlaylist(QMediaPlaylist * playlist) = 0;
+    virtual QMediaPlayer::State state() const = 0;
+    virtual qint64 position() const = 0;    //当前歌曲的播放位置（毫秒）
+    virtual qint64 duration() const = 0;    //当前歌曲的时长（毫秒），还不知道时为0
+    virtual int volume() const = 0;         //0~100
+    virtual void setAudioTap(AudioTap * tap) = 0;   //设置音频旁路，nullptr取消；tap的生命周期要比引擎长
+
+    static PlaybackEngine * create(QObject *parent = nullptr);
+
+public slots:
+    virtual void play() = 0;
+    virtual void pause() = 0;
+    virtual void stop() = 0;
+    virtual void setPosition(qint64 position) = 0;
+    virtual void setVolume(int volume) = 0;
+
+signals:
+    void stateChanged(QMediaPlayer::State state);
+    void positionChanged(qint64 position);
+    void durationChanged(qint64 duration);
+    void currentMediaChanged(const QMediaContent & media);
+};
+
+//默认实现，直接转发给QMediaPlayer
+class MediaPlayerEngine : public PlaybackEngine
+{
+    Q_OBJECT
+public:
+    explicit MediaPlayerEngine(QObject *parent = nullptr);
+
+    void setPlaylist(QMediaPlaylist * playlist) override;
+    QMediaPlayer::State state() const override;
+    qint64 position() const override;
+    qint64 duration() const override;
+    int volume() const override;
+    void setAudioTap(AudioTap * tap) override;     //通过QAudioProbe取得解码后的PCM，后端不支持时没有数据
+
+public slots:
+    void play() override;
+    void pause() override;
+    void stop() override;
+    void setPosition(qint64 position) override;
+    void setVolume(int volume) override;
+
+private slots:
+    void handle_probe_audioBufferProbed(const QAudioBuffer & buffer);
+
+private:
+    QMediaPlayer * m_player;
+    QAudioProbe * m_probe;          //第一次设置音频旁路时创建
+    AudioTap * m_tap;
+    QVector<float> m_tapSamples;    //整数格式转换用的缓冲区，复用
+};
+
+#endif // PLAYBACKENGINE_H
@@ -0,0 +1,188 @@
+#include "songfiltermodel.h"
+#include <algorithm>
+
+SongFilterModel::SongFilterModel(QObject *parent)
+    : QAbstractProxyModel(parent)
+    , m_filtered(false)
+    , m_removeFirst(0)
+    , m_removeLast(-1)
+{
+}
+
+void SongFilterModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    beginResetModel();
+
+    if (this->sourceModel())
+    {
+        disconnect(this->sourceModel(), nullptr, this, nullptr);
+    }
+    QAbstractProxyModel::setSourceModel(sourceModel);
+    m_filtered = false;
+    m_rows.clear();
+
+    if (sourceModel)
+    {
+        connect(sourceModel, &QAbstractItemModel::rowsAboutToBeInserted, this, &SongFilterModel::handle_source_rowsAboutToBeInserted);
+        connect(sourceModel, &QAbstractItemModel::rowsInserted, this, &SongFilterModel::handle_source_rowsInserted);
+        connect(sourceModel, &QAbstractItemModel::rowsAboutToBeRemoved, this, &SongFilterModel::handle_source_rowsAboutToBeRemoved);
+        connect(sourceModel, &QAbstractItemModel::rowsRemoved, this, &SongFilterModel::handle_source_rowsRemoved);
+        connect(sourceModel, &QAbstractItemModel::dataChanged, this, &SongFilterModel::handle_source_dataChanged);
+        connect(sourceModel, &QAbstractItemModel::modelAboutToBeReset, this, &SongFilterModel::handle_source_modelAboutToBeReset);
+        connect(sourceModel, &QAbstractItemModel::modelReset, this, &SongFilterModel::handle_source_modelReset);
+    }
+
+    endResetModel();
+}
+
+void SongFilterModel::setFilter(const QVector<int> & rows)
+{
+    beginResetModel();
+    m_filtered = true;
+    m_rows = rows;
+    endResetModel();
+}
+
+void SongFilterModel::clearFilter()
+{
+    if (!m_filtered) { return; }
+
+    beginResetModel();
+    m_filtered = false;
+    m_rows.clear();
+    m_rows.squeeze();
+    endResetModel();
+}
+
+QModelIndex SongFilterModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || column != 0 || row < 0 || row >= rowCount()) { return QModelIndex(); }
+    return createIndex(row, column);
+}
+
+QModelIndex SongFilterModel::parent(const QModelIndex &child) const
+{
+    Q_UNUSED(child);
+    return QModelIndex();
+}
+
+int SongFilterModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || !sourceModel()) { return 0; }
+    return m_filtered ? m_rows.size() : sourceModel()->rowCount();
+}
+
+int SongFilterModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 1;
+}
+
+QModelIndex SongFilterModel::mapToSource(const QModelIndex &proxyIndex) const
+{
+    if (!proxyIndex.isValid() || !sourceModel()) { return QModelIndex(); }
+    return sourceModel()->index(m_filtered ? m_rows[proxyIndex.row()] : proxyIndex.row(), 0);
+}
+
+QModelIndex SongFilterModel::mapFromSource(const QModelIndex &sourceIndex) const
+{
+    if (!sourceIndex.isValid()) { return QModelIndex(); }
+    if (!m_filtered) { return createIndex(sourceIndex.row(), 0); }
+
+    int row = lowerBound(sourceIndex.row());
+    if (row >= m_rows.size() || m_rows[row] != sourceIndex.row()) { return QModelIndex(); }
+    return createIndex(row, 0);
+}
+
+int SongFilterModel::lowerBound(int sourceRow) const
+{
+    return (int)(std::lower_bound(m_rows.constBegin(), m_rows.constEnd(), sourceRow) - m_rows.constBegin());
+}
+
+//过滤时新插入的行不在结果中，代理的行不变，插入完成后再把后面的源行号后移
+void SongFilterModel::handle_source_rowsAboutToBeInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid() || m_filtered) { return; }
+    beginInsertRows(QModelIndex(), first, last);
+}
+
+void SongFilterModel::handle_source_rowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) { return; }
+    if (!m_filtered)
+    {
+        endInsertRows();
+        return;
+    }
+
+    int count = last - first + 1;
+    for (int i = lowerBound(first); i < m_rows.size(); i++)
+    {
+        m_rows[i] += count;
+    }
+}
+
+//过滤时被删除的源行在m_rows中是连续的一段，对应代理中连续的行
+void SongFilterModel::handle_source_rowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) { return; }
+
+    m_removeFirst = m_filtered ? lowerBound(first) : first;
+    m_removeLast = m_filtered ? lowerBound(last + 1) - 1 : last;
+    if (m_removeFirst <= m_removeLast)
+    {
+        beginRemoveRows(QModelIndex(), m_removeFirst, m_removeLast);
+    }
+}
+
+void SongFilterModel::handle_source_rowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) { return; }
+
+    int count = last - first + 1;
+    if (m_filtered)
+    {
+        if (m_removeFirst <= m_removeLast)
+        {
+            m_rows.erase(m_rows.begin() + m_removeFirst, m_rows.begin() + m_removeLast + 1);
+        }
+        for (int i = m_removeFirst; i < m_rows.size(); i++)
+        {
+            m_rows[i] -= count;
+        }
+    }
+
+    if (m_removeFirst <= m_removeLast)
+    {
+        endRemoveRows();
+    }
+    m_removeFirst = 0;
+    m_removeLast = -1;
+}
+
+void SongFilterModel::handle_source_dataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+{
+    int first = topLeft.row();
+    int last = bottomRight.row();
+    if (m_filtered)
+    {
+        first = lowerBound(first);
+        last = lowerBound(last + 1) - 1;
+    }
+    if (first <= last)
+    {
+        emit dataChanged(index(first, 0), index(last, 0), roles);
+    }
+}
+
+void SongFilterModel::handle_source_modelAboutToBeReset()
+{
+    beginResetModel();
+}
+
+//源模型重置后原来的行号没有意义了，恢复为显示全部行
+void SongFilterModel::handle_source_modelReset()
+{
+    m_filtered = false;
+    m_rows.clear();
+    endResetModel();
+}
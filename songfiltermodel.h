@@ -0,0 +1,52 @@
+#ifndef SONGFILTERMODEL_H
+#define SONGFILTERMODEL_H
+
+#include <QAbstractProxyModel>
+#include <QVector>
+
+/*歌曲列表的过滤代理模型，显示搜索结果
+ *  没有设置过滤时原样透传歌曲列表模型的所有行
+ *  设置过滤时只显示给定的行：m_rows按升序保存源模型的行号，第i行对应m_rows[i]
+ *      不用QSortFilterProxyModel逐行调用filterAcceptsRow，设置结果的开销只和结果数有关
+ *      源行号到代理行号用二分查找
+ *  源模型插入、删除行时同步调整m_rows，新插入的行不在当前结果中，由调用者重新搜索后再设置
+ */
+class SongFilterModel : public QAbstractProxyModel
+{
+    Q_OBJECT
+public:
+    explicit SongFilterModel(QObject *parent = nullptr);
+
+    void setSourceModel(QAbstractItemModel *sourceModel) override;
+
+    void setFilter(const QVector<int> & rows);     //只显示源模型的这些行，rows按升序排列
+    void clearFilter();                            //显示全部行
+    bool isFiltered() const { return m_filtered; }
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const override;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override;
+
+private slots:
+    void handle_source_rowsAboutToBeInserted(const QModelIndex &parent, int first, int last);
+    void handle_source_rowsInserted(const QModelIndex &parent, int first, int last);
+    void handle_source_rowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void handle_source_rowsRemoved(const QModelIndex &parent, int first, int last);
+    void handle_source_dataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+    void handle_source_modelAboutToBeReset();
+    void handle_source_modelReset();
+
+private:
+    int lowerBound(int sourceRow) const;    //第一个源行号 >= sourceRow 的代理行
+
+private:
+    bool m_filtered;
+    QVector<int> m_rows;        //过滤时显示的源行号，升序
+    int m_removeFirst;          //正在删除的代理行区间，rowsAboutToBeRemoved中记录
+    int m_removeLast;
+};
+
+#endif // SONGFILTERMODEL_H
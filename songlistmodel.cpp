@@ -0,0 +1,144 @@
+#include "songlistmodel.h"
+#include <QSet>
+#include "log.h"
+#include <algorithm>
+#include <functional>
+
+SongListModel::SongListModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_duplicatePolicy(KeepDuplicates)
+{
+
+}
+
+int SongListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) { return 0; }
+    return SongManager::getInstance().size();
+}
+
+QVariant SongListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= SongManager::getInstance().size()) { return QVariant(); }
+
+    if (role == Qt::DisplayRole)
+    {
+        return SongManager::getInstance().name(index.row());
+    }
+    if (role == Qt::ToolTipRole)
+    {
+        SongManager & songs = SongManager::getInstance();
+        QString tip = QString("%1 - %2").arg(songs.artist(index.row()), songs.album(index.row()));
+
+        int copies = songs.contentHash(index.row()) != 0 ? songs.duplicates(index.row()).size() : 1;
+        if (copies > 1)
+        {
+            tip += QString("（共%1个副本）").arg(copies);
+        }
+        return tip;
+    }
+
+    return QVariant();
+}
+
+/*
+ * 添加一批歌曲
+ *  先区分新歌和已有的歌：新歌追加到末尾，一次beginInsertRows/endInsertRows通知视图
+ *  已有的歌就地更新，最后对更新过的行发出dataChanged
+ *  SkipDuplicates时，和已有的歌或者同一批中前面的新歌内容哈希相同的新歌直接丢弃
+ */
+QList<QUrl> SongListModel::addSongs(const QVector<Song*> & songs)
+{
+    SongManager & manager = SongManager::getInstance();
+
+    QVector<Song*> added;
+    QSet<QUrl> addedUrls;   //同一批中重复的歌曲只保留第一首
+    QSet<quint64> addedHashes;
+    QList<QUrl> urls;
+    int firstChanged = -1;
+    int lastChanged = -1;
+
+    for (Song * song : songs)
+    {
+        SongId id = manager.find(song->url());
+        if (id < 0)
+        {
+            if (addedUrls.contains(song->url()))
+            {
+                delete song;
+                continue;
+            }
+            if (m_duplicatePolicy == SkipDuplicates && song->contentHash() != 0
+                    && (manager.findContent(song->contentHash()) >= 0 || addedHashes.contains(song->contentHash())))
+            {
+                LOG_DEBUG(Import) << "内容重复的歌曲，不重复添加：" << song->url();
+                delete song;
+                continue;
+            }
+            addedUrls.insert(song->url());
+            addedHashes.insert(song->contentHash());
+            added.append(song);
+            continue;
+        }
+
+        manager.addSong(song);
+        firstChanged = firstChanged < 0 ? id : qMin(firstChanged, id);
+        lastChanged = qMax(lastChanged, id);
+    }
+
+    if (!added.isEmpty())
+    {
+        int first = manager.size();
+        beginInsertRows(QModelIndex(), first, first + added.size() - 1);
+        for (Song * song : added)
+        {
+            urls.append(song->url());
+            manager.addSong(song);
+        }
+        endInsertRows();
+    }
+
+    if (firstChanged >= 0)
+    {
+        emit dataChanged(index(firstChanged), index(lastChanged));
+    }
+
+    return urls;
+}
+
+/*
+ * 删除一批歌曲
+ *  找出歌曲ID后从大到小排序，相邻的ID合并成一段，从后往前逐段删除
+ */
+QVector<QPair<int, int>> SongListModel::removeSongs(const QStringList & paths)
+{
+    SongManager & manager = SongManager::getInstance();
+
+    QVector<SongId> ids;
+    ids.reserve(paths.size());
+    for (const QString & path : paths)
+    {
+        SongId id = manager.find(QUrl(path));
+        if (id >= 0) { ids.append(id); }
+    }
+    std::sort(ids.begin(), ids.end(), std::greater<SongId>());
+
+    QVector<QPair<int, int>> ranges;
+    int i = 0;
+    while (i < ids.size())
+    {
+        int last = ids[i];
+        int first = last;
+        for (i++; i < ids.size() && ids[i] >= first - 1; i++)
+        {
+            first = ids[i];     //重复的ID（同一路径出现两次）也并入这一段
+        }
+
+        beginRemoveRows(QModelIndex(), first, last);
+        manager.removeSongs(first, last - first + 1);
+        endRemoveRows();
+        ranges.append(qMakePair(first, last - first + 1));
+    }
+
+    return ranges;
+}
@@ -0,0 +1,42 @@
+#ifndef SONGLISTMODEL_H
+#define SONGLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include "song.h"
+
+/*歌曲列表模型，取代QListWidget中每首歌一个QListWidgetItem
+ *  直接以SongManager的列数据作为数据源，第row行就是歌曲ID为row的歌，不复制任何数据
+ *  视图使用统一行高（setUniformItemSizes），只对可见的行取数据和布局
+ *  添加歌曲统一经过addSongs：一批新歌只调用一次beginInsertRows/endInsertRows
+ *  删除歌曲统一经过removeSongs：按连续的行分段删除，每段调用一次beginRemoveRows/endRemoveRows
+ *  重复歌曲（音频内容哈希相同、路径不同）的处理方式：
+ *      KeepDuplicates  照常加入，SongManager按内容哈希归为一组，提示信息中显示副本数
+ *      SkipDuplicates  丢弃新的副本，只保留最先加入的那首
+ */
+class SongListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum DuplicatePolicy { KeepDuplicates, SkipDuplicates };
+
+    explicit SongListModel(QObject *parent = nullptr);
+
+    void setDuplicatePolicy(DuplicatePolicy policy) { m_duplicatePolicy = policy; }
+    DuplicatePolicy duplicatePolicy() const { return m_duplicatePolicy; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    //把一批歌曲加入SongManager（接管歌曲对象），返回其中新增歌曲的路径，已有的歌曲只更新信息
+    QList<QUrl> addSongs(const QVector<Song*> & songs);
+
+    //从SongManager中删除这些路径的歌曲，返回删除的各段<起始行, 行数>，按起始行从后往前排列
+    //  调用者按返回的顺序删除播放列表中对应的项，前面的行号不受后面删除的影响
+    QVector<QPair<int, int>> removeSongs(const QStringList & paths);
+
+private:
+    DuplicatePolicy m_duplicatePolicy;
+};
+
+#endif // SONGLISTMODEL_H
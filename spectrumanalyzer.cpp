@@ -0,0 +1,135 @@
+#include "spectrumanalyzer.h"
+#include "log.h"
+#include <QTimer>
+#include <cstring>
+
+//分析的间隔，和界面的帧间隔一致
+static const int kFrameIntervalMs = 16;
+
+//输入环形缓冲区的帧数，分析线程被耽搁半秒也不丢数据
+static const int kInputFrames = 32768;
+
+//feed混成单声道时每次处理的帧数，用栈上的缓冲区
+static const int kFeedBlock = 256;
+
+//每帧衰减到上一帧的比例，大约半秒从满格落到底
+static const float kDecay = 0.85f;
+
+//低于这个值就当作0
+static const float kSilence = 0.002f;
+
+SpectrumAnalyzer::SpectrumAnalyzer(int fftSize, int bands, QObject *parent)
+    : QObject(parent)
+    , m_input(kInputFrames, 1)
+    , m_sampleRate(0)
+    , m_framePending(false)
+    , m_spectrum(fftSize, qMin(bands, (int)Frame::MaxBands))
+    , m_timer(nullptr)
+    , m_active(false)
+{
+    m_history.fill(0.0f, fftSize);
+    m_chunk.resize(m_input.capacity());
+    m_bands.fill(0.0f, m_spectrum.bands());
+    m_levels.fill(0.0f, m_spectrum.bands());
+
+    // 三个缓冲区都先清零，界面一开始取到的就是全0
+    Frame empty;
+    memset(empty.bands, 0, sizeof(empty.bands));
+    empty.count = m_spectrum.bands();
+    m_frames.fill(empty);
+}
+
+void SpectrumAnalyzer::feed(const float * samples, int frames, int channels, int sampleRate)
+{
+    if (channels <= 0) { return; }
+    m_sampleRate.store(sampleRate, std::memory_order_relaxed);
+
+    float mono[kFeedBlock];
+    const float scale = 1.0f / channels;
+    while (frames > 0)
+    {
+        const int n = qMin(frames, (int)kFeedBlock);
+        for (int i = 0; i < n; i++)
+        {
+            float sum = 0.0f;
+            for (int c = 0; c < channels; c++) { sum += samples[i * channels + c]; }
+            mono[i] = sum * scale;
+        }
+        if (m_input.write(mono, n) < n) { return; }    //分析线程跟不上，丢弃
+
+        samples += n * channels;
+        frames -= n;
+    }
+}
+
+void SpectrumAnalyzer::setActive(bool active)
+{
+    //定时器在分析线程中第一次使用时创建
+    if (!m_timer)
+    {
+        m_timer = new QTimer(this);
+        m_timer->setTimerType(Qt::PreciseTimer);
+        connect(m_timer, &QTimer::timeout, this, &SpectrumAnalyzer::handle_timer_timeout);
+        LOG_DEBUG(Playback) << "频谱分析：" << m_spectrum.fftSize() << "点FFT，" << m_spectrum.bands() << "个频带，FFT实现：" << RealFft::implementation();
+    }
+
+    m_active = active;
+    if (active && !m_timer->isActive())
+    {
+        // 丢掉暂停之前残留的采样，从现在的声音开始
+        m_input.read(m_chunk.data(), m_chunk.size());
+        m_timer->start(kFrameIntervalMs);
+    }
+}
+
+void SpectrumAnalyzer::handle_timer_timeout()
+{
+    const int n = m_input.read(m_chunk.data(), m_chunk.size());
+    const int size = m_history.size();
+    float * history = m_history.data();
+
+    if (n > 0)
+    {
+        // 新采样接在历史后面，只保留最近size个
+        if (n >= size)
+        {
+            memcpy(history, m_chunk.constData() + n - size, sizeof(float) * size);
+        }
+        else
+        {
+            memmove(history, history + n, sizeof(float) * (size - n));
+            memcpy(history + size - n, m_chunk.constData(), sizeof(float) * n);
+        }
+
+        m_spectrum.setSampleRate(m_sampleRate.load(std::memory_order_relaxed));
+        m_spectrum.process(history, m_bands.data());
+    }
+    else
+    {
+        m_bands.fill(0.0f);
+    }
+
+    bool silent = true;
+    Frame & frame = m_frames.back();
+    for (int b = 0; b < m_levels.size(); b++)
+    {
+        float level = qMax(m_bands[b], m_levels[b] * kDecay);
+        if (level < kSilence) { level = 0.0f; }
+        m_levels[b] = level;
+        frame.bands[b] = level;
+        silent = silent && level == 0.0f;
+    }
+    frame.count = m_levels.size();
+    m_frames.publish();
+    if (!m_framePending.exchange(true, std::memory_order_relaxed))
+    {
+        emit frameReady();
+    }
+
+    // 不在播放并且已经落到底，最后一帧全0已经发布，停下定时器
+    if (!m_active && silent)
+    {
+        m_history.fill(0.0f);
+        m_timer->stop();
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include <QObject>
+#include <QVector>
+#include <atomic>
+#include "pcmringbuffer.h"
+#include "playbackengine.h"
+#include "spectrum.h"
+#include "triplebuffer.h"
+
+class QTimer;
+
+/*实时频谱分析，给频谱条提供数据
+ *  和LoudnessAnalyzer一样是一个移到单独QThread中的对象；同时作为播放引擎的音频旁路（AudioTap）
+ *  播放引擎所在的线程调用feed：混成单声道写进无锁SPSC环形缓冲区，写不下就丢弃，不阻塞播放
+ *  分析线程按帧（约60fps）取出新的采样，接在最近fftSize个采样后面，做一次频谱分析（Spectrum）
+ *      各频带快起慢落：变大时直接跟上，变小时按比例衰减，看起来不闪烁
+ *      结果写进三缓冲，界面线程随时取最新的一帧，两边不加锁、不等待
+ *      发布新的一帧时发出frameReady，界面取走之前不再重复发，事件队列里最多一个
+ *  所有缓冲区在构造时分配，每帧的分析不分配内存
+ *  只在播放时运行定时器；停止后频带衰减到0，发布最后一帧全0后停下，不占CPU
+ */
+class SpectrumAnalyzer : public QObject, public AudioTap
+{
+    Q_OBJECT
+public:
+    struct Frame
+    {
+        enum { MaxBands = 128 };
+        float bands[MaxBands];
+        int count;
+    };
+
+    explicit SpectrumAnalyzer(int fftSize = 2048, int bands = 48, QObject *parent = nullptr);
+
+    void feed(const float * samples, int frames, int channels, int sampleRate) override;
+
+    //界面线程：有新的一帧时返回true，之后frame()是最新的一帧
+    bool update() { m_framePending.store(false, std::memory_order_relaxed); return m_frames.update(); }
+    const Frame & frame() const { return m_frames.front(); }
+
+signals:
+    void frameReady();              //有新的一帧，界面下一帧取
+
+public slots:
+    void setActive(bool active);    //开始播放时启动，暂停或停止后衰减到0再停下
+
+private slots:
+    void handle_timer_timeout();
+
+private:
+    PcmRingBuffer m_input;              //单声道采样，feed写，分析线程读
+    std::atomic<int> m_sampleRate;
+    Spectrum m_spectrum;
+    QVector<float> m_history;           //最近fftSize个采样
+    QVector<float> m_chunk;             //从环形缓冲区取出的新采样
+    QVector<float> m_bands;             //本帧的分析结果
+    QVector<float> m_levels;            //快起慢落之后显示的值
+    TripleBuffer<Frame> m_frames;
+    std::atomic<bool> m_framePending;   //frameReady已经发出，界面还没有取
+    QTimer * m_timer;                   //在分析线程中第一次setActive时创建
+    bool m_active;
+};
+
+#endif // SPECTRUMANALYZER_H
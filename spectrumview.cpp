@@ -0,0 +1,70 @@
+#include "spectrumview.h"
+#include <QPainter>
+#include <cstring>
+
+//频谱条的默认高度
+static const int kDefaultHeight = 48;
+
+//竖条之间的间隔（像素）
+static const int kGap = 1;
+
+SpectrumView::SpectrumView(QWidget *parent)
+    : QWidget(parent)
+    , m_idle(true)
+{
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    setAttribute(Qt::WA_OpaquePaintEvent, false);
+}
+
+QSize SpectrumView::sizeHint() const
+{
+    return QSize(200, kDefaultHeight);
+}
+
+void SpectrumView::setBands(const float * bands, int count)
+{
+    if (count == m_bands.size() && memcmp(bands, m_bands.constData(), sizeof(float) * count) == 0) { return; }
+
+    if (m_bands.size() != count)
+    {
+        m_bands.resize(count);
+    }
+
+    m_idle = true;
+    for (int i = 0; i < count; i++)
+    {
+        m_bands[i] = bands[i];
+        m_idle = m_idle && bands[i] == 0.0f;
+    }
+    update();
+}
+
+void SpectrumView::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+
+    m_gradient = QLinearGradient(0, height(), 0, 0);
+    m_gradient.setColorAt(0.0, palette().color(QPalette::Highlight));
+    m_gradient.setColorAt(1.0, palette().color(QPalette::Highlight).lighter(160));
+}
+
+void SpectrumView::paintEvent(QPaintEvent *)
+{
+    const int count = m_bands.size();
+    if (count == 0 || m_idle) { return; }
+
+    QPainter painter(this);
+    const QBrush brush(m_gradient);
+    const int h = height();
+    const double barWidth = (double)width() / count;
+
+    for (int i = 0; i < count; i++)
+    {
+        const int barHeight = qRound(m_bands[i] * h);
+        if (barHeight <= 0) { continue; }
+
+        const int left = qRound(i * barWidth);
+        const int right = qRound((i + 1) * barWidth) - kGap;
+        painter.fillRect(left, h - barHeight, qMax(1, right - left), barHeight, brush);
+    }
+}
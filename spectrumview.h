@@ -0,0 +1,34 @@
+#ifndef SPECTRUMVIEW_H
+#define SPECTRUMVIEW_H
+
+#include <QWidget>
+#include <QLinearGradient>
+#include <QVector>
+
+/*频谱条，显示在歌词下方
+ *  每个频带一根竖条，高度是0~1的电平；颜色是从下到上的渐变，只在改变大小时重新生成
+ *  setBands只比较和复制几十个数，电平没有变化时不重绘
+ *  全部为0时isIdle返回true，绘制时直接跳过
+ */
+class SpectrumView : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit SpectrumView(QWidget *parent = nullptr);
+
+    void setBands(const float * bands, int count);
+    bool isIdle() const { return m_idle; }
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    QVector<float> m_bands;
+    QLinearGradient m_gradient;
+    bool m_idle;
+};
+
+#endif // SPECTRUMVIEW_H
@@ -0,0 +1,146 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QThread>
+#include <cstdio>
+#include "libraryindex.h"
+#include "log.h"
+#include "song.h"
+#include "worker.h"
+
+/*
+ * 从消息队列取走本轮导入的结果，加入歌曲管理对象，返回解析失败的数量
+ *  进度消息里已完成数等于总数、并且文件夹已经遍历完时本轮结束
+ *  遍历大文件夹时可能很久没有消息，一直等到结束为止
+ */
+static int collect(SongManager & songs, bool progress)
+{
+    MessageQueue & queue = MessageQueue::getInstance();
+    int errors = 0;
+    bool finished = false;
+    Message message;
+    while (!finished)
+    {
+        if (!queue.pop(message, 1000)) { continue; }
+
+        switch (message.type())
+        {
+        case Message::Result:
+            for (Song * song : message.songs())
+            {
+                songs.addSong(song);
+            }
+            break;
+
+        case Message::Progress:
+            if (progress)
+            {
+                fprintf(stderr, "\r%d/%d%s", message.done(), message.total(), message.scanning() ? " scanning..." : "");
+            }
+            finished = !message.scanning() && message.done() >= message.total();
+            break;
+
+        case Message::Error:
+            LOG_WARNING(Import) << "歌曲解析失败：" << message.text();
+            errors++;
+            break;
+
+        case Message::Removed:
+            break;
+        }
+    }
+    if (progress) { fprintf(stderr, "\n"); }
+
+    return errors;
+}
+
+/*
+ * 无界面的歌曲库索引工具
+ *  loopyindex -o 索引文件 [--no-recursive] [--hash] <文件夹>...
+ *  和播放器一样由工作对象在单独的线程中遍历文件夹，解析分发到解析线程池并发执行
+ *  主线程从消息队列取结果加入歌曲管理对象，全部完成后写出歌曲库索引
+ *  索引文件必须指定：写出的索引只包含这次扫描的文件夹，默认写到播放器的位置会替换掉播放器已有的歌曲库
+ *      要给播放器预先建立索引时，显式指定播放器的索引路径（缺少-o时的提示中会给出）
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    //和播放器使用同一个应用数据目录，默认的索引路径才一致
+    QCoreApplication::setApplicationName("mediaplayer");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Scan music folders and write the mediaplayer library index.");
+    parser.addHelpOption();
+    QCommandLineOption output(QStringList() << "o" << "output", "Index file to write (required).", "file");
+    QCommandLineOption flat("no-recursive", "Do not scan subfolders.");
+    QCommandLineOption hash("hash", "Compute audio content hashes for duplicate detection.");
+    QCommandLineOption quiet(QStringList() << "q" << "quiet", "Do not print progress.");
+    parser.addOptions(QList<QCommandLineOption>() << output << flat << hash << quiet);
+    parser.addPositionalArgument("dirs", "Folders to scan.", "<dir>...");
+    parser.process(app);
+
+    QStringList dirs = parser.positionalArguments();
+    if (dirs.isEmpty())
+    {
+        parser.showHelp(1);
+    }
+    if (!parser.isSet(output))
+    {
+        fprintf(stderr, "missing -o <file>; the index only holds the scanned folders and would replace "
+                        "the player's library.\nthe player's library index is %s\n",
+                qPrintable(LibraryIndex::defaultPath()));
+        return 1;
+    }
+
+    Logger::getInstance().start(QString::fromLocal8Bit(qgetenv("LOOPY_LOG_FILE")));
+    qRegisterMetaType<FileStamps>("FileStamps");
+
+    Worker * worker = new Worker;
+    worker->setContentHashing(parser.isSet(hash));
+    QThread thread;
+    worker->moveToThread(&thread);
+    thread.start();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    SongManager & songs = SongManager::getInstance();
+    int errors = 0;
+    for (const QString & dir : dirs)
+    {
+        QString path = QDir(dir).absolutePath();
+        if (!QFileInfo(path).isDir())
+        {
+            fprintf(stderr, "not a folder: %s\n", qPrintable(dir));
+            continue;
+        }
+
+        // 一次扫描一个文件夹，每个文件夹是一轮导入，工作对象在本轮结束时投递最终进度
+        QMetaObject::invokeMethod(worker, "scanFolder", Qt::QueuedConnection,
+                                  Q_ARG(QString, path), Q_ARG(FileStamps, FileStamps()),
+                                  Q_ARG(bool, !parser.isSet(flat)));
+        errors += collect(songs, !parser.isSet(quiet));
+    }
+
+    thread.quit();
+    thread.wait();
+    delete worker;
+
+    QString indexPath = parser.value(output);
+    bool saved = LibraryIndex::save(indexPath, songs);
+    if (saved)
+    {
+        printf("%d songs (%d failed) indexed in %lld ms, written to %s\n",
+               songs.size(), errors, timer.elapsed(), qPrintable(indexPath));
+    }
+    else
+    {
+        fprintf(stderr, "failed to write %s\n", qPrintable(indexPath));
+    }
+
+    Logger::getInstance().stop();
+    return saved ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+#include "uischeduler.h"
+#include "log.h"
+
+static const int kDefaultFrameIntervalMs = 16;
+static const int kDefaultFrameBudgetUs = 4000;
+
+UiScheduler::UiScheduler(QObject *parent)
+    : QObject(parent)
+    , m_dirtyCount(0)
+    , m_frameIntervalMs(kDefaultFrameIntervalMs)
+    , m_frameBudgetNs(kDefaultFrameBudgetUs * 1000LL)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &UiScheduler::handle_timer_timeout);
+}
+
+int UiScheduler::addTask(const Task & task)
+{
+    m_tasks.append(task);
+    m_dirty.append(false);
+    return m_tasks.size() - 1;
+}
+
+void UiScheduler::markDirty(int task)
+{
+    if (m_dirty[task]) { return; }
+
+    m_dirty[task] = true;
+    m_dirtyCount++;
+    schedule();
+}
+
+void UiScheduler::markAllDirty()
+{
+    for (int i = 0; i < m_tasks.size(); i++)
+    {
+        markDirty(i);
+    }
+}
+
+void UiScheduler::setFrameInterval(int ms)
+{
+    m_frameIntervalMs = qMax(0, ms);
+}
+
+void UiScheduler::setFrameBudget(int us)
+{
+    m_frameBudgetNs = qMax(0, us) * 1000LL;
+}
+
+//距上一帧不足一个间隔时等到间隔结束，否则下一次事件循环就执行
+void UiScheduler::schedule()
+{
+    if (m_timer.isActive() || m_dirtyCount == 0) { return; }
+
+    qint64 wait = 0;
+    if (m_lastFrame.isValid())
+    {
+        wait = qMax<qint64>(0, m_frameIntervalMs - m_lastFrame.elapsed());
+    }
+    m_timer.start((int)wait);
+}
+
+void UiScheduler::handle_timer_timeout()
+{
+    m_lastFrame.start();
+
+    for (int i = 0; i < m_tasks.size() && m_dirtyCount > 0; i++)
+    {
+        if (!m_dirty[i]) { continue; }
+
+        m_dirty[i] = false;
+        m_dirtyCount--;
+        m_tasks[i]();
+
+        if (m_dirtyCount > 0 && m_lastFrame.nsecsElapsed() > m_frameBudgetNs)
+        {
+            LOG_TRACE(Playback) << "本帧超出时间预算，剩余" << m_dirtyCount << "个刷新任务推迟到下一帧";
+            break;
+        }
+    }
+
+    schedule();
+}
@@ -0,0 +1,47 @@
+#ifndef UISCHEDULER_H
+#define UISCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+/*界面刷新调度器，把高频事件（比如播放进度）引起的界面更新合并到按帧刷新
+ *  每个刷新任务一个脏标记，事件处理函数只调用markDirty，不直接改界面
+ *  有脏任务时才启动单次定时器，下一帧按注册顺序执行所有脏任务；没有脏任务时定时器不运行，完全不占CPU
+ *  每帧有时间预算：执行完一个任务后超出预算，剩下的任务保持脏标记留到下一帧，不让一帧拖太久
+ *  任务自己负责比较显示的值有没有变化，没变化时直接返回
+ *  只在主线程使用
+ */
+class UiScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    typedef std::function<void()> Task;
+
+    explicit UiScheduler(QObject *parent = nullptr);
+
+    int addTask(const Task & task);         //注册刷新任务，返回任务编号，越早注册越先执行
+    void markDirty(int task);               //标记任务需要刷新，下一帧执行
+    void markAllDirty();
+    void setFrameInterval(int ms);          //两帧之间的最小间隔，默认16ms
+    void setFrameBudget(int us);            //每帧的时间预算（微秒），默认4000
+
+private slots:
+    void handle_timer_timeout();
+
+private:
+    void schedule();
+
+private:
+    QVector<Task> m_tasks;
+    QVector<bool> m_dirty;
+    int m_dirtyCount;
+    QTimer m_timer;
+    QElapsedTimer m_lastFrame;      //上一帧开始的时间
+    int m_frameIntervalMs;
+    qint64 m_frameBudgetNs;
+};
+
+#endif // UISCHEDULER_H
@@ -0,0 +1,262 @@
+#include "waveformcache.h"
+#include "loudnessanalyzer.h"
+#include "song.h"
+#include "log.h"
+#include <QAudioDecoder>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <cstring>
+
+//磁盘缓存的总大小上限，超过时从最早写入的文件开始删除
+static const qint64 kMaxDiskBytes = 64 * 1024 * 1024;
+
+/*
+ * 后台加载一首歌的波形
+ *  先读磁盘缓存，核对路径；没有或者不匹配时解码计算，再写回磁盘缓存
+ *  失败时也放入一个空波形，视图显示为一条直线，不会反复重试
+ *  开始前和解码过程中检查请求是否已被取消（切歌后不再需要），取消时直接放弃，不写缓存
+ */
+class WaveformLoadTask : public QRunnable
+{
+public:
+    WaveformLoadTask(WaveformCache * cache, const QUrl & mp3Url) : m_cache(cache), m_url(mp3Url) {}
+
+    void run() override
+    {
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+
+        if (!m_cache->isLoading(m_url)) { return; }
+
+        const QString path = m_url.path();
+        const QString cachePath = WaveformCache::diskPath(path);
+        Waveform * waveform = new Waveform;
+
+        if (!loadFromDisk(cachePath, path, *waveform))
+        {
+            if (!decode(path, *waveform))
+            {
+                LOG_TRACE(Analysis) << "波形加载已取消：" << m_url;
+                delete waveform;
+                return;
+            }
+            saveToDisk(cachePath, path, *waveform);
+            trimDisk(QFileInfo(cachePath).absolutePath());
+        }
+
+        m_cache->insert(m_url, WaveformPtr(waveform));
+    }
+
+private:
+    //缓存文件：路径的UTF-8长度（4字节）、路径，然后是Waveform::save的数据
+    static bool loadFromDisk(const QString & cachePath, const QString & path, Waveform & waveform)
+    {
+        QFile file(cachePath);
+        if (!file.open(QIODevice::ReadOnly)) { return false; }
+
+        QByteArray data = file.readAll();
+        QByteArray utf8 = path.toUtf8();
+        quint32 size = 0;
+        if (data.size() < 4) { return false; }
+        memcpy(&size, data.constData(), 4);
+        if (size != (quint32)utf8.size() || data.size() < 4 + utf8.size()
+                || memcmp(data.constData() + 4, utf8.constData(), utf8.size()) != 0)
+        {
+            return false;
+        }
+
+        return waveform.load(data.mid(4 + utf8.size()));
+    }
+
+    static void saveToDisk(const QString & cachePath, const QString & path, const Waveform & waveform)
+    {
+        QByteArray utf8 = path.toUtf8();
+        quint32 size = (quint32)utf8.size();
+
+        QSaveFile file(cachePath);
+        if (!file.open(QIODevice::WriteOnly)) { return; }
+        file.write(reinterpret_cast<const char *>(&size), 4);
+        file.write(utf8);
+        file.write(waveform.save());
+        if (!file.commit())
+        {
+            LOG_WARNING(Analysis) << "波形缓存保存失败：" << cachePath;
+        }
+    }
+
+    /*
+     * 磁盘缓存超过kMaxDiskBytes时，从最早写入的文件开始删除，直到总大小降到上限以内
+     *  后台只有一个线程，写入和清理不会同时进行
+     */
+    static void trimDisk(const QString & dir)
+    {
+        const QFileInfoList files = QDir(dir).entryInfoList(QStringList() << "*.wfm", QDir::Files, QDir::Time);
+        qint64 total = 0;
+        int removed = 0;
+        for (const QFileInfo & info : files)
+        {
+            total += info.size();
+            if (total > kMaxDiskBytes && QFile::remove(info.filePath()))
+            {
+                removed++;
+            }
+        }
+
+        if (removed > 0)
+        {
+            LOG_DEBUG(Analysis) << "波形磁盘缓存超过上限，删除：" << removed << "个文件";
+        }
+    }
+
+    /*
+     * 解码整首歌计算波形，请求被取消时返回false
+     *  finished/error可能在start里同步发出，也可能在进入事件循环之前就已经到达，
+     *      用done记录，已经结束就不再进入事件循环，否则quit丢失后会一直等下去
+     *  每个缓冲区检查一次请求是否还在，被取消时停止解码、退出事件循环
+     */
+    bool decode(const QString & path, Waveform & waveform)
+    {
+        QAudioDecoder decoder;
+        QEventLoop loop;
+        QVector<float> scratch;
+        bool done = false;
+        bool cancelled = false;
+
+        QObject::connect(&decoder, &QAudioDecoder::bufferReady, &loop, [&]() {
+            QAudioBuffer buffer = decoder.read();
+            if (done) { return; }
+            if (!m_cache->isLoading(m_url))
+            {
+                cancelled = true;
+                done = true;
+                loop.quit();
+                return;
+            }
+
+            const float * samples = LoudnessAnalyzer::toFloat(buffer, scratch);
+            if (samples)
+            {
+                waveform.addFrames(samples, buffer.frameCount(), buffer.format().channelCount());
+            }
+        });
+        QObject::connect(&decoder, &QAudioDecoder::finished, &loop, [&]() {
+            done = true;
+            loop.quit();
+        });
+        QObject::connect(&decoder, static_cast<void (QAudioDecoder::*)(QAudioDecoder::Error)>(&QAudioDecoder::error),
+                         &loop, [&](QAudioDecoder::Error) {
+            LOG_WARNING(Analysis) << "波形解码失败：" << path << decoder.errorString();
+            done = true;
+            loop.quit();
+        });
+
+        decoder.setSourceFilename(path);
+        decoder.start();
+        if (!done)
+        {
+            loop.exec();
+        }
+        decoder.stop();
+
+        if (cancelled) { return false; }
+        waveform.finish();
+        return true;
+    }
+
+private:
+    WaveformCache * m_cache;
+    QUrl m_url;
+};
+
+WaveformCache::WaveformCache(int maxBytes, QObject *parent)
+    : QObject(parent)
+    , m_cache(maxBytes)
+{
+    qRegisterMetaType<WaveformPtr>("WaveformPtr");
+    m_pool.setMaxThreadCount(1);
+}
+
+//先取消所有请求，正在解码的任务在下一个缓冲区就会退出，不用等它解码完整首歌
+WaveformCache::~WaveformCache()
+{
+    cancel();
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+QString WaveformCache::diskPath(const QString & mp3Path)
+{
+    static const QString dir = []() {
+        QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/waveforms";
+        QDir().mkpath(path);
+        return path;
+    }();
+
+    FileStamp stamp = FileStamp::of(QFileInfo(mp3Path));
+    return QString("%1/%2-%3-%4.wfm").arg(dir)
+            .arg(qHash(mp3Path), 8, 16, QChar('0'))
+            .arg(stamp.fileTime, 0, 16)
+            .arg(stamp.fileSize, 0, 16);
+}
+
+WaveformPtr WaveformCache::find(const QUrl & mp3Url)
+{
+    QMutexLocker locker(&m_mutex);
+    Entry * entry = m_cache.object(mp3Url);
+    return entry ? entry->waveform : WaveformPtr();
+}
+
+void WaveformCache::request(const QUrl & mp3Url)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_cache.contains(mp3Url) || m_loading.contains(mp3Url)) { return; }
+        m_loading.insert(mp3Url);
+    }
+
+    LOG_TRACE(Analysis) << "后台加载波形：" << mp3Url;
+    m_pool.start(new WaveformLoadTask(this, mp3Url));
+}
+
+/*
+ * 取消除keep以外的所有请求
+ *  只是从m_loading中去掉，排队中的任务开始时发现已取消直接返回，正在解码的任务在下一个缓冲区退出
+ *  取消之后再次请求同一首歌会重新排队
+ */
+void WaveformCache::cancel(const QUrl & keep)
+{
+    QMutexLocker locker(&m_mutex);
+    const bool kept = m_loading.contains(keep);
+    m_loading.clear();
+    if (kept) { m_loading.insert(keep); }
+}
+
+bool WaveformCache::isLoading(const QUrl & mp3Url)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_loading.contains(mp3Url);
+}
+
+void WaveformCache::insert(const QUrl & mp3Url, const WaveformPtr & waveform)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_loading.remove(mp3Url);
+
+        Entry * entry = new Entry;
+        entry->waveform = waveform;
+        m_cache.insert(mp3Url, entry, waveform->bytes());
+    }
+
+    emit loaded(mp3Url, waveform);
+}
+
+void WaveformCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.clear();
+}
@@ -0,0 +1,56 @@
+#ifndef WAVEFORMCACHE_H
+#define WAVEFORMCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QMutex>
+#include <QSet>
+#include <QThreadPool>
+#include <QUrl>
+#include "waveform.h"
+
+/*波形缓存，两级：内存中按字节数限制容量的LRU缓存 + 磁盘缓存
+ *  内存缓存和LyricCache一样用QCache，以波形占用的字节数作为开销
+ *  磁盘缓存在应用数据目录的waveforms下，每首歌一个文件，文件名包含路径的哈希和文件戳（修改时间、大小），
+ *      文件变化后自然换一个文件名，旧文件不再被使用；文件内容中也保存完整路径，读入时核对
+ *  find只查内存缓存，不阻塞；request在后台线程中先查磁盘，没有时才解码整首歌计算，完成后发出loaded信号
+ *      后台只有一个低优先级线程，一次解码一首，不影响播放
+ *      解码使用QAudioDecoder，在后台线程中用局部事件循环等待解码完成
+ *  cancel取消不再需要的请求（切歌后只保留当前歌曲），排队中的直接跳过，正在解码的尽快停下
+ *  磁盘缓存总大小有上限，超过时删除最早写入的文件
+ *  线程安全：find/request可以在任意线程调用
+ */
+class WaveformCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WaveformCache(int maxBytes = 4 * 1024 * 1024, QObject *parent = nullptr);
+    ~WaveformCache();
+
+    WaveformPtr find(const QUrl & mp3Url);      //查内存缓存，没有返回空指针
+    void request(const QUrl & mp3Url);          //异步加载，已缓存或正在加载时忽略
+    void cancel(const QUrl & keep = QUrl());    //取消keep以外正在加载和排队中的请求
+    void clear();
+
+    static QString diskPath(const QString & mp3Path);  //一首歌当前文件戳对应的磁盘缓存文件
+
+signals:
+    void loaded(const QUrl & mp3Url, const WaveformPtr & waveform);  //某首歌的波形加载完成
+
+private:
+    friend class WaveformLoadTask;
+    void insert(const QUrl & mp3Url, const WaveformPtr & waveform);
+    bool isLoading(const QUrl & mp3Url);        //请求还没有被取消
+
+    struct Entry
+    {
+        WaveformPtr waveform;
+    };
+
+    QMutex m_mutex;                 //保护m_cache和m_loading
+    QCache<QUrl, Entry> m_cache;
+    QSet<QUrl> m_loading;           //正在加载和排队中的请求，取消时从这里去掉
+    QThreadPool m_pool;
+};
+
+#endif // WAVEFORMCACHE_H
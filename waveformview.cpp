@@ -0,0 +1,107 @@
+#include "waveformview.h"
+#include <QPainter>
+#include <QPaintEvent>
+
+//波形条的默认高度
+static const int kDefaultHeight = 32;
+
+WaveformView::WaveformView(QWidget *parent)
+    : QWidget(parent)
+    , m_progress(0)
+    , m_progressX(0)
+{
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+}
+
+QSize WaveformView::sizeHint() const
+{
+    return QSize(200, kDefaultHeight);
+}
+
+void WaveformView::setWaveform(const WaveformPtr & waveform)
+{
+    m_waveform = waveform;
+    rebuild();
+    update();
+}
+
+void WaveformView::setProgress(double fraction)
+{
+    m_progress = qBound(0.0, fraction, 1.0);
+
+    int x = qRound(m_progress * width());
+    if (x == m_progressX) { return; }
+
+    //只重绘新旧位置之间的几列
+    update(QRect(qMin(x, m_progressX), 0, qAbs(x - m_progressX), height()));
+    m_progressX = x;
+}
+
+void WaveformView::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    m_progressX = qRound(m_progress * width());
+    rebuild();
+}
+
+/*
+ * 每个像素一根竖线，从最小值画到最大值；没有波形时画一条中线
+ *  两张图只有颜色不同，绘制时按进度各取一部分
+ */
+void WaveformView::rebuild()
+{
+    const int w = width();
+    const int h = height();
+    if (w <= 0 || h <= 0) { return; }
+
+    if (m_waveform)
+    {
+        m_waveform->render(w, m_peaks);
+    }
+    else
+    {
+        m_peaks.fill(Waveform::Peak{ 0, 0 }, w);
+    }
+
+    const QColor colors[2] = { palette().color(QPalette::Highlight), palette().color(QPalette::Mid) };
+    QPixmap * targets[2] = { &m_played, &m_unplayed };
+
+    const double half = (h - 1) / 2.0;
+    for (int k = 0; k < 2; k++)
+    {
+        QPixmap pixmap(w, h);
+        pixmap.fill(Qt::transparent);
+
+        QPainter painter(&pixmap);
+        painter.setPen(colors[k]);
+        for (int x = 0; x < w; x++)
+        {
+            int top = qRound(half - m_peaks[x].max * half / 127.0);
+            int bottom = qRound(half - m_peaks[x].min * half / 127.0);
+            painter.drawLine(x, top, x, bottom);
+        }
+        painter.end();
+
+        *targets[k] = pixmap;
+    }
+}
+
+void WaveformView::paintEvent(QPaintEvent *event)
+{
+    if (m_played.isNull()) { return; }
+
+    QPainter painter(this);
+    const QRect dirty = event->rect();
+
+    QRect played = dirty.intersected(QRect(0, 0, m_progressX, height()));
+    if (!played.isEmpty())
+    {
+        painter.drawPixmap(played, m_played, played);
+    }
+
+    QRect unplayed = dirty.intersected(QRect(m_progressX, 0, width() - m_progressX, height()));
+    if (!unplayed.isEmpty())
+    {
+        painter.drawPixmap(unplayed, m_unplayed, unplayed);
+    }
+}
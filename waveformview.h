@@ -0,0 +1,42 @@
+#ifndef WAVEFORMVIEW_H
+#define WAVEFORMVIEW_H
+
+#include <QWidget>
+#include <QPixmap>
+#include <QVector>
+#include "waveform.h"
+
+/*波形条，显示在进度条下方
+ *  波形只在换歌和改变大小时按当前宽度缩放（Waveform::render，O(宽度)），画成已播放/未播放两张图
+ *  播放进度变化时只比较已播放部分的像素宽度，变了才重绘新旧位置之间的几列，
+ *      positionChanged里调用setProgress只是一次比较，不会阻塞
+ *  还没有波形（正在后台加载）时显示一条中线
+ */
+class WaveformView : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit WaveformView(QWidget *parent = nullptr);
+
+    void setWaveform(const WaveformPtr & waveform);
+    void setProgress(double fraction);      //播放进度，0~1
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    void rebuild();     //按当前宽度重新生成两张图
+
+private:
+    WaveformPtr m_waveform;
+    QVector<Waveform::Peak> m_peaks;    //每个像素的<最小值, 最大值>，复用
+    QPixmap m_played;
+    QPixmap m_unplayed;
+    double m_progress;
+    int m_progressX;                    //已播放部分的像素宽度
+};
+
+#endif // WAVEFORMVIEW_H
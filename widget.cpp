@@ -2,31 +2,72 @@
 #include "ui_widget.h"
 #include <QFileDialog>
 #include <QDebug>
+#include "log.h"
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include "song.h"
+#include "libraryindex.h"
+#include "startupprobe.h"
+#include <QTimer>
+#include <cmath>
+#include <algorithm>
+
+//回放增益的目标响度（LUFS），和ReplayGain 2.0的参考电平一致
+static const double kReplayGainTarget = -18.0;
+//没有回放增益时的播放音量
+static const int kBaseVolume = 100;
 
 Widget::Widget(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::Widget)
+    , m_pmediaplayer(nullptr)
     , m_pthread(new QThread)
+    , m_panalyzerthread(new QThread)
+    , m_replayGain(false)
+    , m_firstFrame(false)
+    , m_restoring(false)
+    , m_position(0)
+    , m_shownSliderValue(-1)
+    , m_shownSeconds(-1)
+    , m_shownDuration(-1)
+    , m_shownLyricIndex(-1)
+    , m_seekPreview(-1)
+    , m_psearchthread(new QThread)
+    , m_unindexed(0)
+    , m_pspectrumthread(new QThread)
 
 {
+    // 构造函数只做显示窗口必需的事，每个阶段的完成时间记到启动计时里；
+    // 加载多媒体后端和恢复歌曲库比较慢，推迟到第一帧画出来之后（见init_afterFirstFrame）
+    StartupProbe & probe = StartupProbe::getInstance();
+
     ui->setupUi(this);
+    probe.mark("setupUi");
 
-    init_media();                            //media引擎初始化
+    init_playlist();                        //播放列表，播放引擎在第一帧之后创建
 
     init_window();                          //界面布局
+    probe.mark("init_window");
+
+    init_search();                          //后台搜索索引
+    probe.mark("init_search");
 
     init_worker();
-    
+    probe.mark("init_worker");
+
+    init_analyzer();                        //后台响度分析
+    probe.mark("init_analyzer");
+
+    init_spectrum();                        //频谱分析
+    probe.mark("init_spectrum");
+
     connect(ui->pushButton_add,&QPushButton::clicked,this,&Widget::pushButton_add_clicked);                  //添加音乐按钮
 
-    connect(ui->pushButton_play,&QPushButton::clicked,this,&Widget::pushButton_play_clicked);                //添加播放按键
+    connect(ui->pushButton_addFolder,&QPushButton::clicked,this,&Widget::pushButton_addFolder_clicked);      //添加文件夹按钮
 
-    connect(m_pmediaplayer,&QMediaPlayer::stateChanged,this,&Widget::handle_mediaPlayer_stateChanged);       //播放状态显示到pushbutton
+    connect(ui->pushButton_play,&QPushButton::clicked,this,&Widget::pushButton_play_clicked);                //添加播放按键
 
-    connect(m_pmediaplayer,&QMediaPlayer::positionChanged,this,&Widget::handle_mediaPlayer_positionChanged); //播放进度显示到进度条
+    connect(ui->horizontalSlider_time,&QSlider::sliderMoved,this,&Widget::horizontalSlider_position_sliderMoved); //拖动进度条时预览目标位置
 
     connect(ui->horizontalSlider_time,&QSlider::sliderReleased,this,&Widget::horizontalSlider_position_sliderReleased); //拖动进度条改编歌曲进度
 
@@ -34,61 +75,431 @@ Widget::Widget(QWidget *parent)
 
     connect(ui->pushButton_next,&QPushButton::clicked,this,&Widget::pushButton_next_clicked);                //下一首
 
-    connect(m_pmediaplayer,&QMediaPlayer::currentMediaChanged,this,&Widget::handle_mediaPlaylist_currentMediaChanged); //切歌时发生的一系列变化
-
     connect(ui->pushButton_playbackmodel,&QPushButton::clicked,this,&Widget::pushButton_playbackmodel_clicked);        //点击播放模式变化
 
     connect(m_pmediaplayerlist,&QMediaPlaylist::playbackModeChanged,this,&Widget::handleMediaPlaylistPlaybackModeChanged); //播放模式变化体现在按钮文本
 
-    connect(ui->listWidget_music, &QListWidget::itemDoubleClicked, this, &Widget::listWidget_playlist_itemDoubleClicked); //双击列表中音乐项目
+    connect(ui->listView_music, &QListView::doubleClicked, this, &Widget::listView_playlist_doubleClicked); //双击列表中音乐项目
+
+    connect(ui->lineEdit_search, &QLineEdit::textChanged, this, &Widget::lineEdit_search_textChanged); //搜索框输入，即时过滤歌曲列表
+
+    connect(&SongManager::getInstance().lyricCache(), &LyricCache::loaded, this, &Widget::handle_lyricCache_loaded); //歌词后台加载完成
+
+    connect(m_pwaveformcache, &WaveformCache::loaded, this, &Widget::handle_waveformCache_loaded); //波形后台加载完成
 }
 
 
 Widget::~Widget()
 {
+    saveLibrary();
+
+    //停止响度分析，正在解码的歌曲立即停止
+    m_panalyzer->cancel();
+    m_panalyzerthread->quit();
+    m_panalyzerthread->wait();
+    delete m_panalyzer;
+    delete m_panalyzerthread;
+
+    //停止搜索索引，排队的请求全部丢弃
+    m_psearchindexer->cancel();
+    m_psearchthread->quit();
+    m_psearchthread->wait();
+    delete m_psearchindexer;
+    delete m_psearchthread;
+
+    //先取消音频旁路，返回时播放引擎已经不再往频谱分析对象送数据
+    //频谱分析对象和它的定时器在分析线程结束时由deleteLater释放（见init_spectrum）
+    if (m_pmediaplayer)
+    {
+        m_pmediaplayer->setAudioTap(nullptr);
+    }
+    m_pspectrumthread->quit();
+    m_pspectrumthread->wait();
+    delete m_pspectrumthread;
+
+    //主线程不再取消息，让阻塞在满队列上的解析线程放弃入队，避免退出时互相等待
+    MessageQueue::getInstance().setOverflowPolicy(MessageQueue::Reject);
+
+    //先结束工作线程，再释放工作对象（工作对象析构时会停止解析线程池）
+    m_pthread->quit();
+    m_pthread->wait();
+    delete m_pworker;
+    delete m_pthread;
+
     delete ui;
 
 }
 
-void Widget::init_media()                       //初始化多媒体
+void Widget::init_playlist()
 {
-    m_pmediaplayer = new QMediaPlayer(this);
     m_pmediaplayerlist = new QMediaPlaylist(this);
+    m_pmediaplayerlist->setPlaybackMode(QMediaPlaylist::Loop);
+
+    return;
+}
 
+void Widget::init_media()                       //初始化多媒体
+{
+    if (m_pmediaplayer) { return; }
+
+    m_pmediaplayer = PlaybackEngine::create(this);
     m_pmediaplayer->setPlaylist(m_pmediaplayerlist);
-    m_pmediaplayerlist->setPlaybackMode(QMediaPlaylist::Loop);
 
+    connect(m_pmediaplayer,&PlaybackEngine::stateChanged,this,&Widget::handle_mediaPlayer_stateChanged);       //播放状态显示到pushbutton
+
+    connect(m_pmediaplayer,&PlaybackEngine::positionChanged,this,&Widget::handle_mediaPlayer_positionChanged); //播放进度显示到进度条
+
+    connect(m_pmediaplayer,&PlaybackEngine::currentMediaChanged,this,&Widget::handle_mediaPlaylist_currentMediaChanged); //切歌时发生的一系列变化
+
+    m_pmediaplayer->setAudioTap(m_pspectrum);   //频谱分析接在播放引擎的音频旁路上
+    StartupProbe::getInstance().mark("init_media");
+
+    return;
+}
+
+/*
+ * 第一帧之后的初始化
+ *  在第一次绘制之后的零延时定时器里执行，这时窗口已经画到屏幕上
+ *  先输出启动报告，再创建播放引擎，最后在工作线程中恢复上次的歌曲库，
+ *  恢复的歌曲分批投递回来加入列表，窗口一直可以操作
+ */
+void Widget::init_afterFirstFrame()
+{
+    StartupProbe & probe = StartupProbe::getInstance();
+    probe.finish();
+
+    init_media();
 
+    // 恢复上次的歌曲库，没有变化的歌曲不用重新解析
+    m_restoring = true;
+    emit restoreLibrary(LibraryIndex::defaultPath());
+    probe.mark("restoreLibrary requested");
 
     return;
 }
 
+void Widget::paintEvent(QPaintEvent *event)
+{
+    QWidget::paintEvent(event);
+
+    // 这次绘制的结果随后才刷到屏幕上，零延时定时器在这之后执行
+    if (!m_firstFrame)
+    {
+        m_firstFrame = true;
+        QTimer::singleShot(0, this, &Widget::init_afterFirstFrame);
+    }
+}
+
 void Widget::init_worker()
 {
+    qRegisterMetaType<QList<QUrl>>("QList<QUrl>");   //跨线程排队信号的参数类型需要注册
+    qRegisterMetaType<FileStamps>("FileStamps");
+
     m_pworker = new Worker;
+
+    // 重复歌曲检测，由环境变量LOOPY_DEDUP开启：skip丢弃内容相同的副本，group保留并归为一组
+    QByteArray dedup = qgetenv("LOOPY_DEDUP").toLower();
+    if (dedup == "skip" || dedup == "group")
+    {
+        m_pworker->setContentHashing(true);
+        m_psongmodel->setDuplicatePolicy(dedup == "skip" ? SongListModel::SkipDuplicates : SongListModel::KeepDuplicates);
+    }
     m_pworker->moveToThread(m_pthread);
     connect(this, &Widget::addSong, m_pworker, &Worker::getASong);
-    connect(m_pworker, &Worker::getASongFinished, this, &Widget::handle_worker_getASongFinished);
+    connect(this, &Widget::addSongs, m_pworker, &Worker::getSongs);
+    connect(this, &Widget::restoreLibrary, m_pworker, &Worker::restoreLibrary);
+    connect(this, &Widget::scanFolder, m_pworker, &Worker::scanFolder);
+    connect(m_pworker, &Worker::messagesReady, this, &Widget::handle_worker_messagesReady);
 
     m_pthread->start();
 
+    m_pfolderwatcher = new FolderWatcher(this);
+    connect(m_pfolderwatcher, &FolderWatcher::changed, this, &Widget::handle_folderWatcher_changed);
+
+    return;
+}
+
+/*
+ * 初始化响度分析
+ *  和工作对象一样移到单独的线程中，线程以最低优先级运行
+ *  由环境变量LOOPY_REPLAYGAIN=off关闭，关闭时既不分析也不调整音量
+ */
+void Widget::init_analyzer()
+{
+    m_replayGain = qgetenv("LOOPY_REPLAYGAIN").toLower() != "off";
+
+    m_panalyzer = new LoudnessAnalyzer;
+    m_panalyzer->moveToThread(m_panalyzerthread);
+    connect(this, &Widget::analyzeSongs, m_panalyzer, &LoudnessAnalyzer::analyze);
+    connect(m_panalyzer, &LoudnessAnalyzer::analyzed, this, &Widget::handle_analyzer_analyzed);
+    connect(m_panalyzer, &LoudnessAnalyzer::idle, this, &Widget::handle_analyzer_idle);
+
+    // 每批分析完都写整个索引会卡住界面线程，延迟一段时间再保存，期间又有新结果就重新计时；退出时一定会保存
+    m_psavetimer = new QTimer(this);
+    m_psavetimer->setSingleShot(true);
+    m_psavetimer->setInterval(5000);
+    connect(m_psavetimer, &QTimer::timeout, this, &Widget::saveLibrary);
+
+    m_panalyzerthread->start(QThread::LowestPriority);
+
+    return;
+}
+
+/*
+ * 初始化搜索索引
+ *  和响度分析一样移到单独的最低优先级线程中，读取歌词、切分gram都不占用界面线程
+ *  界面线程直接查询索引（读写锁保护），每次输入都同步得到结果
+ */
+void Widget::init_search()
+{
+    m_psearchindexer = new SearchIndexer;
+    m_psearchindexer->moveToThread(m_psearchthread);
+    connect(this, &Widget::indexSongs, m_psearchindexer, &SearchIndexer::addSongs);
+    connect(this, &Widget::unindexSongs, m_psearchindexer, &SearchIndexer::removeSongs);
+    connect(m_psearchindexer, &SearchIndexer::indexed, this, &Widget::handle_searchIndexer_indexed);
+
+    m_psearchthread->start(QThread::LowestPriority);
+
     return;
 }
 
-void Widget::handle_worker_getASongFinished()
+/*
+ * 初始化频谱分析
+ *  分析对象移到单独的线程中，作为音频旁路接到播放引擎上
+ *  开始播放时启动，暂停和停止后频带落到0就停下；分析出新的一帧时界面在下一帧取走
+ */
+void Widget::init_spectrum()
+{
+    m_pspectrum = new SpectrumAnalyzer;
+    m_pspectrum->moveToThread(m_pspectrumthread);
+    connect(this, &Widget::spectrumActive, m_pspectrum, &SpectrumAnalyzer::setActive);
+    connect(m_pspectrum, &SpectrumAnalyzer::frameReady, this, &Widget::handle_spectrum_frameReady);
+    connect(m_pspectrumthread, &QThread::finished, m_pspectrum, &QObject::deleteLater); //定时器在分析线程中创建，也在这个线程中释放
+
+    m_pspectrumthread->start(QThread::LowPriority);
+
+    return;
+}
+
+/*
+ * 保存歌曲库索引
+ *  歌曲ID按添加顺序编号，和播放列表的顺序一致，下次启动恢复后列表顺序不变
+ *  每次导入完成和程序退出时保存，响度分析的结果延迟一段时间合并保存
+ *  恢复还没有完成时不保存：歌曲库里只有一部分歌曲，会覆盖掉完整的索引（旧版本的索引要等重新解析完才替换）
+ */
+void Widget::saveLibrary()
+{
+    if (m_restoring)
+    {
+        LOG_INFO(General) << "歌曲库还在恢复，不保存索引";
+        return;
+    }
+
+    m_psavetimer->stop();          //已经包含了等待保存的分析结果
+    LibraryIndex::save(LibraryIndex::defaultPath(), SongManager::getInstance());
+}
+
+void Widget::handle_worker_messagesReady()
+{
+    // 一次取出消息队列里所有待处理的消息
+    QList<Message> messages = MessageQueue::getInstance().popAll();
+
+    QVector<Song*> songs;           // 本次收到、还没加入列表的歌曲
+    bool finished = false;          // 本轮导入是否已经全部完成
+
+    for (const Message & message : messages)
+    {
+        switch (message.type())
+        {
+        case Message::Result:
+            songs += message.songs();
+            break;
+
+        case Message::Progress:
+            // 导入进度显示在窗口标题上，全部完成后恢复；还在遍历文件夹时总数还会增加
+            if (message.scanning())
+            {
+                this->setWindowTitle(QString("音乐播放器 - 正在扫描 %1/%2").arg(message.done()).arg(message.total()));
+            }
+            else if (message.done() < message.total())
+            {
+                this->setWindowTitle(QString("音乐播放器 - 正在导入 %1/%2").arg(message.done()).arg(message.total()));
+            }
+            else
+            {
+                this->setWindowTitle("音乐播放器");
+                finished = true;
+            }
+            break;
+
+        case Message::Error:
+            LOG_WARNING(Import) << "歌曲解析失败：" << message.text();
+            break;
+
+        case Message::Removed:
+            // 先加入之前收到的歌曲，保持和工作对象投递的先后顺序一致
+            appendSongs(songs);
+            songs.clear();
+            removeSongs(message.paths());
+            break;
+        }
+    }
+
+    appendSongs(songs);
+
+    // 本轮导入完成，保存歌曲库索引，并监视歌曲所在的所有文件夹
+    if (finished)
+    {
+        if (m_restoring)
+        {
+            m_restoring = false;
+            StartupProbe::getInstance().mark("library restored");
+        }
+        saveLibrary();
+        m_pfolderwatcher->watch(SongManager::getInstance().directories());
+        queueAnalysis();
+    }
+
+}
+
+void Widget::appendSongs(const QVector<Song*>& songs)
+{
+    if (songs.isEmpty()) { return; }
+
+    // 歌曲对象加入音乐管理对象后就被释放，先取出搜索索引需要的字段，加入之后再填上歌曲ID
+    SearchDocuments documents;
+    documents.reserve(songs.size());
+    for (const Song * song : songs)
+    {
+        SearchDocument document;
+        document.url = song->url();
+        document.name = song->name();
+        document.artist = song->artist();
+        document.album = song->album();
+        document.hasLyrics = song->lyricCount() > 0;
+        documents.append(document);
+    }
+
+    // 通过歌曲列表模型加入音乐管理对象，一次插入所有新歌；已有的歌（文件变化后重新解析）只更新信息
+    QList<QUrl> urls = m_psongmodel->addSongs(songs);
+
+    // 被丢弃的重复歌曲不在歌曲库中，也不加入搜索索引
+    SongManager & manager = SongManager::getInstance();
+    int count = 0;
+    for (SearchDocument & document : documents)
+    {
+        document.id = manager.find(document.url);
+        if (document.id >= 0) { documents[count++] = document; }
+    }
+    documents.resize(count);
+    emit indexSongs(documents);
+
+    // 新歌一次性加入音乐播放器列表
+    QList<QMediaContent> contents;
+    contents.reserve(urls.size());
+    for (const QUrl & url : urls)
+    {
+        contents.append(QMediaContent(url));
+    }
+    if (!contents.isEmpty())
+    {
+        m_pmediaplayerlist->addMedia(contents);
+    }
+}
+
+void Widget::removeSongs(const QStringList& paths)
+{
+    // 歌曲ID和播放列表下标一一对应，模型按段从后往前删除，播放列表和搜索索引按同样的顺序删除
+    QVector<QPair<int, int>> ranges = m_psongmodel->removeSongs(paths);
+    for (const QPair<int, int> & range : ranges)
+    {
+        m_pmediaplayerlist->removeMedia(range.first, range.first + range.second - 1);
+    }
+    m_unindexed++;
+    emit unindexSongs(ranges);
+    LOG_INFO(Import) << "删除已不存在的歌曲：" << paths.size() << "首";
+}
+
+//导入完成后调用，只投递还没分析过、也不在分析队列中的歌曲
+void Widget::queueAnalysis()
+{
+    if (!m_replayGain) { return; }
+
+    SongManager & manager = SongManager::getInstance();
+    QList<QUrl> urls;
+    for (SongId id = 0; id < manager.size(); id++)
+    {
+        if (manager.hasLoudness(id)) { continue; }
+
+        QUrl url = manager.url(id);
+        if (m_analysisPending.contains(url)) { continue; }
+
+        m_analysisPending.insert(url);
+        urls.append(url);
+    }
+
+    if (!urls.isEmpty())
+    {
+        LOG_INFO(Analysis) << "开始后台响度分析：" << urls.size() << "首";
+        emit analyzeSongs(urls);
+    }
+}
+
+void Widget::handle_analyzer_analyzed(const QUrl& mp3Url, float loudness, float truePeak)
+{
+    m_analysisPending.remove(mp3Url);
+
+    // 分析期间歌曲可能已经被删除
+    SongId id = SongManager::getInstance().find(mp3Url);
+    if (id < 0) { return; }
+
+    SongManager::getInstance().setLoudness(id, loudness, truePeak);
+    if (mp3Url == m_currentUrl)
+    {
+        applyReplayGain();
+    }
+}
+
+void Widget::handle_analyzer_idle()
+{
+    // 一批分析完成，稍后保存结果，下次启动不用重新分析
+    m_psavetimer->start();
+}
+
+/*
+ * 回放增益
+ *  增益 = 目标响度 - 歌曲响度，再限制在不让真峰值超过满幅的范围内
+ *  QMediaPlayer的音量只能衰减，比目标响度还轻的歌按原音量播放
+ */
+void Widget::applyReplayGain()
 {
-    // 从消息队列取出一个音乐对象
-    Song* psong = MessageQueue::getInstance().pop();
+    int volume = kBaseVolume;
 
-    // 把该音乐对象加到音乐管理对象里面
-    SongManager::getInstance().addSong(psong);
+    SongManager & manager = SongManager::getInstance();
+    SongId id = manager.find(m_currentUrl);
+    if (m_replayGain && id >= 0 && manager.hasLoudness(id) && manager.truePeak(id) > 0)
+    {
+        double linear = std::pow(10.0, (kReplayGainTarget - manager.loudness(id)) / 20.0);
+        linear = qMin(linear, 1.0 / manager.truePeak(id));
+        volume = qBound(0, qRound(kBaseVolume * qMin(linear, 1.0)), kBaseVolume);
+        LOG_DEBUG(Playback) << "回放增益：" << manager.loudness(id) << "LUFS，音量：" << volume;
+    }
 
-    // 取出该音乐对象里面的歌曲路径加入到音乐播放器列表
-    m_pmediaplayerlist->addMedia(psong->url());
+    if (m_pmediaplayer)
+    {
+        m_pmediaplayer->setVolume(volume);
+    }
+}
 
-    // 取出该音乐对象里面的歌曲路径加入到ui音乐列表
-    ui->listWidget_music->addItem( new QListWidgetItem(psong->name()) );
+bool Widget::isPlaying() const
+{
+    return m_pmediaplayer && m_pmediaplayer->state() == QMediaPlayer::PlayingState;
+}
 
+void Widget::handle_folderWatcher_changed(const QString& dir, bool recursive)
+{
+    // 文件戳在主线程从歌曲管理对象中取出，工作线程不访问歌曲管理对象
+    emit scanFolder(dir, SongManager::getInstance().stamps(dir, recursive), recursive);
 }
         
 void Widget::init_window()                     //界面布局
@@ -98,21 +509,59 @@ void Widget::init_window()                     //界面布局
 
 
     ui->pushButton_add->setIcon(QIcon(":/icons/add.png"));           //图标
+    ui->pushButton_addFolder->setIcon(QIcon(":/icons/playlist.png"));
     ui->pushButton_previous->setIcon(QIcon(":/icons/previous.png"));
     ui->pushButton_play->setIcon(QIcon(":/icons/play.png"));
     ui->pushButton_next->setIcon(QIcon(":/icons/next.png"));
     ui->pushButton_playbackmodel->setIcon(QIcon(":/icons/loop.png"));
 
 
-    ui->listWidget_music->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    ui->listWidget_music->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    ui->listWidget_music->setStyleSheet("background-color:transparent");
-    ui->listWidget_lyrics->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    ui->listWidget_lyrics->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    ui->listWidget_lyrics->setStyleSheet("background-color:transparent");
+    // 播放进度的界面刷新任务，按滑块、时间、歌词、波形的顺序执行
+    m_pscheduler = new UiScheduler(this);
+    m_taskSlider = m_pscheduler->addTask([this]() { updateSlider(); });
+    m_taskTime = m_pscheduler->addTask([this]() { updateTimeLabel(); });
+    m_taskLyric = m_pscheduler->addTask([this]() { updateCurrentLyric(); });
+    m_taskWaveform = m_pscheduler->addTask([this]() {
+        qint64 duration = trackDuration();
+        qint64 position = m_seekPreview >= 0 ? m_seekPreview : m_position;
+        m_pwaveformview->setProgress(duration > 0 ? (double)position / duration : 0.0);
+    });
+    m_taskSearch = m_pscheduler->addTask([this]() { updateSearch(); });
+    m_taskSpectrum = m_pscheduler->addTask([this]() { updateSpectrum(); });
+
+    m_pwaveformcache = new WaveformCache(4 * 1024 * 1024, this);
+    m_pwaveformview = new WaveformView(this);
+    m_pspectrumview = new SpectrumView(this);
+
+    m_psongmodel = new SongListModel(this);
+    m_pfiltermodel = new SongFilterModel(this);
+    m_pfiltermodel->setSourceModel(m_psongmodel);
+    m_plyricmodel = new LyricListModel(this);
+    m_pspareLyricModels[0] = new LyricListModel(this);
+    m_pspareLyricModels[1] = new LyricListModel(this);
+    m_pprefetcher = new TrackPrefetcher(512 * 1024, this);
+    ui->listView_music->setModel(m_pfiltermodel);
+    ui->listView_lyrics->setModel(m_plyricmodel);
+
+    // 统一行高，视图不用逐行计算大小，只布局可见的行
+    ui->listView_music->setUniformItemSizes(true);
+    ui->listView_lyrics->setUniformItemSizes(true);
+    ui->listView_music->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    ui->listView_lyrics->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    ui->listView_music->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    ui->listView_music->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    ui->listView_music->setStyleSheet("background-color:transparent");
+    ui->listView_lyrics->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    ui->listView_lyrics->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    ui->listView_lyrics->setStyleSheet("background-color:transparent");
+
+    ui->lineEdit_search->setPlaceholderText("搜索歌名、歌手、专辑、歌词");
+    ui->lineEdit_search->setClearButtonEnabled(true);
 
     QVBoxLayout * V1 = new QVBoxLayout();
     V1->addWidget(ui->pushButton_add);
+    V1->addWidget(ui->pushButton_addFolder);
     V1->addWidget(ui->pushButton_previous);
     V1->addWidget(ui->pushButton_play);
     V1->addWidget(ui->pushButton_next);
@@ -120,10 +569,12 @@ void Widget::init_window()                     //界面布局
 
 
     QVBoxLayout * V2 = new QVBoxLayout();
-    V2->addWidget(ui->listWidget_music);
+    V2->addWidget(ui->lineEdit_search);
+    V2->addWidget(ui->listView_music);
 
     QVBoxLayout * V3 = new QVBoxLayout();
-    V3->addWidget(ui->listWidget_lyrics);
+    V3->addWidget(ui->listView_lyrics);
+    V3->addWidget(m_pspectrumview);
 
     QHBoxLayout * H1 = new QHBoxLayout();
     H1->addLayout(V1,1);
@@ -134,8 +585,13 @@ void Widget::init_window()                     //界面布局
     H2->addWidget(ui->label_song,Qt::AlignRight);
 
 
+    QVBoxLayout * V4 = new QVBoxLayout();
+    V4->setSpacing(0);
+    V4->addWidget(ui->horizontalSlider_time);
+    V4->addWidget(m_pwaveformview);
+
     QHBoxLayout * H3 = new QHBoxLayout();
-    H3->addWidget(ui->horizontalSlider_time,9);
+    H3->addLayout(V4,9);
     H3->addWidget(ui->label_time,1);
 
     QVBoxLayout * V = new QVBoxLayout();
@@ -155,32 +611,58 @@ void Widget::pushButton_add_clicked()
     if (fileNames.isEmpty())
     {
         // 对选择的多个文件进行操作
-        qDebug() << "选择文件为空";
+        LOG_DEBUG(General) << "选择文件为空";
         return;
     }
 
+    QList<QUrl> urls;   //本次需要解析的歌曲，一次性交给工作对象并发解析
     for (auto file : fileNames) //范围for循环，从files中遍历获取每一个元素赋值给file
     {
         if (SongManager::getInstance().contains(QUrl(file)))
         {
-            qDebug() << "歌曲管理员已存储，不重复添加：" << file;
+            LOG_DEBUG(Import) << "歌曲管理员已存储，不重复添加：" << file;
             continue;
         }
 
-        emit addSong(file);
+        urls.append(QUrl(file));
         /*
         //设置到媒体播放列表
         m_pmediaplayerlist->addMedia(QMediaContent(QUrl(file)));
         ui->listWidget_music->addItem(new QListWidgetItem(QFileInfo(file).baseName()));*/
     }
 
+    if (!urls.isEmpty())
+    {
+        emit addSongs(urls);
+    }
+
 
     return;
 }
 
-void Widget::pushButton_play_clicked() //播放/暂停功能
+/*
+ * 添加文件夹
+ *  不在这里列出文件，整个目录树交给工作对象边遍历边解析
+ *  已经导入过的歌曲带上文件戳，没变化的不再解析；扫描完成后开始监视这个文件夹
+ */
+void Widget::pushButton_addFolder_clicked()
 {
+    QString dir = QFileDialog::getExistingDirectory(this, "添加文件夹", QDir::currentPath());
+    if (dir.isEmpty())
+    {
+        LOG_DEBUG(General) << "选择文件夹为空";
+        return;
+    }
 
+    emit scanFolder(dir, SongManager::getInstance().stamps(dir, true), true);
+    m_pfolderwatcher->watch(QStringList() << dir);
+
+    return;
+}
+
+void Widget::pushButton_play_clicked() //播放/暂停功能
+{
+        init_media();   //第一帧之前就点了播放，提前创建播放引擎
 
         if(QMediaPlayer::PlayingState == m_pmediaplayer->state())
         {
@@ -206,60 +688,125 @@ void Widget::handle_mediaPlayer_stateChanged(QMediaPlayer::State newState)//暂
         ui->pushButton_play->setText("播放");
     }
 
+    emit spectrumActive(QMediaPlayer::PlayingState == newState);
+
     return;
 }
 
 void Widget::handle_mediaPlayer_positionChanged(qint64 position)//进度条同步歌曲显示
 {
+    // 只记下位置，和播放进度有关的界面在下一帧统一刷新，各个任务自己判断显示的值有没有变化
+    // 搜索结果和频谱不跟播放位置走，分别由搜索框、搜索索引和频谱分析标记
+    m_position = position;
+    m_pscheduler->markDirty(m_taskSlider);
+    m_pscheduler->markDirty(m_taskTime);
+    m_pscheduler->markDirty(m_taskLyric);
+    m_pscheduler->markDirty(m_taskWaveform);
 
-    // 当前播放到的位置（毫秒）转变成秒
-    qint64 seconds = position / 1000;
+    return;
+}
 
-    //歌曲总时长（毫秒）转变成秒
-    qint64 durationSeconds = m_pmediaplayer->duration() / 1000;
+void Widget::updateSlider()
+{
+    // 拖动进度条时不跟随播放位置
+    if (ui->horizontalSlider_time->isSliderDown()) { return; }
 
-    // 滚动条的总长度
+    qint64 duration = trackDuration();
     int slider_max = ui->horizontalSlider_time->maximum();
 
     // 前端进度条的值 = 后台当前播放进度 / 后台歌曲时长 * 前端进度条最大值
-    ui->horizontalSlider_time->setValue((double)seconds / durationSeconds * slider_max);
+    int value = duration > 0 ? (int)((double)m_position / duration * slider_max) : 0;
+    if (value == m_shownSliderValue) { return; }
 
-    QString timetext = QString("%1:%2/%3:%4")
-            .arg(seconds / 60, 2, 10,  QChar('0'))
-            .arg(seconds % 60, 2, 10,  QChar('0'))
-            .arg(durationSeconds / 60, 2, 10,  QChar('0'))
-            .arg(durationSeconds % 60, 2, 10,  QChar('0'));
+    m_shownSliderValue = value;
+    ui->horizontalSlider_time->setValue(value);
+}
 
-    ui->label_time->setText(timetext);
+//把秒数按"分:秒"写到text，分钟至少两位，返回写入的字符数
+static int formatMinutes(qint64 seconds, QChar * text)
+{
+    qint64 minutes = seconds / 60;
+    int n = 0;
+    QChar digits[20];
+    do
+    {
+        digits[n++] = QChar('0' + (int)(minutes % 10));
+        minutes /= 10;
+    } while (minutes > 0);
+    if (n < 2) { digits[n++] = QChar('0'); }
+
+    int count = 0;
+    while (n > 0) { text[count++] = digits[--n]; }
+    text[count++] = QChar(':');
+    text[count++] = QChar('0' + (int)(seconds % 60 / 10));
+    text[count++] = QChar('0' + (int)(seconds % 10));
+    return count;
+}
 
-    updateCurrentLyric();
+void Widget::updateTimeLabel()
+{
+    // 当前播放到的位置（拖动进度条时是预览的目标位置）和歌曲总时长（毫秒）转变成秒，和上次显示的一样就不用重新格式化
+    qint64 seconds = (m_seekPreview >= 0 ? m_seekPreview : m_position) / 1000;
+    qint64 durationSeconds = trackDuration() / 1000;
+    if (seconds == m_shownSeconds && durationSeconds == m_shownDuration) { return; }
 
-    return;
+    m_shownSeconds = seconds;
+    m_shownDuration = durationSeconds;
+
+    QChar text[64];
+    int n = formatMinutes(seconds, text);
+    text[n++] = QChar('/');
+    n += formatMinutes(durationSeconds, text + n);
+
+    ui->label_time->setText(QString(text, n));
 }
 
-void Widget::horizontalSlider_position_sliderReleased() //松开进度条，歌曲定位同步
+/*
+ * 当前歌曲的时长
+ *  VBR文件没有信息头时，后端只能按开头的码率估计时长，跳转索引数过所有的帧，按它算出的时长是准确的
+ *  进度条、时间和波形都按这个时长换算，拖动到哪里就跳转到哪里
+ *  只有原生音频引擎按跳转索引定位；默认的QMediaPlayer引擎跳转由后端自己完成，索引只提供这里的时长，
+ *      后端估计的时长不准时，跳转到的位置仍然可能和进度条对不上
+ */
+qint64 Widget::trackDuration() const
 {
+    if (m_seekIndex.isValid()) { return m_seekIndex.duration(); }
+    return m_pmediaplayer ? m_pmediaplayer->duration() : 0;
+}
 
+// 后台播放进度(毫秒） = 前端进度条 / 进度条最大值 * 歌曲时长
+qint64 Widget::sliderPosition(int value) const
+{
+    int slider_max = ui->horizontalSlider_time->maximum();
+    return slider_max > 0 ? (qint64)((double)trackDuration() / slider_max * value) : 0;
+}
 
-        // 前端进度条的值
-        int slider_value = ui->horizontalSlider_time->value();
-
-        //歌曲总时长毫秒
-        qint64 durationSeconds = m_pmediaplayer->duration();
+void Widget::horizontalSlider_position_sliderMoved(int value) //拖动进度条，时间和波形预览目标位置
+{
+    m_seekPreview = sliderPosition(value);
+    m_pscheduler->markDirty(m_taskTime);
+    m_pscheduler->markDirty(m_taskWaveform);
 
-        // 滚动条的总长度
-        int slider_max = ui->horizontalSlider_time->maximum();
+    return;
+}
 
-        // 后台播放进度(毫秒） = 前端进度条 / 进度条最大值 * 后台歌曲时长
-        m_pmediaplayer->setPosition((double) durationSeconds / slider_max *slider_value);
+void Widget::horizontalSlider_position_sliderReleased() //松开进度条，歌曲定位同步
+{
+    // 前端进度条的值
+    int slider_value = ui->horizontalSlider_time->value();
+    m_shownSliderValue = slider_value;
+    m_seekPreview = -1;
+    if (!m_pmediaplayer) { return; }
 
-        return;
+    // 原生音频引擎有跳转索引时按索引直接定位到目标位置所在的帧；QMediaPlayer引擎由后端自己跳转，不用索引
+    m_pmediaplayer->setPosition(sliderPosition(slider_value));
 
+    return;
 }
 
 void Widget::pushButton_previous_clicked()
 {
-    qDebug()<<"切换上一首";
+    LOG_DEBUG(Playback) << "切换上一首";
     m_pmediaplayerlist->previous();
     return;
 }
@@ -267,36 +814,195 @@ void Widget::pushButton_previous_clicked()
 
 void Widget::pushButton_next_clicked()
 {
-    qDebug()<<"切换下一首";
+    LOG_DEBUG(Playback) << "切换下一首";
     m_pmediaplayerlist->next();
     return;
 }
 
 void Widget::handle_mediaPlaylist_currentMediaChanged(const QMediaContent &media)
 {
-        qDebug() << "切歌";
+        LOG_DEBUG(Playback) << "切歌";
 
         if (media.isNull())
         {
+            m_currentUrl.clear();
+            m_seekIndex = SeekIndex();
+            m_currentLyrics.reset();
+            m_lyricCursor.reset(nullptr);
+            m_shownLyricIndex = -1;
+            m_pwaveformview->setWaveform(WaveformPtr());
             ui->label_song->clear();
-            ui->listWidget_music->setCurrentRow(m_pmediaplayerlist->currentIndex());
+            ui->listView_music->setCurrentIndex(m_pfiltermodel->mapFromSource(m_psongmodel->index(m_pmediaplayerlist->currentIndex())));
 
             return;
         }
         // 当切歌的时候，重新设置歌曲名字
         QString fileName = media.canonicalUrl().fileName();
+        QUrl previousUrl = m_currentUrl;
 
         ui->label_song->setText(fileName);
-        ui->listWidget_music->setCurrentRow(m_pmediaplayerlist->currentIndex());
+        ui->listView_music->setCurrentIndex(m_pfiltermodel->mapFromSource(m_psongmodel->index(m_pmediaplayerlist->currentIndex())));
+
+        // 歌词已在缓存中直接显示，否则后台加载，加载完成后在handle_lyricCache_loaded中显示
+        m_currentUrl = media.canonicalUrl();
+        applyReplayGain();
+
+        // 跳转索引决定进度条换算用的时长，拖动时的预览和松开后的跳转都按它计算
+        SongManager & manager = SongManager::getInstance();
+        SongId id = manager.find(m_currentUrl);
+        m_seekIndex = id >= 0 ? manager.seekIndex(id) : SeekIndex();
 
+        // 波形已在缓存中直接显示，否则后台从磁盘缓存读取或者解码计算，完成后在handle_waveformCache_loaded中显示
+        // 之前几首歌还没加载完的波形已经用不上了，取消掉，不占后台线程
+        m_pwaveformview->setWaveform(m_pwaveformcache->find(m_currentUrl));
+        m_pwaveformcache->cancel(m_currentUrl);
+        m_pwaveformcache->request(m_currentUrl);
 
-        Song & songRef = SongManager::getInstance().song(media.canonicalUrl());
+        // 上一次切歌时已经在备用模型中填好了这首歌的歌词，直接换到视图上，不用重建歌词列表
+        if (!swapInPreparedLyrics(previousUrl))
+        {
+            m_currentLyrics = SongManager::getInstance().lyrics(m_currentUrl);
+            m_lyricCursor.reset(m_currentLyrics.data());
+            if (m_currentLyrics)
+            {
+                updateAllLyrics(m_currentLyrics);
+            }
+            else
+            {
+                m_plyricmodel->setPlaceholder("正在加载歌词…");
+            }
+        }
 
-        updateAllLyrics(songRef.lyrics());
+        prefetchNeighbours();
 
         return;
 }
 
+/*
+ * 换上备好的歌词模型
+ *  备用模型中有这首歌的歌词时，和当前模型交换，换下来的模型留着上一首的歌词，作为新的备用模型
+ *  往回切歌时上一首的歌词也不用重建
+ */
+bool Widget::swapInPreparedLyrics(const QUrl& previousUrl)
+{
+    int slot = -1;
+    for (int i = 0; i < 2; i++)
+    {
+        if (m_spareLyricUrls[i] == m_currentUrl && m_pspareLyricModels[i]->lyrics())
+        {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) { return false; }
+
+    LOG_TRACE(Lyrics) << "换上备好的歌词模型：" << m_currentUrl.fileName();
+
+    std::swap(m_plyricmodel, m_pspareLyricModels[slot]);
+    m_spareLyricUrls[slot] = previousUrl;
+
+    // setModel不会删除旧的选择模型，由这里释放
+    QItemSelectionModel* oldSelection = ui->listView_lyrics->selectionModel();
+    ui->listView_lyrics->setModel(m_plyricmodel);
+    delete oldSelection;
+
+    m_currentLyrics = m_plyricmodel->lyrics();
+    m_lyricCursor.reset(m_currentLyrics.data());
+    ui->listView_lyrics->scrollToTop();
+
+    // 换了歌词，下一帧重新高亮当前行
+    m_shownLyricIndex = -1;
+    m_pscheduler->markDirty(m_taskLyric);
+
+    return true;
+}
+
+/*
+ * 预读前后相邻的歌曲
+ *  文件头部读进页缓存，QMediaPlayer切过去时不用等磁盘或者网络存储
+ *  歌词在后台加载，加载好后填进备用模型，切过去时直接换上
+ *  波形要解码整首歌，不为相邻歌曲提前计算
+ */
+void Widget::prefetchNeighbours()
+{
+    // 快速连续切歌时，之前排队的相邻歌曲已经没有用了
+    m_pprefetcher->clearQueue();
+
+    QUrl urls[2];
+    const int indexes[2] = { m_pmediaplayerlist->nextIndex(), m_pmediaplayerlist->previousIndex() };
+    for (int i = 0; i < 2; i++)
+    {
+        if (indexes[i] >= 0)
+        {
+            urls[i] = m_pmediaplayerlist->media(indexes[i]).canonicalUrl();
+        }
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (urls[i].isEmpty() || urls[i] == m_currentUrl) { continue; }
+
+        m_pprefetcher->prefetch(urls[i]);
+        prepareLyricModel(urls[i], urls[1 - i]);
+    }
+}
+
+/*
+ * 为一首歌备好歌词模型
+ *  已经有备用模型对应这首歌时沿用，否则占用不对应keep的那个备用模型
+ *  歌词已在缓存中时直接填入，否则在handle_lyricCache_loaded中加载完成后填入
+ */
+void Widget::prepareLyricModel(const QUrl& url, const QUrl& keep)
+{
+    int slot = -1;
+    for (int i = 0; i < 2 && slot < 0; i++)
+    {
+        if (m_spareLyricUrls[i] == url) { slot = i; }
+    }
+    if (slot < 0)
+    {
+        slot = (m_spareLyricUrls[0] == keep && !keep.isEmpty()) ? 1 : 0;
+        m_spareLyricUrls[slot] = url;
+        m_pspareLyricModels[slot]->setPlaceholder(QString());
+    }
+
+    if (m_pspareLyricModels[slot]->lyrics()) { return; }
+
+    LyricsPtr lyrics = SongManager::getInstance().lyrics(url);
+    if (lyrics)
+    {
+        m_pspareLyricModels[slot]->setLyrics(lyrics);
+    }
+}
+
+void Widget::handle_lyricCache_loaded(const QUrl &url, const LyricsPtr &lyrics)
+{
+    // 预取的相邻歌曲的歌词填进对应的备用模型
+    for (int i = 0; i < 2; i++)
+    {
+        if (m_spareLyricUrls[i] == url && !m_pspareLyricModels[i]->lyrics())
+        {
+            m_pspareLyricModels[i]->setLyrics(lyrics);
+        }
+    }
+
+    // 当前歌曲只关心还在等待的歌词
+    if (url != m_currentUrl || m_currentLyrics) { return; }
+
+    m_currentLyrics = lyrics;
+    m_lyricCursor.reset(m_currentLyrics.data());
+    updateAllLyrics(m_currentLyrics);
+}
+
+
+
+void Widget::handle_waveformCache_loaded(const QUrl &url, const WaveformPtr &waveform)
+{
+    if (url != m_currentUrl) { return; }
+
+    m_pwaveformview->setWaveform(waveform);
+}
+
 
 
 void Widget::pushButton_playbackmodel_clicked()    //播放模式切换
@@ -321,83 +1027,109 @@ void Widget::handleMediaPlaylistPlaybackModeChanged(QMediaPlaylist::PlaybackMode
     return;
 }
 
-void Widget::listWidget_playlist_itemDoubleClicked(QListWidgetItem *item)//前端歌曲列表双击某一首歌切歌并播放：前端歌曲列表双击当前行（双击信号） -> 设置媒体播放列表当前索引, 并调用媒体播放器的播放函数
+void Widget::listView_playlist_doubleClicked(const QModelIndex &index)//前端歌曲列表双击某一首歌切歌并播放：前端歌曲列表双击当前行（双击信号） -> 设置媒体播放列表当前索引, 并调用媒体播放器的播放函数
 {
 
-    m_pmediaplayerlist->setCurrentIndex(ui->listWidget_music->currentRow());
+    // 列表显示的可能是搜索结果，先换算回歌曲ID（和播放列表下标一致）
+    init_media();
+    m_pmediaplayerlist->setCurrentIndex(m_pfiltermodel->mapToSource(index).row());
     m_pmediaplayer->play();
     return;
 }
 
-void Widget::updateCurrentLyric()
+void Widget::lineEdit_search_textChanged(const QString &)
 {
-    if (m_pmediaplayer->state() != QMediaPlayer::PlayingState)
+    // 连续输入时一帧只查询一次
+    m_pscheduler->markDirty(m_taskSearch);
+}
+
+void Widget::handle_searchIndexer_indexed()
+{
+    // 正在搜索时，新加入索引的歌曲可能也符合条件，下一帧重新查询一次
+    // 不看过滤模型的状态：删除还没同步到索引时的查询没有设置结果（见updateSearch）
+    if (!ui->lineEdit_search->text().trimmed().isEmpty())
     {
-        qDebug() << "当前不是播放状态, 不用同步";
-        return;
+        m_pscheduler->markDirty(m_taskSearch);
     }
+}
 
-    QUrl url = m_pmediaplayer->currentMedia().canonicalUrl();
-    const QMap<qint64, QString> & lyrics = SongManager::getInstance().lyrics(url);
-    if (lyrics.isEmpty())
+/*
+ * 搜索
+ *  搜索框为空时显示全部歌曲；否则查询搜索索引，结果就是升序的歌曲ID（和列表的行号一致），只显示这些行
+ *  查询和设置结果都只和结果数有关，和歌曲库大小无关
+ *  索引还没执行完已经投递的删除时，结果里的歌曲ID是删除之前的编号，不用；索引执行完会发出indexed，再查询一次
+ */
+void Widget::updateSearch()
+{
+    QString query = ui->lineEdit_search->text().trimmed();
+    if (query.isEmpty())
     {
-        qDebug() << "当前歌曲没有歌词，不用同步";
-        return;
+        m_pfiltermodel->clearFilter();
     }
-
-    qDebug() << "实时刷新当前歌词，播放器当前进度：" << m_pmediaplayer->position();
-    qint64 position = m_pmediaplayer->position();
-    int index = 0;  //存储当前进度对应的歌词文本的索引
-
-    //循环遍历歌词容器，从头往后找
-    for (auto it = lyrics.begin(); it != lyrics.end(); it++)
+    else
     {
-        //end前面的最后一个元素
-        if (lyrics.end() == (it + 1)) { break; }
+        int removals = 0;
+        QVector<SongId> ids = m_psearchindexer->index().search(query, &removals);
+        if (removals != m_unindexed) { return; }
 
-        //比较播放进度和时间戳，播放进度大于等于某一行（的起始事件），并且小于下一行
-        if (position >= it.key() && position < (it + 1).key())
-        {
-            qDebug() << "当前歌词时间范围和播放器进度及文本：["
-                     << it.key() << ", " << (it + 1).key() << ") "
-                     << position << " "
-                     << it.value();
-            break;
-        }
-
-        index++;    //如果不是这一行，就继续判断下一行
+        // 索引可能还没加入最新的歌曲，但不会有超出歌曲库的ID
+        m_pfiltermodel->setFilter(ids);
     }
 
-    ui->listWidget_lyrics->setCurrentRow(index);    //界面歌词控件设置当前行，高亮显示
-    QListWidgetItem * item = ui->listWidget_lyrics->item(index);    //获取当前行元素
-    ui->listWidget_lyrics->scrollToItem(item, QAbstractItemView::PositionAtCenter); //列表滚动到该行，并垂直居中
+    // 过滤后重新选中当前播放的歌曲（如果在结果中）
+    ui->listView_music->setCurrentIndex(m_pfiltermodel->mapFromSource(m_psongmodel->index(m_pmediaplayerlist->currentIndex())));
 }
 
+void Widget::handle_spectrum_frameReady()
+{
+    m_pscheduler->markDirty(m_taskSpectrum);
+}
 
-void Widget::updateAllLyrics(const QMap<qint64, QString>& lyrics)
+void Widget::updateSpectrum()
 {
-    // 清空上一首歌的歌词
-    ui->listWidget_lyrics->clear();
+    if (m_pspectrum->update())
+    {
+        const SpectrumAnalyzer::Frame & frame = m_pspectrum->frame();
+        m_pspectrumview->setBands(frame.bands, frame.count);
+    }
+}
 
-    // 该歌曲没有歌词
-    if (lyrics.isEmpty())
+void Widget::updateCurrentLyric()
+{
+    if (!isPlaying())
     {
-        QListWidgetItem * item = new QListWidgetItem("无歌词");
-        item->setTextAlignment(Qt::AlignCenter);    //设置该行文本居中显示
-        ui->listWidget_lyrics->addItem(item);
+        LOG_TRACE(Lyrics) << "当前不是播放状态, 不用同步";
         return;
     }
 
-    // 该歌曲有歌词
-    qDebug() << "更新所有歌词，第一行文本：" << lyrics.first();
-    for (auto text : lyrics) //获取lyrcis中的每行歌词的文本到text
+    // 当前歌曲的歌词在切歌时已经取得（或者正在后台加载）
+    if (!m_currentLyrics || m_currentLyrics->isEmpty())
     {
-        //LOG << "text: " << text;
-        QListWidgetItem * item = new QListWidgetItem(text);
-        item->setTextAlignment(Qt::AlignCenter);    //设置该行文本居中显示
-        ui->listWidget_lyrics->addItem(item);
+        LOG_TRACE(Lyrics) << "当前歌曲没有歌词，不用同步";
+        return;
     }
 
+    // 正常播放时O(1)前进到下一行，跳转后二分查找重新定位；第一行之前高亮第一行
+    int index = qMax(0, m_lyricCursor.seek(m_position));
+    if (index == m_shownLyricIndex) { return; }   // 还在同一行，不用碰歌词视图
+    m_shownLyricIndex = index;
+
+    QModelIndex item = m_plyricmodel->index(index);     //获取当前行
+    ui->listView_lyrics->setCurrentIndex(item);         //界面歌词控件设置当前行，高亮显示
+    ui->listView_lyrics->scrollTo(item, QAbstractItemView::PositionAtCenter); //列表滚动到该行，并垂直居中
+}
+
+
+void Widget::updateAllLyrics(const LyricsPtr& lyrics)
+{
+    // 歌词模型直接引用该歌曲的歌词时间轴，没有歌词时显示"无歌词"
+    m_plyricmodel->setLyrics(lyrics);
+    ui->listView_lyrics->scrollToTop();
+
+    // 换了歌词，下一帧重新高亮当前行
+    m_shownLyricIndex = -1;
+    m_pscheduler->markDirty(m_taskLyric);
+
     return;
 }
 
@@ -5,9 +5,24 @@
 #include <QMediaPlayer>
 #include <QMediaPlaylist>
 #include <QMediaContent>
-#include <QListWidgetItem>
+#include <QModelIndex>
 #include <QThread>
+#include <QSet>
+#include <QTimer>
 #include "worker.h"
+#include "songlistmodel.h"
+#include "songfiltermodel.h"
+#include "searchindexer.h"
+#include "lyriclistmodel.h"
+#include "folderwatcher.h"
+#include "loudnessanalyzer.h"
+#include "waveformcache.h"
+#include "waveformview.h"
+#include "uischeduler.h"
+#include "trackprefetcher.h"
+#include "playbackengine.h"
+#include "spectrumanalyzer.h"
+#include "spectrumview.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class Widget; }
@@ -18,27 +33,65 @@ class Widget : public QWidget
     Q_OBJECT
 signals:
     void addSong(const QUrl& mp3Url); //添加歌曲信号
+    void addSongs(const QList<QUrl>& mp3Urls); //批量添加歌曲信号，由工作对象分发到解析线程池
+    void restoreLibrary(const QString& indexPath); //从歌曲库索引恢复上次的歌曲信号
+    void scanFolder(const QString& dir, const FileStamps& known, bool recursive); //扫描文件夹信号，只解析新增和变化了的歌曲
+    void analyzeSongs(const QList<QUrl>& mp3Urls); //后台分析歌曲响度信号
+    void indexSongs(const SearchDocuments& documents); //新加入或更新的歌曲加入搜索索引信号
+    void unindexSongs(const QVector<QPair<int, int>>& ranges); //从搜索索引中删除歌曲信号，各段和歌曲列表模型删除的一致
+    void spectrumActive(bool active); //开始或停止频谱分析信号
 
 public slots:
-    void handle_worker_getASongFinished(); //处理工作对象解析结束信号
+    void handle_worker_messagesReady(); //处理工作对象投递的消息（解析结果、进度、错误、删除）
+    void handle_folderWatcher_changed(const QString& dir, bool recursive); //监视的文件夹变化后增量扫描
+    void handle_analyzer_analyzed(const QUrl& mp3Url, float loudness, float truePeak); //一首歌的响度分析完成
+    void handle_analyzer_idle();        //响度分析队列已空
+    void handle_searchIndexer_indexed(); //又有一批歌曲加入了搜索索引
+    void handle_spectrum_frameReady();  //频谱分析出了新的一帧
 public:
     Widget(QWidget *parent = nullptr);
     ~Widget();
 public:
-    void init_media();
+    void init_playlist();
+    void init_media();          //创建播放引擎，推迟到第一帧之后；之前就要播放时提前创建
+    void init_afterFirstFrame();//第一帧画出来之后再做的初始化：播放引擎、恢复歌曲库
     void init_window();
     void init_worker();
-    void updateAllLyrics(const QMap<qint64, QString>&);
+    void init_analyzer();
+    void init_search();
+    void init_spectrum();
+    void saveLibrary();
+    void updateAllLyrics(const LyricsPtr&);
+    bool swapInPreparedLyrics(const QUrl& previousUrl);    //切到的歌已经有备好的歌词模型时直接换上
+    void prefetchNeighbours();  //预读播放列表中前后相邻的歌曲，并备好它们的歌词模型
+    void prepareLyricModel(const QUrl& url, const QUrl& keep);
     void updateCurrentLyric();
+    void updateSlider();
+    void updateTimeLabel();
+    qint64 trackDuration() const;           //当前歌曲的时长（毫秒），有跳转索引时以索引为准
+    qint64 sliderPosition(int value) const; //进度条的值对应的播放位置（毫秒）
+    void updateSearch();        //按搜索框的内容查询索引，过滤歌曲列表
+    void updateSpectrum();      //取频谱分析的最新一帧显示，播放时每帧都刷新
+    void appendSongs(const QVector<Song*>& songs);  //新歌加入歌曲列表和播放列表，已有的歌只更新信息
+    void removeSongs(const QStringList& paths);     //从歌曲列表和播放列表中删除这些歌曲
+    void queueAnalysis();       //把还没有分析过响度的歌曲交给响度分析对象
+    void applyReplayGain();     //按当前歌曲的响度设置播放音量
+    bool isPlaying() const;     //播放引擎已经创建并且正在播放
+
+protected:
+    void paintEvent(QPaintEvent *event) override;   //第一次绘制后安排推迟的初始化
 
 public slots:
     void pushButton_play_clicked();
     void pushButton_add_clicked();
+    void pushButton_addFolder_clicked();
+    void horizontalSlider_position_sliderMoved(int value);
     void horizontalSlider_position_sliderReleased();
     void pushButton_previous_clicked();
     void pushButton_next_clicked();
     void pushButton_playbackmodel_clicked();
-    void listWidget_playlist_itemDoubleClicked(QListWidgetItem *);
+    void listView_playlist_doubleClicked(const QModelIndex &);
+    void lineEdit_search_textChanged(const QString &);
 
 
 public slots:
@@ -46,15 +99,61 @@ public slots:
     void handle_mediaPlayer_positionChanged(qint64 position);
     void handle_mediaPlaylist_currentMediaChanged(const QMediaContent&);
     void handleMediaPlaylistPlaybackModeChanged(QMediaPlaylist::PlaybackMode);
+    void handle_lyricCache_loaded(const QUrl &url, const LyricsPtr &lyrics);
+    void handle_waveformCache_loaded(const QUrl &url, const WaveformPtr &waveform);
 
 
 
 private:
     Ui::Widget *ui;
-    QMediaPlayer *m_pmediaplayer;
+    PlaybackEngine *m_pmediaplayer;   //播放引擎，默认是QMediaPlayer，LOOPY_ENGINE=native时是自己的音频引擎；第一帧之前为nullptr
     QMediaPlaylist *m_pmediaplayerlist;
     QThread* m_pthread;
     Worker* m_pworker;
+    FolderWatcher* m_pfolderwatcher;  //监视导入过的文件夹，变化后增量扫描
+    QThread* m_panalyzerthread;       //响度分析线程，最低优先级
+    LoudnessAnalyzer* m_panalyzer;
+    QTimer* m_psavetimer;             //分析结果延迟保存，连续几批结果只写一次索引
+    QSet<QUrl> m_analysisPending;     //已经交给响度分析对象、还没有结果的歌曲
+    bool m_replayGain;                //是否启用回放增益
+    bool m_firstFrame;                //第一帧已经画出来
+    bool m_restoring;                 //正在恢复上次的歌曲库，期间不保存索引，完成时记录启动阶段
+    WaveformCache* m_pwaveformcache;  //波形缓存（内存 + 磁盘）
+    WaveformView* m_pwaveformview;    //进度条下方的波形条
+
+    // 播放进度相关的界面刷新，由调度器按帧合并执行；记录已经显示的值，没变化时不碰控件
+    UiScheduler* m_pscheduler;
+    int m_taskSlider;
+    int m_taskTime;
+    int m_taskLyric;
+    int m_taskWaveform;
+    qint64 m_position;          //最近一次收到的播放位置（毫秒）
+    int m_shownSliderValue;
+    qint64 m_shownSeconds;
+    qint64 m_shownDuration;
+    int m_shownLyricIndex;      //歌词列表当前高亮的行，-1表示没有
+    qint64 m_seekPreview;       //拖动进度条时预览的目标位置（毫秒），没有拖动时为-1
+
+    QThread* m_psearchthread;         //搜索索引线程，最低优先级
+    SearchIndexer* m_psearchindexer;
+    SongFilterModel* m_pfiltermodel;  //歌曲列表视图显示的过滤模型，搜索框为空时显示全部歌曲
+    int m_taskSearch;                 //索引更新后刷新搜索结果，和播放进度一样按帧合并
+    int m_unindexed;                  //投递给搜索索引的删除次数，和索引执行过的次数相同时查询结果才能用
+
+    QThread* m_pspectrumthread;       //频谱分析线程
+    SpectrumAnalyzer* m_pspectrum;    //频谱分析，同时是播放引擎的音频旁路
+    SpectrumView* m_pspectrumview;    //歌词下方的频谱条
+    int m_taskSpectrum;
+
+    SongListModel* m_psongmodel;      //歌曲列表模型
+    LyricListModel* m_plyricmodel;    //歌词列表模型，当前显示在歌词视图上
+    LyricListModel* m_pspareLyricModels[2];   //备用的歌词模型，提前填好前后相邻歌曲的歌词，切歌时直接换到视图上
+    QUrl m_spareLyricUrls[2];                 //备用模型对应的歌曲
+    TrackPrefetcher* m_pprefetcher;   //切歌前把相邻歌曲的文件头部读进页缓存
+    QUrl m_currentUrl;          //当前歌曲
+    SeekIndex m_seekIndex;      //当前歌曲的跳转索引，没有时无效
+    LyricsPtr m_currentLyrics;  //当前歌曲的歌词，还在加载时为空
+    LyricCursor m_lyricCursor;  //当前歌曲的歌词游标
 
 };
 #endif // WIDGET_H